@@ -26,10 +26,11 @@ if "%release%"=="1" set cl_compile=%cl_release%
 set shadercross=call ..\tools\SDL3_shadercross\shadercross.exe
 set shadercross_vertex=%shadercross% -t vertex -DVERTEX_SHADER
 set shadercross_fragment=%shadercross% -t fragment -DFRAGMENT_SHADER
+set shadercross_compute=%shadercross% -t compute -DCOMPUTE_SHADER
 
 :: --- Font Atlas Build Definitions -------------------------------------------
 set msdf_atlas_gen=call ..\tools\msdf_atlas_gen\msdf_atlas_gen.exe
-set msdf_common=-type msdf -size 72 -pxrange 4 -coloringstrategy distance -errorcorrection auto-full
+set msdf_common=-type mtsdf -size 72 -pxrange 4 -coloringstrategy distance -errorcorrection auto-full
 
 :: --- Prep Directories -------------------------------------------------------
 if not exist build mkdir build
@@ -54,9 +55,17 @@ if "%buildfonts%"=="1" (
                    %msdf_common% ^
                    -imageout limelight.png -json limelight.json || exit /b 1
 )
+%cl_compile% ..\src\font_atlas_bake.cpp %cl_link% /out:font_atlas_bake.exe || exit /b 1
+if "%buildfonts%"=="1" (
+  font_atlas_bake.exe || exit /b 1
+)
 %shadercross_vertex% ..\src\text_batch.hlsl -o text_batch.vert.dxil || exit /b 1
 %shadercross_fragment% ..\src\text_batch.hlsl -DEFFECT_BASIC -o text_batch_basic.frag.dxil || exit /b 1
 %shadercross_fragment% ..\src\text_batch.hlsl -DEFFECT_OUTLINE -o text_batch_outline.frag.dxil || exit /b 1
+%shadercross_fragment% ..\src\text_batch.hlsl -DEFFECT_UBER -o text_batch_uber.frag.dxil || exit /b 1
+%shadercross_compute% ..\src\text_batch.hlsl -DCULL_COUNT -o text_batch_cull_count.comp.dxil || exit /b 1
+%shadercross_compute% ..\src\text_batch.hlsl -DCULL_SCAN -o text_batch_cull_scan.comp.dxil || exit /b 1
+%shadercross_compute% ..\src\text_batch.hlsl -DCULL_COMPACT -o text_batch_cull_compact.comp.dxil || exit /b 1
 %cl_compile% ..\src\sdl3_gpu_msdf_text.cpp ^
              ..\extern\imgui\imgui.cpp ^
              ..\extern\imgui\imgui_demo.cpp ^
@@ -70,3 +79,7 @@ popd
 
 :: --- Copy DLL's -------------------------------------------------------------
 if not exist build\SDL3.dll copy extern\SDL3\lib\x64\SDL3.dll build >nul
+
+:: --- Copy Fonts -------------------------------------------------------------
+if not exist build\fonts mkdir build\fonts
+copy fonts\*.ttf build\fonts >nul
@@ -0,0 +1,2071 @@
+// Benchmarks are run headless with `sdl3_gpu_msdf_text --benchmark` once the app has finished
+// initializing. Results are written to the log.
+
+static double benchmark_elapsed_ms(uint64_t start_counter) {
+  return static_cast<double>(SDL_GetPerformanceCounter() - start_counter) * 1000.0 /
+         static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+// -- Batch Fixture ---------------------------------------------------------------
+
+// A text batch with an upload scheduler of its own, so a benchmark leaves the app's untouched, and
+// an offscreen target to render it into, unless the fixture was created with a target size of 0.
+struct Benchmark_Batch_Fixture {
+  SDL_GPUDevice*   device;
+  Upload_Scheduler upload_scheduler;
+  Text_Batch       text_batch;
+  SDL_GPUTexture*  target_texture;
+};
+
+// The CPU time spent recording, preparing and submitting frames, and the frame time including the
+// wait for the GPU.
+struct Benchmark_Frame_Times {
+  double cpu_ms;
+  double frame_ms;
+};
+
+// The fixture must not be moved once created, its text batch points to its upload scheduler. It is
+// destroyed with benchmark_batch_fixture_destroy even when creating it failed.
+static bool benchmark_batch_fixture_create(
+    Benchmark_Batch_Fixture* fixture,
+    const std::string&       base_path,
+    const Font_Atlas_Array&  font_atlas_array,
+    SDL_GPUDevice*           device,
+    SDL_GPUTextureFormat     target_format,
+    int                      target_size) {
+  SDL_assert(fixture != nullptr);
+  SDL_assert(device != nullptr);
+
+  fixture->device = device;
+  upload_scheduler_create(&fixture->upload_scheduler, device);
+  if (!text_batch_create(
+          &fixture->text_batch,
+          base_path,
+          font_atlas_array,
+          &fixture->upload_scheduler,
+          device,
+          target_format)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create text batch");
+    return false;
+  }
+
+  if (target_size == 0) { return true; }
+  SDL_GPUTextureCreateInfo info = {};
+  info.type                     = SDL_GPU_TEXTURETYPE_2D;
+  info.format                   = target_format;
+  info.width                    = static_cast<Uint32>(target_size);
+  info.height                   = static_cast<Uint32>(target_size);
+  info.layer_count_or_depth     = 1;
+  info.num_levels               = 1;
+  info.usage                    = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET;
+  fixture->target_texture       = SDL_CreateGPUTexture(device, &info);
+  if (fixture->target_texture == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture: %s", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+static void benchmark_batch_fixture_destroy(Benchmark_Batch_Fixture* fixture) {
+  SDL_assert(fixture != nullptr);
+
+  if (fixture->device == nullptr) { return; }
+  SDL_ReleaseGPUTexture(fixture->device, fixture->target_texture);
+  fixture->target_texture = nullptr;
+  text_batch_destroy(&fixture->text_batch, fixture->device);
+  upload_scheduler_destroy(&fixture->upload_scheduler);
+}
+
+// Runs a frame of the fixture's text batch: record() records into it, then its draw commands are
+// prepared, flushed with its uploads and culled. With a target, they are rendered into it, followed
+// by render(cmd_buf, render_pass), otherwise the batch is reset unrendered. With times, the GPU is
+// waited on after the submit and the frame's times are added to them.
+template <typename Record_Func, typename Render_Func>
+static bool benchmark_batch_fixture_run_frame(
+    Benchmark_Batch_Fixture* fixture,
+    Record_Func&&            record,
+    Render_Func&&            render,
+    Benchmark_Frame_Times*   times) {
+  SDL_assert(fixture != nullptr);
+
+  auto text_batch    = &fixture->text_batch;
+  auto start_counter = SDL_GetPerformanceCounter();
+  record();
+
+  auto cmd_buf = SDL_AcquireGPUCommandBuffer(fixture->device);
+  if (cmd_buf == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to acquire command buffer: %s",
+        SDL_GetError());
+    return false;
+  }
+  text_batch_prepare_draw_cmds(text_batch);
+  upload_scheduler_flush(&fixture->upload_scheduler, cmd_buf);
+  text_batch_cull_draw_cmds(text_batch, cmd_buf);
+  if (fixture->target_texture != nullptr) {
+    SDL_GPUColorTargetInfo target_info = {};
+    target_info.texture                = fixture->target_texture;
+    target_info.load_op                = SDL_GPU_LOADOP_CLEAR;
+    target_info.store_op               = SDL_GPU_STOREOP_STORE;
+    auto render_pass = SDL_BeginGPURenderPass(cmd_buf, &target_info, 1, nullptr);
+    text_batch_render_draw_cmds(text_batch, cmd_buf, render_pass);
+    render(cmd_buf, render_pass);
+    SDL_EndGPURenderPass(render_pass);
+  } else {
+    text_batch_reset(text_batch);
+  }
+  upload_scheduler_submit(&fixture->upload_scheduler, cmd_buf);
+
+  if (times != nullptr) {
+    times->cpu_ms += benchmark_elapsed_ms(start_counter);
+    SDL_WaitForGPUIdle(fixture->device);
+    times->frame_ms += benchmark_elapsed_ms(start_counter);
+  }
+  return true;
+}
+
+template <typename Record_Func>
+static bool benchmark_batch_fixture_run_frame(
+    Benchmark_Batch_Fixture* fixture,
+    Record_Func&&            record,
+    Benchmark_Frame_Times*   times = nullptr) {
+  return benchmark_batch_fixture_run_frame(
+      fixture,
+      record,
+      [](SDL_GPUCommandBuffer*, SDL_GPURenderPass*) {},
+      times);
+}
+
+// -- Font Atlas Load -----------------------------------------------------------
+
+static void benchmark_font_atlas_load(const std::string& base_path, SDL_GPUDevice* device) {
+  SDL_assert(device != nullptr);
+
+  static constexpr int ITERATIONS = 10;
+
+  using Load_Func = bool (*)(Font_Atlas*, const std::string&, const char*, Font_Atlas_Texels*);
+  struct Load_Path {
+    const char* name;
+    Load_Func   load;
+  };
+  static constexpr Load_Path load_paths[] = {
+      {"json + png", font_atlas_load_json},
+      {"bundle", font_atlas_load_bundle},
+  };
+
+  Font_Atlas_Array array = {};
+  if (!font_atlas_array_create(&array, device, 1)) { return; }
+  defer(font_atlas_array_destroy(&array, device));
+
+  Upload_Scheduler upload_scheduler = {};
+  upload_scheduler_create(&upload_scheduler, device);
+  defer(upload_scheduler_destroy(&upload_scheduler));
+
+  SDL_Log("-- Font atlas load (%d iterations) --", ITERATIONS);
+  for (int kind = 0; kind < FONT_ATLAS_KIND_BAKED_COUNT; kind++) {
+    for (const auto& load_path : load_paths) {
+      double cpu_ms   = 0.0;
+      double total_ms = 0.0;
+      for (int i = 0; i < ITERATIONS; i++) {
+        auto start_counter = SDL_GetPerformanceCounter();
+
+        Font_Atlas        font_atlas = {};
+        Font_Atlas_Texels texels;
+        if (!load_path.load(&font_atlas, base_path, FONT_ATLAS_KIND_NAMES[kind], &texels)) {
+          SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font atlas");
+          return;
+        }
+        cpu_ms += benchmark_elapsed_ms(start_counter);
+
+        // Every iteration reuses the same layer and glyph metrics entries.
+        font_atlas.layer          = 0;
+        font_atlas.layers_count   = 1;
+        array.glyph_metrics_count = 0;
+
+        auto cmd_buf  = SDL_AcquireGPUCommandBuffer(device);
+        bool uploaded = font_atlas_upload(&font_atlas, texels, &array, &upload_scheduler);
+        upload_scheduler_flush(&upload_scheduler, cmd_buf);
+        upload_scheduler_submit(&upload_scheduler, cmd_buf);
+        SDL_WaitForGPUIdle(device);
+        font_atlas_texels_release(&texels);
+        total_ms += benchmark_elapsed_ms(start_counter);
+
+        if (!uploaded) { return; }
+      }
+
+      SDL_Log(
+          "%-16s %-12s cpu %8.3f ms   cpu + upload %8.3f ms",
+          FONT_ATLAS_KIND_NAMES[kind],
+          load_path.name,
+          cpu_ms / ITERATIONS,
+          total_ms / ITERATIONS);
+    }
+  }
+}
+
+// -- Glyph Lookup ----------------------------------------------------------------
+
+// Measures layout throughput (glyphs per second) of the lorem ipsum demo text through the flat glyph
+// table, against hashed glyph and kerning lookups.
+static void benchmark_glyph_lookup(const Font_Atlas& font_atlas) {
+  static constexpr int   ITERATIONS = 200;
+  static constexpr float SIZE       = 72.0f;
+
+  const auto&                         font_data = font_atlas.variants[0];
+  std::unordered_map<int, Font_Glyph> hashed_glyphs;
+  for (const auto& glyph : font_data.glyphs) { hashed_glyphs[glyph.unicode] = glyph; }
+  std::unordered_map<uint64_t, float> hashed_kernings;
+  for (const auto& kerning : font_data.kernings) {
+    hashed_kernings[font_atlas_pack_kerning(kerning.unicode1, kerning.unicode2)] = kerning.advance;
+  }
+
+  auto hashed_string_width = [&](std::string_view text) {
+    float       width          = 0.0f;
+    const char* ptr            = text.data();
+    auto        str_size       = text.size();
+    int         codepoint      = SDL_INVALID_UNICODE_CODEPOINT;
+    int         prev_codepoint = 0;
+    while (codepoint != 0) {
+      codepoint = SDL_StepUTF8(&ptr, &str_size);
+      if (codepoint == SDL_INVALID_UNICODE_CODEPOINT) { continue; }
+
+      auto glyph_it = hashed_glyphs.find(codepoint);
+      if (glyph_it == hashed_glyphs.end()) { continue; }
+
+      if (prev_codepoint != 0) {
+        auto kerning_it = hashed_kernings.find(font_atlas_pack_kerning(prev_codepoint, codepoint));
+        if (kerning_it != hashed_kernings.end()) { width += kerning_it->second * SIZE; }
+      }
+      prev_codepoint = codepoint;
+
+      width += glyph_it->second.horizontal_advance * SIZE;
+    }
+    return width;
+  };
+
+  std::string_view text        = demo_string_lorem_ipsum;
+  int64_t          glyph_count = 0;
+  {
+    const char* ptr      = text.data();
+    auto        str_size = text.size();
+    while (SDL_StepUTF8(&ptr, &str_size) != 0) { glyph_count += 1; }
+  }
+
+  volatile float sink = 0.0f;
+
+  auto start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) { sink = sink + hashed_string_width(text); }
+  double hashed_ms = benchmark_elapsed_ms(start_counter);
+
+  start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) { sink = sink + font_atlas_string_width(font_data, text, SIZE); }
+  double flat_ms = benchmark_elapsed_ms(start_counter);
+
+  SDL_Log("-- Glyph lookup (lorem ipsum layout, %d iterations) --", ITERATIONS);
+  SDL_Log(
+      "hashed         %8.2f Mglyphs/s",
+      glyph_count * ITERATIONS / (hashed_ms * 1000.0));
+  SDL_Log(
+      "flat tables    %8.2f Mglyphs/s",
+      glyph_count * ITERATIONS / (flat_ms * 1000.0));
+}
+
+// -- UTF-8 Decode ----------------------------------------------------------------
+
+// Reports UTF-8 decode and ASCII scan throughput for every SIMD level the CPU supports, against
+// stepping through the text with SDL_StepUTF8, for the ASCII lorem ipsum text and a copy of it
+// with some accented and greek letters.
+static void benchmark_utf8_decode() {
+  static constexpr int ITERATIONS = 200;
+
+  // Every fourth e becomes an e acute and every fourth a an alpha.
+  std::string ascii_text = demo_string_lorem_ipsum;
+  std::string mixed_text;
+  int         e_count    = 0;
+  int         a_count    = 0;
+  for (auto c : ascii_text) {
+    if (c == 'e' && e_count++ % 4 == 0) {
+      mixed_text += "\xC3\xA9";
+    } else if (c == 'a' && a_count++ % 4 == 0) {
+      mixed_text += "\xCE\xB1";
+    } else {
+      mixed_text += c;
+    }
+  }
+
+  const std::string* texts[]      = {&ascii_text, &mixed_text};
+  const char*        text_names[] = {"ascii", "mixed"};
+
+  SDL_Log("-- UTF-8 decode (%d iterations) --", ITERATIONS);
+  for (int t = 0; t < SDL_arraysize(texts); t++) {
+    const auto&     text = *texts[t];
+    volatile size_t sink = 0;
+    auto            gb_per_s = [&](double runtime_ms) {
+      return static_cast<double>(text.size()) * ITERATIONS / (runtime_ms * 1000.0 * 1000.0);
+    };
+
+    auto start_counter = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++) {
+      const char* ptr              = text.data();
+      auto        str_size         = text.size();
+      size_t      codepoints_count = 0;
+      while (SDL_StepUTF8(&ptr, &str_size) != 0) { codepoints_count += 1; }
+      sink = sink + codepoints_count;
+    }
+    double step_ms = benchmark_elapsed_ms(start_counter);
+
+    SDL_Log("%s text (%d bytes)", text_names[t], static_cast<int>(text.size()));
+    SDL_Log("SDL_StepUTF8  decode %6.2f GB/s", gb_per_s(step_ms));
+    for (int level = 0; level <= simd_best_level(); level++) {
+      auto simd_level = static_cast<Simd_Level>(level);
+
+      uint32_t codepoints[UTF8_DECODE_BLOCK_SIZE];
+      start_counter = SDL_GetPerformanceCounter();
+      for (int i = 0; i < ITERATIONS; i++) {
+        std::string_view rest             = text;
+        size_t           codepoints_count = 0;
+        while (!rest.empty()) {
+          codepoints_count +=
+              utf8_decode_block(&rest, codepoints, UTF8_DECODE_BLOCK_SIZE, simd_level);
+        }
+        sink = sink + codepoints_count;
+      }
+      double decode_ms = benchmark_elapsed_ms(start_counter);
+
+      if (t != 0) {
+        SDL_Log("%-13s decode %6.2f GB/s", SIMD_LEVEL_NAMES[level], gb_per_s(decode_ms));
+        continue;
+      }
+
+      // ASCII text skips decoding, only the scan telling it apart is left.
+      start_counter = SDL_GetPerformanceCounter();
+      for (int i = 0; i < ITERATIONS; i++) {
+        sink = sink + utf8_ascii_prefix_size(text.data(), text.size(), simd_level);
+      }
+      double ascii_ms = benchmark_elapsed_ms(start_counter);
+
+      SDL_Log(
+          "%-13s decode %6.2f GB/s  ascii scan %6.2f GB/s",
+          SIMD_LEVEL_NAMES[level],
+          gb_per_s(decode_ms),
+          gb_per_s(ascii_ms));
+    }
+  }
+}
+
+// -- Kerning Lookup --------------------------------------------------------------
+
+// Reports memory use and lookup throughput of the dense and class-pair kerning tables for every
+// variant of an atlas, over the adjacent glyph pairs of the lorem ipsum demo text.
+static void benchmark_kerning_lookup(const Font_Atlas& font_atlas, const char* atlas_name) {
+  static constexpr int ITERATIONS = 200;
+
+  SDL_Log("-- Kerning lookup (%s, lorem ipsum pairs, %d iterations) --", atlas_name, ITERATIONS);
+  for (size_t variant_index = 0; variant_index < font_atlas.variants.size(); variant_index++) {
+    const auto& font_data = font_atlas.variants[variant_index];
+
+    std::vector<uint16_t> glyph_indices;
+    {
+      std::string_view text     = demo_string_lorem_ipsum;
+      const char*      ptr      = text.data();
+      auto             str_size = text.size();
+      int              codepoint;
+      while ((codepoint = SDL_StepUTF8(&ptr, &str_size)) != 0) {
+        auto glyph_index = font_variant_find_glyph_index(font_data, codepoint);
+        if (glyph_index != FONT_GLYPH_INDEX_NONE) { glyph_indices.push_back(glyph_index); }
+      }
+    }
+    if (glyph_indices.size() < 2) { continue; }
+    auto pairs_count = static_cast<int64_t>(glyph_indices.size() - 1);
+
+    std::unordered_map<uint64_t, float> hashed_kernings;
+    for (const auto& kerning : font_data.kernings) {
+      hashed_kernings[font_atlas_pack_kerning(kerning.unicode1, kerning.unicode2)] = kerning.advance;
+    }
+    size_t hashed_bytes = hashed_kernings.bucket_count() * sizeof(void*) +
+                          hashed_kernings.size() * (sizeof(uint64_t) + sizeof(float) + 2 * sizeof(void*));
+
+    volatile float sink = 0.0f;
+
+    auto start_counter = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++) {
+      float sum = 0.0f;
+      for (int64_t j = 0; j < pairs_count; j++) {
+        auto key = font_atlas_pack_kerning(
+            font_data.glyphs[glyph_indices[j]].unicode,
+            font_data.glyphs[glyph_indices[j + 1]].unicode);
+        auto it = hashed_kernings.find(key);
+        if (it != hashed_kernings.end()) { sum += it->second; }
+      }
+      sink = sink + sum;
+    }
+    double hashed_ms = benchmark_elapsed_ms(start_counter);
+    SDL_Log(
+        "variant %d  hashed   %8zu bytes  %8.2f Mlookups/s",
+        static_cast<int>(variant_index),
+        hashed_bytes,
+        pairs_count * ITERATIONS / (hashed_ms * 1000.0));
+
+    for (auto kind : {FONT_KERNING_KIND_DENSE, FONT_KERNING_KIND_CLASSES}) {
+      Font_Kerning_Table table;
+      font_kerning_table_build(&table, font_data, kind);
+
+      start_counter = SDL_GetPerformanceCounter();
+      for (int i = 0; i < ITERATIONS; i++) {
+        float sum = 0.0f;
+        for (int64_t j = 0; j < pairs_count; j++) {
+          sum += font_kerning_table_lookup(table, glyph_indices[j], glyph_indices[j + 1]);
+        }
+        sink = sink + sum;
+      }
+      double table_ms = benchmark_elapsed_ms(start_counter);
+      SDL_Log(
+          "variant %d  %-8s %8zu bytes  %8.2f Mlookups/s  (%d x %d)",
+          static_cast<int>(variant_index),
+          table.kind == FONT_KERNING_KIND_DENSE     ? "dense"
+          : table.kind == FONT_KERNING_KIND_CLASSES ? "classes"
+                                                    : "pairs",
+          font_kerning_table_memory_size(table),
+          pairs_count * ITERATIONS / (table_ms * 1000.0),
+          table.left_count,
+          table.right_count);
+    }
+  }
+}
+
+// -- Glyph Emission --------------------------------------------------------------
+
+// Per-glyph cost of emitting instances for a 64k glyph frame: instances carrying their glyph
+// bounds, normalized and reordered at emission time versus precomputed at load time, and compact
+// Text_Batch_Instances which only carry a glyph metrics index.
+static void benchmark_glyph_emission(const Font_Atlas& font_atlas) {
+  static constexpr int   ITERATIONS       = 100;
+  static constexpr int   GLYPHS_PER_FRAME = 64 * 1024;
+  static constexpr float SIZE             = 72.0f;
+
+  const auto& font_data = font_atlas.variants[0];
+
+  struct Raw_Glyph {
+    Font_Glyph_Bounds plane_bounds;
+    Font_Glyph_Bounds atlas_bounds;
+    float             horizontal_advance;
+  };
+  std::vector<Raw_Glyph> raw_glyphs;
+  for (const auto& glyph : font_data.glyphs) {
+    auto& raw_glyph               = raw_glyphs.emplace_back();
+    raw_glyph.plane_bounds.left   = glyph.plane_bounds.X;
+    raw_glyph.plane_bounds.top    = glyph.plane_bounds.Y;
+    raw_glyph.plane_bounds.right  = glyph.plane_bounds.Z;
+    raw_glyph.plane_bounds.bottom = glyph.plane_bounds.W;
+    raw_glyph.atlas_bounds.left   = glyph.atlas_bounds.X * font_atlas.width;
+    raw_glyph.atlas_bounds.top    = (1.0f - glyph.atlas_bounds.Y) * font_atlas.height;
+    raw_glyph.atlas_bounds.right  = glyph.atlas_bounds.Z * font_atlas.width;
+    raw_glyph.atlas_bounds.bottom = (1.0f - glyph.atlas_bounds.W) * font_atlas.height;
+    raw_glyph.horizontal_advance  = glyph.horizontal_advance;
+  }
+
+  std::vector<uint16_t> glyph_indices;
+  {
+    std::string_view text     = demo_string_lorem_ipsum;
+    const char*      ptr      = text.data();
+    auto             str_size = text.size();
+    int              codepoint;
+    while ((codepoint = SDL_StepUTF8(&ptr, &str_size)) != 0) {
+      auto glyph_index = font_variant_find_glyph_index(font_data, codepoint);
+      if (glyph_index != FONT_GLYPH_INDEX_NONE && codepoint != 32) {
+        glyph_indices.push_back(glyph_index);
+      }
+    }
+  }
+  if (glyph_indices.empty()) { return; }
+  while (glyph_indices.size() < GLYPHS_PER_FRAME) {
+    glyph_indices.insert(glyph_indices.end(), glyph_indices.begin(), glyph_indices.end());
+  }
+  glyph_indices.resize(GLYPHS_PER_FRAME);
+
+  // Instance format from before the glyph metrics table.
+  struct Bounds_Instance {
+    HMM_Vec3 position;
+    float    size;
+    HMM_Vec4 color;
+    HMM_Vec4 plane_bounds;
+    HMM_Vec4 atlas_bounds;
+  };
+  std::vector<Bounds_Instance> instances(GLYPHS_PER_FRAME);
+  HMM_Vec4                     color = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f);
+
+  auto start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) {
+    HMM_Vec3 position     = HMM_V3(0.0f, 0.0f, 0.0f);
+    float    atlas_width  = static_cast<float>(font_atlas.width);
+    float    atlas_height = static_cast<float>(font_atlas.height);
+    for (int j = 0; j < GLYPHS_PER_FRAME; j++) {
+      const auto& glyph      = raw_glyphs[glyph_indices[j]];
+      auto&       instance   = instances[j];
+      instance.position      = position;
+      instance.size          = SIZE;
+      instance.color         = color;
+      instance.plane_bounds  = HMM_V4(
+          glyph.plane_bounds.left,
+          glyph.plane_bounds.top,
+          glyph.plane_bounds.right,
+          glyph.plane_bounds.bottom);
+      instance.atlas_bounds = HMM_V4(
+          glyph.atlas_bounds.left / atlas_width,
+          1.0f - glyph.atlas_bounds.top / atlas_height,
+          glyph.atlas_bounds.right / atlas_width,
+          1.0f - glyph.atlas_bounds.bottom / atlas_height);
+      position.X += glyph.horizontal_advance * SIZE;
+    }
+  }
+  double runtime_ms = benchmark_elapsed_ms(start_counter);
+  volatile float sink = instances[GLYPHS_PER_FRAME - 1].atlas_bounds.X;
+
+  start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) {
+    HMM_Vec3 position = HMM_V3(0.0f, 0.0f, 0.0f);
+    for (int j = 0; j < GLYPHS_PER_FRAME; j++) {
+      const auto& glyph     = font_data.glyphs[glyph_indices[j]];
+      auto&       instance  = instances[j];
+      instance.position     = position;
+      instance.size         = SIZE;
+      instance.color        = color;
+      instance.plane_bounds = glyph.plane_bounds;
+      instance.atlas_bounds = glyph.atlas_bounds;
+      position.X += glyph.horizontal_advance * SIZE;
+    }
+  }
+  double precomputed_ms = benchmark_elapsed_ms(start_counter);
+  sink                  = sink + instances[GLYPHS_PER_FRAME - 1].atlas_bounds.X;
+
+  std::vector<Text_Batch_Instance> compact_instances(GLYPHS_PER_FRAME);
+  start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) {
+    HMM_Vec2 position     = HMM_V2(0.0f, 0.0f);
+    auto     packed_size  = float_to_half(SIZE);
+    auto     packed_color = pack_color_rgba8(color);
+    for (int j = 0; j < GLYPHS_PER_FRAME; j++) {
+      auto        glyph_index = glyph_indices[j];
+      const auto& glyph       = font_data.glyphs[glyph_index];
+      auto&       instance    = compact_instances[j];
+      instance.position       = position;
+      instance.glyph          = static_cast<uint16_t>(font_data.glyph_metrics_offset + glyph_index);
+      instance.size           = packed_size;
+      instance.color          = packed_color;
+      position.X += glyph.horizontal_advance * SIZE;
+    }
+  }
+  double compact_ms = benchmark_elapsed_ms(start_counter);
+  sink              = sink + compact_instances[GLYPHS_PER_FRAME - 1].position.X;
+
+  SDL_Log("-- Glyph emission (%d glyphs per frame) --", GLYPHS_PER_FRAME);
+  SDL_Log(
+      "normalized per frame  %6.2f ns/glyph  %6.3f ms/frame",
+      runtime_ms * 1e6 / (static_cast<double>(ITERATIONS) * GLYPHS_PER_FRAME),
+      runtime_ms / ITERATIONS);
+  SDL_Log(
+      "precomputed at load   %6.2f ns/glyph  %6.3f ms/frame",
+      precomputed_ms * 1e6 / (static_cast<double>(ITERATIONS) * GLYPHS_PER_FRAME),
+      precomputed_ms / ITERATIONS);
+  SDL_Log(
+      "compact instances     %6.2f ns/glyph  %6.3f ms/frame",
+      compact_ms * 1e6 / (static_cast<double>(ITERATIONS) * GLYPHS_PER_FRAME),
+      compact_ms / ITERATIONS);
+}
+
+// -- Dynamic Glyphs --------------------------------------------------------------
+
+// Generates every glyph of the baked Roboto atlas with the runtime MSDF generator and compares the
+// two distance fields in em space: mean absolute distance difference (in atlas pixels) near the
+// outline, and how many texels away from the outline agree on inside/outside. Returns false if a
+// variant has nothing to compare or is outside of the tolerances.
+static bool
+benchmark_dynamic_glyphs(const Font_Atlas& dynamic_atlas, const std::string& base_path) {
+  SDL_assert(dynamic_atlas.dynamic != nullptr);
+
+  // Resampling the baked atlas alone accounts for about 0.06 pixels of distance error.
+  static constexpr float MIN_SIGN_AGREEMENT      = 0.99f;
+  static constexpr float MAX_MEAN_DISTANCE_ERROR = 0.25f;
+
+  Font_Atlas        baked_atlas = {};
+  Font_Atlas_Texels texels;
+  if (!font_atlas_load_cpu(&baked_atlas, FONT_ATLAS_KIND_ROBOTO, base_path, &texels)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font atlas");
+    return false;
+  }
+  defer(font_atlas_texels_release(&texels));
+
+  auto sample_baked = [&](float x, float y) {
+    x            = SDL_clamp(x - 0.5f, 0.0f, baked_atlas.width - 1.0f);
+    y            = SDL_clamp(y - 0.5f, 0.0f, baked_atlas.height - 1.0f);
+    int   x0     = static_cast<int>(x);
+    int   y0     = static_cast<int>(y);
+    int   x1     = SDL_min(x0 + 1, baked_atlas.width - 1);
+    int   y1     = SDL_min(y0 + 1, baked_atlas.height - 1);
+    float fx     = x - x0;
+    float fy     = y - y0;
+    float rgb[3] = {};
+    auto  texel  = [&](int tx, int ty, int c) {
+      return texels.data[(static_cast<size_t>(ty) * baked_atlas.width + tx) * 4 + c] / 255.0f;
+    };
+    for (int c = 0; c < 3; c++) {
+      float top    = texel(x0, y0, c) + (texel(x1, y0, c) - texel(x0, y0, c)) * fx;
+      float bottom = texel(x0, y1, c) + (texel(x1, y1, c) - texel(x0, y1, c)) * fx;
+      rgb[c]       = top + (bottom - top) * fy;
+    }
+    return msdf_median(rgb[0], rgb[1], rgb[2]);
+  };
+
+  SDL_Log("-- Dynamic glyphs (generated vs baked roboto) --");
+  bool within_tolerances = true;
+  auto variants_count =
+      SDL_min(dynamic_atlas.dynamic->fonts.size(), baked_atlas.variants.size());
+  for (size_t variant_index = 0; variant_index < variants_count; variant_index++) {
+    const auto& font      = dynamic_atlas.dynamic->fonts[variant_index];
+    const auto& font_data = baked_atlas.variants[variant_index];
+
+    int     glyphs_count     = 0;
+    double  generate_ms      = 0.0;
+    double  distance_error   = 0.0;
+    int64_t distance_samples = 0;
+    int64_t sign_agreements  = 0;
+    int64_t sign_samples     = 0;
+    auto    distance_range   = dynamic_atlas.distance_range;
+    auto    size             = dynamic_atlas.size;
+    for (const auto& glyph : font_data.glyphs) {
+      const auto& plane_bounds = glyph.plane_bounds;
+      const auto& atlas_bounds = glyph.atlas_bounds;
+      if (plane_bounds.X == plane_bounds.Z) { continue; }
+
+      auto                         ttf_glyph = stbtt_FindGlyphIndex(&font.info, glyph.unicode);
+      Font_Atlas_Dynamic_Glyph_Box box;
+      if (!font_atlas_dynamic_glyph_box(font, ttf_glyph, &box)) { continue; }
+
+      std::vector<uint8_t> generated(static_cast<size_t>(box.width) * box.height * 4);
+      auto                 start_counter = SDL_GetPerformanceCounter();
+      font_atlas_dynamic_generate_glyph(font, ttf_glyph, box, generated.data());
+      generate_ms += benchmark_elapsed_ms(start_counter);
+      glyphs_count += 1;
+
+      for (int y = 0; y < box.height; y++) {
+        for (int x = 0; x < box.width; x++) {
+          float em_x = (box.x + x + 0.5f) / size;
+          float em_y = (box.y + box.height - y - 0.5f) / size;
+          if (em_x < plane_bounds.X || em_x > plane_bounds.Z || em_y > plane_bounds.Y ||
+              em_y < plane_bounds.W) {
+            continue;
+          }
+
+          float u = atlas_bounds.X + (em_x - plane_bounds.X) / (plane_bounds.Z - plane_bounds.X) *
+                                         (atlas_bounds.Z - atlas_bounds.X);
+          float v = atlas_bounds.Y + (plane_bounds.Y - em_y) / (plane_bounds.Y - plane_bounds.W) *
+                                         (atlas_bounds.W - atlas_bounds.Y);
+          float baked_distance =
+              (sample_baked(u * baked_atlas.width, v * baked_atlas.height) - 0.5f) *
+              baked_atlas.distance_range;
+
+          auto  texel = &generated[(static_cast<size_t>(y) * box.width + x) * 4];
+          float generated_distance =
+              (msdf_median(texel[0], texel[1], texel[2]) / 255.0f - 0.5f) * distance_range;
+
+          if (SDL_fabsf(baked_distance) < distance_range * 0.5f) {
+            distance_error += SDL_fabsf(generated_distance - baked_distance);
+            distance_samples += 1;
+          }
+          if (SDL_fabsf(baked_distance) > 0.5f && SDL_fabsf(generated_distance) > 0.5f) {
+            sign_agreements += (baked_distance > 0.0f) == (generated_distance > 0.0f) ? 1 : 0;
+            sign_samples += 1;
+          }
+        }
+      }
+    }
+    if (glyphs_count == 0 || distance_samples == 0 || sign_samples == 0) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Variant %d has no generated glyphs to compare with the baked atlas",
+          static_cast<int>(variant_index));
+      within_tolerances = false;
+      continue;
+    }
+
+    double mean_distance_error = distance_error / distance_samples;
+    double sign_agreement      = static_cast<double>(sign_agreements) / sign_samples;
+    SDL_Log(
+        "variant %d  %3d glyphs  %6.3f ms/glyph  mean distance error %5.3f px  inside/outside "
+        "agreement %7.3f%%",
+        static_cast<int>(variant_index),
+        glyphs_count,
+        generate_ms / glyphs_count,
+        mean_distance_error,
+        sign_agreement * 100.0);
+    if (sign_agreement < MIN_SIGN_AGREEMENT || mean_distance_error > MAX_MEAN_DISTANCE_ERROR) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Generated glyphs of variant %d disagree with the baked atlas: at most %.3f px mean "
+          "distance error and at least %.1f%% inside/outside agreement allowed",
+          static_cast<int>(variant_index),
+          MAX_MEAN_DISTANCE_ERROR,
+          MIN_SIGN_AGREEMENT * 100.0f);
+      within_tolerances = false;
+    }
+  }
+
+  return within_tolerances;
+}
+
+// -- Glyph Cache ---------------------------------------------------------------
+
+// Drives a separate dynamic atlas with a synthetic stream of codepoints, drawn with a zipf
+// distribution over Latin, Greek and Cyrillic whose hot set shifts every few hundred frames, like
+// chat or a language switch would. Then every variant streams through more unique codepoints than
+// it has glyph slots, each drawn once, so late codepoints only resolve if the slots of evicted
+// glyphs are reused. Codepoints the font lacks share .notdef. Glyph generation is waited on every
+// frame so the results don't depend on the worker speed. Checks that no two resident glyphs
+// overlap, that every late codepoint resolves and that no freed glyph is still reachable when done,
+// returns false if not.
+static bool benchmark_glyph_cache(
+    const std::string& base_path,
+    SDL_GPUDevice*     device,
+    Thread_Pool*       thread_pool) {
+  SDL_assert(device != nullptr);
+  SDL_assert(thread_pool != nullptr);
+
+  static constexpr int FRAMES                = 1200;
+  static constexpr int FRAMES_PER_EPOCH      = 300;
+  static constexpr int GLYPHS_PER_FRAME      = 64;
+  static constexpr int EPOCH_HOT_SET_SHIFT   = 150;
+  static constexpr int CODEPOINT_RANGES[][2] = {{0x21, 0x17F}, {0x391, 0x3C9}, {0x400, 0x45F}};
+  static constexpr int STREAM_CODEPOINTS     = 2 * FONT_ATLAS_DYNAMIC_MAX_GLYPHS;
+  static constexpr int STREAM_FIRST          = 0x180;
+  static constexpr int STREAM_PER_FRAME      = 16;
+
+  Font_Atlas_Array array = {};
+  if (!font_atlas_array_create(&array, device, FONT_ATLAS_DYNAMIC_LAYERS_COUNT)) { return false; }
+  defer(font_atlas_array_destroy(&array, device));
+
+  Upload_Scheduler upload_scheduler = {};
+  upload_scheduler_create(&upload_scheduler, device);
+  defer(upload_scheduler_destroy(&upload_scheduler));
+
+  Font_Atlas font_atlas = {};
+  defer(font_atlas_dynamic_destroy(&font_atlas, device));
+  if (!font_atlas_dynamic_create(
+          &font_atlas,
+          base_path,
+          FONT_ATLAS_DYNAMIC_ROBOTO_FILES,
+          FONT_ATLAS_ROBOTO_VARIANT_COUNT,
+          &array,
+          0,
+          device,
+          thread_pool)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create dynamic font atlas");
+    return false;
+  }
+  auto dynamic = font_atlas.dynamic;
+
+  std::vector<int> codepoints;
+  for (const auto& range : CODEPOINT_RANGES) {
+    for (int codepoint = range[0]; codepoint <= range[1]; codepoint++) {
+      codepoints.push_back(codepoint);
+    }
+  }
+  std::vector<double> cdf(codepoints.size() * font_atlas.variants.size());
+  double              weight_sum = 0.0;
+  for (size_t i = 0; i < cdf.size(); i++) {
+    weight_sum += 1.0 / static_cast<double>(i + 1);
+    cdf[i] = weight_sum;
+  }
+
+  auto draw_glyph = [&](int font_variant, int codepoint) {
+    auto& variant     = font_atlas.variants[font_variant];
+    auto  glyph_index = font_variant_find_glyph_index(variant, codepoint);
+    if (glyph_index == FONT_GLYPH_INDEX_NONE) {
+      glyph_index = font_atlas_dynamic_request_glyph(&font_atlas, font_variant, codepoint);
+      if (glyph_index == FONT_GLYPH_INDEX_NONE) { return false; }
+    }
+    font_atlas_dynamic_use_glyph(&font_atlas, font_variant, glyph_index);
+    return true;
+  };
+
+  double update_ms = 0.0;
+  auto   end_frame = [&]() {
+    thread_pool_wait(thread_pool);
+
+    auto cmd_buf = SDL_AcquireGPUCommandBuffer(device);
+    if (cmd_buf == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to acquire command buffer: %s",
+          SDL_GetError());
+      return false;
+    }
+    auto start_counter = SDL_GetPerformanceCounter();
+    font_atlas_dynamic_update(&font_atlas, &upload_scheduler);
+    upload_scheduler_flush(&upload_scheduler, cmd_buf);
+    update_ms += benchmark_elapsed_ms(start_counter);
+    upload_scheduler_submit(&upload_scheduler, cmd_buf);
+    return true;
+  };
+
+  Uint64 random_state = 0x5eed;
+  for (int frame = 0; frame < FRAMES; frame++) {
+    int shift = (frame / FRAMES_PER_EPOCH) * EPOCH_HOT_SET_SHIFT;
+    for (int i = 0; i < GLYPHS_PER_FRAME; i++) {
+      auto   sample = SDL_randf_r(&random_state) * weight_sum;
+      size_t rank   = std::lower_bound(cdf.begin(), cdf.end(), sample) - cdf.begin();
+      rank          = (SDL_min(rank, cdf.size() - 1) + shift) % cdf.size();
+
+      int font_variant = static_cast<int>(rank % font_atlas.variants.size());
+      draw_glyph(font_variant, codepoints[rank / font_atlas.variants.size()]);
+    }
+    if (!end_frame()) { return false; }
+  }
+  int used_area = 0;
+  for (const auto& page : dynamic->pages) { used_area += page.used_area; }
+  auto lookups_count = dynamic->hits_count + dynamic->misses_count;
+
+  SDL_Log(
+      "-- Glyph cache (%d frames, %d glyphs per frame, %d codepoints x %d variants) --",
+      FRAMES,
+      GLYPHS_PER_FRAME,
+      static_cast<int>(codepoints.size()),
+      static_cast<int>(font_atlas.variants.size()));
+  SDL_Log(
+      "hit rate %6.2f%%  generated %d  evicted %" SDL_PRIu64 "  compacted pages %" SDL_PRIu64,
+      lookups_count > 0 ? 100.0 * dynamic->hits_count / lookups_count : 0.0,
+      dynamic->generated_glyphs_count,
+      dynamic->evicted_glyphs_count,
+      dynamic->compacted_pages_count);
+  SDL_Log(
+      "resident %d  occupancy %5.1f%%  update %6.3f ms/frame",
+      dynamic->resident_glyphs_count,
+      100.0 * used_area / (static_cast<double>(font_atlas.width) * font_atlas.height),
+      update_ms / FRAMES);
+
+  // Codepoints past the first FONT_ATLAS_DYNAMIC_MAX_GLYPHS of a variant are the late ones.
+  int late_count    = 0;
+  int late_resolved = 0;
+  for (int streamed = 0; streamed < STREAM_CODEPOINTS; streamed += STREAM_PER_FRAME) {
+    for (size_t i = 0; i < font_atlas.variants.size(); i++) {
+      for (int j = streamed; j < streamed + STREAM_PER_FRAME; j++) {
+        bool resolved = draw_glyph(static_cast<int>(i), STREAM_FIRST + j);
+        if (j < FONT_ATLAS_DYNAMIC_MAX_GLYPHS) { continue; }
+        late_count += 1;
+        late_resolved += resolved ? 1 : 0;
+      }
+    }
+    if (!end_frame()) { return false; }
+  }
+  SDL_WaitForGPUIdle(device);
+
+  std::vector<SDL_Rect> rects;
+  for (const auto& font : dynamic->fonts) {
+    for (size_t i = 0; i < font.glyph_states.size(); i++) {
+      if (font.glyph_states[i] == FONT_ATLAS_DYNAMIC_GLYPH_STATE_RESIDENT) {
+        rects.push_back(font.glyph_rects[i]);
+      }
+    }
+  }
+  int overlaps_count = 0;
+  for (size_t i = 0; i < rects.size(); i++) {
+    for (size_t j = i + 1; j < rects.size(); j++) {
+      overlaps_count += SDL_HasRectIntersection(&rects[i], &rects[j]) ? 1 : 0;
+    }
+  }
+
+  // Freed glyphs must be unreachable through the codepoint index and the kerning table.
+  int stale_count = 0;
+  int slots_count = 0;
+  for (size_t i = 0; i < dynamic->fonts.size(); i++) {
+    const auto& font    = dynamic->fonts[i];
+    const auto& variant = font_atlas.variants[i];
+    auto        is_free = [&](uint32_t glyph_index) {
+      return font.glyph_states[glyph_index] == FONT_ATLAS_DYNAMIC_GLYPH_STATE_FREE;
+    };
+    slots_count = SDL_max(slots_count, static_cast<int>(font.glyph_states.size()));
+    for (size_t j = 0; j < font.glyph_states.size(); j++) {
+      if (!is_free(static_cast<uint32_t>(j))) { continue; }
+      stale_count += font_variant_find_glyph_index(variant, variant.glyphs[j].unicode) == j ? 1 : 0;
+    }
+    for (auto key : variant.kerning_table.pair_keys) {
+      stale_count += is_free(key >> 16) || is_free(key & 0xFFFF) ? 1 : 0;
+    }
+  }
+
+  SDL_Log(
+      "streamed %d codepoints x %d variants  late codepoints resolved %d/%d  recycled "
+      "%" SDL_PRIu64 "  slots %d/%d",
+      STREAM_CODEPOINTS,
+      static_cast<int>(font_atlas.variants.size()),
+      late_resolved,
+      late_count,
+      dynamic->recycled_glyphs_count,
+      slots_count,
+      FONT_ATLAS_DYNAMIC_MAX_GLYPHS);
+  bool consistent = true;
+  if (overlaps_count != 0 || rects.size() != static_cast<size_t>(dynamic->resident_glyphs_count)) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Glyph cache is inconsistent: %d overlapping glyphs, %d resident glyphs tracked as %d",
+        overlaps_count,
+        static_cast<int>(rects.size()),
+        dynamic->resident_glyphs_count);
+    consistent = false;
+  }
+  if (late_resolved != late_count || stale_count != 0) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Glyph slots aren't recycled: %d late codepoints unresolved, %d stale references to freed "
+        "glyphs",
+        late_count - late_resolved,
+        stale_count);
+    consistent = false;
+  }
+
+  return consistent;
+}
+
+// -- Mixed Fonts -----------------------------------------------------------------
+
+// Records a UI-like frame of short labels, switching to the next baked font and variant for every
+// label, and logs how many draw commands the text batch needs for them. The batch is reset after,
+// nothing is drawn.
+static void benchmark_mixed_fonts(Text_Batch* text_batch, Font_Atlas* font_atlases) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(font_atlases != nullptr);
+
+  static constexpr int   ITERATIONS   = 100;
+  static constexpr int   LABELS_COUNT = 64;
+  static constexpr float SIZE         = 18.0f;
+
+  struct Label_Font {
+    Font_Atlas* font_atlas;
+    int         font_variant;
+  };
+  std::vector<Label_Font> label_fonts;
+  for (int kind = 0; kind < FONT_ATLAS_KIND_BAKED_COUNT; kind++) {
+    for (int variant = 0; variant < font_atlases[kind].variants.size(); variant++) {
+      label_fonts.push_back({&font_atlases[kind], variant});
+    }
+  }
+
+  auto transform       = HMM_M4D(1.0f);
+  int  draw_cmds_count = 0;
+  int  instances_count = 0;
+
+  auto start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) {
+    for (int j = 0; j < LABELS_COUNT; j++) {
+      const auto& label_font = label_fonts[j % label_fonts.size()];
+      text_batch_begin_basic(
+          text_batch,
+          transform,
+          label_font.font_atlas,
+          label_font.font_variant);
+      text_batch_draw(
+          text_batch,
+          "Label",
+          HMM_V3(0.0f, static_cast<float>(j) * SIZE, 0.0f),
+          SIZE);
+      text_batch_end(text_batch);
+    }
+    draw_cmds_count = static_cast<int>(text_batch->draw_cmds.size());
+    instances_count = text_batch->instances_count;
+    text_batch_reset(text_batch);
+  }
+  double runtime_ms = benchmark_elapsed_ms(start_counter);
+
+  SDL_Log(
+      "-- Mixed fonts (%d labels, %d fonts and variants) --",
+      LABELS_COUNT,
+      static_cast<int>(label_fonts.size()));
+  SDL_Log(
+      "draw cmds %d  instances %d  record %6.3f ms/frame",
+      draw_cmds_count,
+      instances_count,
+      runtime_ms / ITERATIONS);
+}
+
+// -- Draw Submission -------------------------------------------------------------
+
+// Records a frame of UI panels, each with an outlined title, rows of labels and an outline block
+// for the highlighted row that only one panel uses, every panel side by side at its own z position,
+// into a separate text batch. The panels don't overlap, so their blocks are order independent.
+// Logs the draws and state changes needed to render it: a draw with both uniforms per draw
+// command, the draws covering adjacent draw commands of a pipeline, and those with the draw
+// commands grouped by pipeline. Nothing is rendered.
+static void benchmark_draw_submission(
+    const std::string&      base_path,
+    const Font_Atlas_Array& font_atlas_array,
+    Font_Atlas*             font_atlas,
+    SDL_GPUDevice*          device,
+    SDL_GPUTextureFormat    target_format) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(device != nullptr);
+
+  static constexpr int   PANELS_COUNT = 32;
+  static constexpr int   ROWS_COUNT   = 8;
+  static constexpr float SIZE         = 18.0f;
+  static constexpr float PANEL_WIDTH  = 200.0f;
+
+  Benchmark_Batch_Fixture fixture = {};
+  defer(benchmark_batch_fixture_destroy(&fixture));
+  if (!benchmark_batch_fixture_create(
+          &fixture,
+          base_path,
+          font_atlas_array,
+          device,
+          target_format,
+          0)) {
+    return;
+  }
+  auto& text_batch = fixture.text_batch;
+
+  auto transform = HMM_M4D(1.0f);
+  SDL_Log("-- Draw submission (%d panels) --", PANELS_COUNT);
+  for (int sort = 0; sort < 2; sort++) {
+    text_batch.sort_draw_cmds = sort == 1;
+
+    bool submitted = benchmark_batch_fixture_run_frame(&fixture, [&]() {
+      for (int panel = 0; panel < PANELS_COUNT; panel++) {
+        auto position = HMM_V3(
+            panel * PANEL_WIDTH,
+            0.0f,
+            static_cast<float>(panel) / PANELS_COUNT);
+
+        auto outline_color = HMM_V4(0.0f, 0.0f, 0.0f, 1.0f);
+        text_batch_begin_outline(&text_batch, transform, font_atlas, 0, outline_color, 0.4f, true);
+        text_batch_draw(&text_batch, "Panel", position, SIZE * 1.5f);
+        text_batch_end(&text_batch);
+
+        text_batch_begin_basic(&text_batch, transform, font_atlas, 0, true);
+        for (int row = 0; row < ROWS_COUNT; row++) {
+          position.Y += SIZE;
+          text_batch_draw(&text_batch, "Label: 1234", position, SIZE);
+        }
+        text_batch_end(&text_batch);
+
+        auto highlight_color = HMM_V4(1.0f, 1.0f, 0.0f, 1.0f);
+        text_batch_begin_outline(
+            &text_batch,
+            transform,
+            font_atlas,
+            0,
+            highlight_color,
+            0.4f,
+            true);
+        if (panel == 0) { text_batch_draw(&text_batch, "Selected", position, SIZE); }
+        text_batch_end(&text_batch);
+      }
+
+      // Before draw parameters, every draw command was drawn with its uniforms pushed.
+      if (sort == 0) {
+        int                 draw_cmds_count      = 0;
+        int                 pipeline_binds_count = 0;
+        Text_Batch_Pipeline bound_pipeline       = {};
+        for (const auto& draw_cmd : text_batch.draw_cmds) {
+          if (draw_cmd.instances_count == 0) { continue; }
+          draw_cmds_count += 1;
+          if (draw_cmds_count == 1 || draw_cmd.pipeline != bound_pipeline) {
+            pipeline_binds_count += 1;
+            bound_pipeline        = draw_cmd.pipeline;
+          }
+        }
+        SDL_Log(
+            "per draw cmd  draws %4d  pipeline binds %4d  uniform pushes %4d",
+            draw_cmds_count,
+            pipeline_binds_count,
+            2 * draw_cmds_count);
+      }
+    });
+    if (!submitted) { return; }
+
+    const auto& stats = text_batch.stats;
+    SDL_Log(
+        "%-13s draws %4d  pipeline binds %4d  uniform pushes %4d",
+        sort == 1 ? "by pipeline" : "recorded",
+        stats.draws_count,
+        stats.pipeline_binds_count,
+        stats.uniform_pushes_count);
+  }
+  SDL_WaitForGPUIdle(device);
+}
+
+// -- Effect Batching -------------------------------------------------------------
+
+// Renders rows of labels cycling through plain and outlined text into an offscreen target, with the
+// basic and outline pipelines and with the uber pipeline, then with the uber pipeline cycling
+// through shadows and glows as well, which have no pipeline of their own. Logs the draws and
+// pipeline binds of a frame, the CPU time spent recording, preparing and submitting it, and the
+// frame time including the wait for the GPU.
+static void benchmark_effect_batching(
+    const std::string&      base_path,
+    const Font_Atlas_Array& font_atlas_array,
+    Font_Atlas*             font_atlas,
+    SDL_GPUDevice*          device,
+    SDL_GPUTextureFormat    target_format) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(device != nullptr);
+
+  static constexpr int   FRAMES                  = 100;
+  static constexpr int   ROWS_COUNT              = 512;
+  static constexpr float SIZE                    = 16.0f;
+  static constexpr int   MODES_COUNT             = 3;
+  static const char*     MODE_NAMES[MODES_COUNT] = {"split", "uber", "uber 4 fx"};
+
+  Benchmark_Batch_Fixture fixture = {};
+  defer(benchmark_batch_fixture_destroy(&fixture));
+  if (!benchmark_batch_fixture_create(
+          &fixture,
+          base_path,
+          font_atlas_array,
+          device,
+          target_format,
+          1024)) {
+    return;
+  }
+  auto& text_batch = fixture.text_batch;
+
+  Text_Batch_Style shadow_style = {};
+  shadow_style.effects          = TEXT_BATCH_EFFECT_SHADOW;
+  shadow_style.shadow_color     = HMM_V4(0.0f, 0.0f, 0.0f, 0.8f);
+  shadow_style.shadow_offset    = HMM_V2(0.2f, -0.2f);
+  shadow_style.shadow_softness  = 0.2f;
+
+  Text_Batch_Style glow_style  = {};
+  glow_style.effects           = TEXT_BATCH_EFFECT_GLOW | TEXT_BATCH_EFFECT_OUTLINE;
+  glow_style.outline_color     = HMM_V4(0.0f, 0.0f, 0.0f, 1.0f);
+  glow_style.outline_thickness = 0.2f;
+  glow_style.glow_color        = HMM_V4(1.0f, 0.8f, 0.2f, 1.0f);
+  glow_style.glow_thickness    = 0.4f;
+
+  auto transform = HMM_Orthographic_RH_NO(0.0f, 1024.0f, 1024.0f, 0.0f, -1.0f, 1.0f);
+  SDL_Log("-- Effect batching (%d rows, %d frames) --", ROWS_COUNT, FRAMES);
+  for (int mode = 0; mode < MODES_COUNT; mode++) {
+    text_batch.uber_effects = mode > 0;
+    int effects_count       = mode == 2 ? 4 : 2;
+
+    Benchmark_Frame_Times times = {};
+    for (int frame = 0; frame < FRAMES; frame++) {
+      auto record = [&]() {
+        for (int row = 0; row < ROWS_COUNT; row++) {
+          auto position = HMM_V3((row / 64) * 128.0f, (row % 64) * SIZE, 0.0f);
+          switch (row % effects_count) {
+          case 0:
+            text_batch_begin_basic(&text_batch, transform, font_atlas, 0);
+            break;
+          case 1:
+            text_batch_begin_outline(&text_batch, transform, font_atlas, 0);
+            break;
+          case 2:
+            text_batch_begin_effects(&text_batch, transform, font_atlas, 0, shadow_style);
+            break;
+          default:
+            text_batch_begin_effects(&text_batch, transform, font_atlas, 0, glow_style);
+            break;
+          }
+          text_batch_draw(&text_batch, "Label: 1234", position, SIZE);
+          text_batch_end(&text_batch);
+        }
+      };
+      if (!benchmark_batch_fixture_run_frame(&fixture, record, &times)) { return; }
+    }
+
+    const auto& stats = text_batch.stats;
+    SDL_Log(
+        "%-9s  draw cmds %4d  draws %4d  pipeline binds %4d  cpu %6.3f ms  frame %6.3f ms",
+        MODE_NAMES[mode],
+        stats.draw_cmds_count,
+        stats.draws_count,
+        stats.pipeline_binds_count,
+        times.cpu_ms / FRAMES,
+        times.frame_ms / FRAMES);
+  }
+}
+
+// -- Effect Reference ------------------------------------------------------------
+
+// Shades the glyphs of a label with the CPU reference of the uber fragment shader, from MTSDF
+// glyphs generated for the dynamic atlas, at one screen pixel per texel. Compares a soft shadow
+// drawn in the same pass as the glyph, one instance per glyph, against the glyph drawn over a
+// blurred copy of itself offset in the shadow color, two instances per glyph: the largest
+// difference within the glyph quads, and how much of the copy falls outside of them where the
+// single pass can't draw. Also logs how far the median of the MSDF channels strays from the true
+// distance within the distance range, the error an MSDF atlas makes for effects that reach away
+// from the outline. Returns false if any of them is out of bounds.
+static bool benchmark_effect_reference(const Font_Atlas& dynamic_atlas) {
+  SDL_assert(dynamic_atlas.dynamic != nullptr);
+
+  static constexpr const char* TEXT = "Shadow & Glow";
+
+  // The passes only differ by float rounding, and the glyph padding has to hold the whole copy
+  // for the single pass to draw it. The median strays the most near corners, where MSDF channels
+  // disagree, so its largest error is allowed to be much higher than its mean.
+  static constexpr double MAX_SHADOW_DIFFERENCE = 1e-4;
+  static constexpr double MAX_COPY_OUTSIDE      = 0.01;
+  static constexpr double MAX_MEAN_MEDIAN_ERROR = 0.05;
+  static constexpr double MAX_MEDIAN_ERROR      = 1.0;
+
+  const auto& font           = dynamic_atlas.dynamic->fonts[0];
+  float       distance_range = dynamic_atlas.distance_range;
+  auto        text_color     = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f);
+
+  Text_Batch_Style style = {};
+  style.effects          = TEXT_BATCH_EFFECT_SHADOW;
+  style.shadow_color     = HMM_V4(0.0f, 0.0f, 0.0f, 0.8f);
+  style.shadow_offset    = HMM_V2(0.5f, 0.5f);
+  style.shadow_softness  = 0.5f;
+
+  // The copy of the glyph drawn as its shadow, blurred by the shadow softness.
+  Text_Batch_Style copy_style = {};
+  copy_style.effects          = TEXT_BATCH_EFFECT_BLUR;
+  copy_style.blur_radius      = style.shadow_softness;
+
+  int     glyphs_count          = 0;
+  double  max_difference        = 0.0;
+  double  copy_coverage         = 0.0;
+  double  copy_coverage_outside = 0.0;
+  double  median_error          = 0.0;
+  double  max_median_error      = 0.0;
+  int64_t median_samples        = 0;
+  auto    offset                = style.shadow_offset * distance_range;
+  int     margin                = static_cast<int>(SDL_ceilf(HMM_LenV2(offset)));
+  auto    start_counter         = SDL_GetPerformanceCounter();
+  for (const char* c = TEXT; *c != '\0'; c++) {
+    auto                         ttf_glyph = stbtt_FindGlyphIndex(&font.info, *c);
+    Font_Atlas_Dynamic_Glyph_Box box;
+    if (!font_atlas_dynamic_glyph_box(font, ttf_glyph, &box)) { continue; }
+
+    std::vector<uint8_t> texels(static_cast<size_t>(box.width) * box.height * 4);
+    font_atlas_dynamic_generate_glyph(font, ttf_glyph, box, texels.data());
+    glyphs_count += 1;
+
+    // Bilinear sample at texel coordinates, y down from the top row, clamped to the glyph's texel
+    // centers like the shader clamps its shadow to the glyph's atlas bounds.
+    auto sample = [&](HMM_Vec2 p) {
+      float x     = SDL_clamp(p.X, 0.5f, box.width - 0.5f) - 0.5f;
+      float y     = SDL_clamp(p.Y, 0.5f, box.height - 0.5f) - 0.5f;
+      int   x0    = static_cast<int>(x);
+      int   y0    = static_cast<int>(y);
+      int   x1    = SDL_min(x0 + 1, box.width - 1);
+      int   y1    = SDL_min(y0 + 1, box.height - 1);
+      float fx    = x - x0;
+      float fy    = y - y0;
+      float mtsd[4];
+      auto  texel = [&](int tx, int ty, int channel) {
+        return texels[(static_cast<size_t>(ty) * box.width + tx) * 4 + channel] / 255.0f;
+      };
+      for (int channel = 0; channel < 4; channel++) {
+        float top     = HMM_Lerp(texel(x0, y0, channel), fx, texel(x1, y0, channel));
+        float bottom  = HMM_Lerp(texel(x0, y1, channel), fx, texel(x1, y1, channel));
+        mtsd[channel] = HMM_Lerp(top, fy, bottom);
+      }
+      Text_Batch_Effect_Sample result = {};
+      result.median                   = msdf_median(mtsd[0], mtsd[1], mtsd[2]);
+      result.distance                 = mtsd[3];
+      return result;
+    };
+
+    for (int y = -margin; y < box.height + margin; y++) {
+      for (int x = -margin; x < box.width + margin; x++) {
+        auto p       = HMM_V2(x + 0.5f, y + 0.5f);
+        auto q       = p - offset;
+        bool in_quad = x >= 0 && x < box.width && y >= 0 && y < box.height;
+        bool in_copy = q.X >= 0.0f && q.X < box.width && q.Y >= 0.0f && q.Y < box.height;
+
+        HMM_Vec4 copy = {};
+        if (in_copy) {
+          copy = text_batch_effects_reference(
+              copy_style,
+              style.shadow_color,
+              distance_range,
+              sample(q),
+              {});
+          copy_coverage += copy.A;
+          if (!in_quad) { copy_coverage_outside += copy.A; }
+        }
+        if (!in_quad) { continue; }
+
+        auto glyph    = sample(p);
+        auto one_pass = text_batch_effects_reference(
+            style,
+            text_color,
+            distance_range,
+            glyph,
+            sample(q));
+        auto two_pass = text_batch_blend_over(
+            text_batch_effects_reference({}, text_color, distance_range, glyph, {}),
+            copy);
+        for (int channel = 0; channel < 4; channel++) {
+          max_difference = SDL_max(
+              max_difference,
+              SDL_fabs(one_pass.Elements[channel] - two_pass.Elements[channel]));
+        }
+
+        auto texel = &texels[(static_cast<size_t>(y) * box.width + x) * 4];
+        if (texel[3] > 0 && texel[3] < 255) {
+          float error = SDL_fabsf(msdf_median(texel[0], texel[1], texel[2]) - texel[3]) / 255.0f *
+                        distance_range;
+          median_error     += error;
+          max_median_error  = SDL_max(max_median_error, error);
+          median_samples   += 1;
+        }
+      }
+    }
+  }
+  if (glyphs_count == 0 || median_samples == 0 || copy_coverage == 0.0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "No glyphs to compare the effects on");
+    return false;
+  }
+
+  double copy_outside      = copy_coverage_outside / copy_coverage;
+  double mean_median_error = median_error / median_samples;
+  SDL_Log(
+      "-- Effect reference (%d glyphs, %.3f ms) --",
+      glyphs_count,
+      benchmark_elapsed_ms(start_counter));
+  SDL_Log(
+      "shadow  one pass 1 instance/glyph  two pass 2 instances/glyph  max difference %.2e  "
+      "copy outside quads %.2f%%",
+      max_difference,
+      100.0 * copy_outside);
+  SDL_Log(
+      "msdf median vs true distance  mean error %.3f px  max error %.3f px",
+      mean_median_error,
+      max_median_error);
+
+  bool within_bounds = true;
+  if (max_difference > MAX_SHADOW_DIFFERENCE) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "One pass shadow differs from the two pass shadow by more than %.0e",
+        MAX_SHADOW_DIFFERENCE);
+    within_bounds = false;
+  }
+  if (copy_outside > MAX_COPY_OUTSIDE) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "More than %.0f%% of the shadow copy falls outside of the glyph quads",
+        100.0 * MAX_COPY_OUTSIDE);
+    within_bounds = false;
+  }
+  if (mean_median_error > MAX_MEAN_MEDIAN_ERROR || max_median_error > MAX_MEDIAN_ERROR) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "MSDF median strays from the true distance by more than %.3f px on average or %.3f px at "
+        "most",
+        MAX_MEAN_MEDIAN_ERROR,
+        MAX_MEDIAN_ERROR);
+    within_bounds = false;
+  }
+  return within_bounds;
+}
+
+// -- GPU Culling -----------------------------------------------------------------
+
+// Renders a grid of lorem ipsum blocks into an offscreen target through a view zoomed in on a
+// fraction of them, as when zoomed into a large document, with and without GPU culling. Logs the
+// instances the culling found visible, the CPU time spent recording, preparing and submitting a
+// frame, and the frame time including the wait for the GPU, which the culling trades vertex work
+// of off-screen glyphs for.
+static void benchmark_gpu_culling(
+    const std::string&      base_path,
+    const Font_Atlas_Array& font_atlas_array,
+    Font_Atlas*             font_atlas,
+    SDL_GPUDevice*          device,
+    SDL_GPUTextureFormat    target_format) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(device != nullptr);
+
+  static constexpr int   FRAMES       = 100;
+  static constexpr int   BLOCKS_COUNT = 256;
+  static constexpr float SIZE         = 16.0f;
+  static constexpr float ZOOMS[]      = {1.0f, 4.0f, 16.0f};
+  static constexpr int   TARGET_SIZE  = 1024;
+
+  Benchmark_Batch_Fixture fixture = {};
+  defer(benchmark_batch_fixture_destroy(&fixture));
+  if (!benchmark_batch_fixture_create(
+          &fixture,
+          base_path,
+          font_atlas_array,
+          device,
+          target_format,
+          TARGET_SIZE)) {
+    return;
+  }
+  auto& text_batch = fixture.text_batch;
+
+  const auto& font_data  = font_atlas->variants[0];
+  auto        block_size = font_atlas_string_multiline_block_size(
+      font_data,
+      demo_string_lorem_ipsum,
+      SIZE);
+  float document_size = 16.0f * SDL_max(block_size.X, block_size.Y);
+
+  SDL_Log("-- GPU culling (%d blocks, %d frames) --", BLOCKS_COUNT, FRAMES);
+  for (auto zoom : ZOOMS) {
+    // The view covers 1 / zoom of the document's width and height, around its center.
+    float half_extent = 0.5f * document_size / zoom;
+    float center      = 0.5f * document_size;
+    auto  transform   = HMM_Orthographic_RH_NO(
+        center - half_extent,
+        center + half_extent,
+        center + half_extent,
+        center - half_extent,
+        -1.0f,
+        1.0f);
+
+    for (int culling = 0; culling < 2; culling++) {
+      text_batch.gpu_culling = culling != 0;
+
+      Benchmark_Frame_Times times = {};
+      for (int frame = 0; frame < FRAMES; frame++) {
+        auto record = [&]() {
+          text_batch_begin_basic(&text_batch, transform, font_atlas, 0);
+          for (int i = 0; i < BLOCKS_COUNT; i++) {
+            text_batch_draw_multiline(
+                &text_batch,
+                demo_string_lorem_ipsum,
+                HMM_V3((i % 16) * block_size.X, (i / 16) * block_size.Y, 0.0f),
+                SIZE);
+          }
+          text_batch_end(&text_batch);
+        };
+        if (!benchmark_batch_fixture_run_frame(&fixture, record, &times)) { return; }
+      }
+
+      const auto& stats = text_batch.stats;
+      if (text_batch.gpu_culling) {
+        SDL_Log(
+            "zoom %4.0fx  culling on   visible %7d of %7d  cpu %6.3f ms  frame %6.3f ms",
+            zoom,
+            stats.cull_visible_count,
+            stats.cull_tested_count,
+            times.cpu_ms / FRAMES,
+            times.frame_ms / FRAMES);
+      } else {
+        SDL_Log(
+            "zoom %4.0fx  culling off  instances %7d           cpu %6.3f ms  frame %6.3f ms",
+            zoom,
+            stats.peak_instances_count,
+            times.cpu_ms / FRAMES,
+            times.frame_ms / FRAMES);
+      }
+    }
+  }
+}
+
+// -- Text Layout -----------------------------------------------------------------
+
+// Times laying out the star wars text centered in a single pass, against also measuring its block
+// size and every line width beforehand as drawing aligned text used to.
+static void benchmark_text_layout(Font_Atlas* font_atlas) {
+  SDL_assert(font_atlas != nullptr);
+
+  static constexpr int   ITERATIONS = 2000;
+  static constexpr float SIZE       = 18.0f;
+
+  std::string_view    text      = demo_string_star_wars;
+  const auto&         font_data = font_atlas->variants[0];
+  Text_Layout_Scratch scratch;
+  Text_Layout_Params  params = {};
+  params.font_atlas          = font_atlas;
+  params.font_variant        = 0;
+  params.size                = SIZE;
+  params.h_align             = TEXT_BATCH_H_ALIGN_CENTER;
+  params.v_align             = TEXT_BATCH_V_ALIGN_MIDDLE;
+  params.text_block_size     = HMM_V2(-1.0f, -1.0f);
+  params.multiline           = true;
+
+  volatile float sink = 0.0f;
+
+  auto start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) {
+    sink = sink + font_atlas_string_multiline_block_size(font_data, text, SIZE).X;
+    size_t line_start = 0;
+    while (line_start <= text.size()) {
+      auto line_end = std::min(text.find('\n', line_start), text.size());
+      auto line     = text.substr(line_start, line_end - line_start);
+      sink          = sink + font_atlas_string_width(font_data, line, SIZE);
+      line_start    = line_end + 1;
+    }
+    text_layout(text, params, &scratch);
+  }
+  double measured_ms = benchmark_elapsed_ms(start_counter);
+
+  start_counter = SDL_GetPerformanceCounter();
+  for (int i = 0; i < ITERATIONS; i++) { text_layout(text, params, &scratch); }
+  double single_pass_ms = benchmark_elapsed_ms(start_counter);
+
+  SDL_Log(
+      "-- Text layout (star wars, centered, %d glyphs, %d lines) --",
+      static_cast<int>(scratch.glyphs.glyph.size()),
+      static_cast<int>(scratch.lines.size()));
+  SDL_Log("measured first %8.3f us/layout", measured_ms * 1000.0 / ITERATIONS);
+  SDL_Log("single pass    %8.3f us/layout", single_pass_ms * 1000.0 / ITERATIONS);
+}
+
+// -- Instance Generation ---------------------------------------------------------
+
+// Lays out and writes the instances of the demo texts with every SIMD level the CPU supports, along
+// with a copy of the Star Wars text with two, three and four byte UTF-8 sequences mixed in and a
+// text full of kerning pairs. Codepoints the atlas lacks are decoded and skipped like any other.
+// The instances of each level are compared to the scalar ones, they have to be bit-identical.
+// Returns false if they aren't.
+static bool benchmark_instance_generation(Font_Atlas* font_atlas) {
+  SDL_assert(font_atlas != nullptr);
+
+  static constexpr int   ITERATIONS = 1000;
+  static constexpr float SIZE       = 18.0f;
+
+  // Every third e becomes an e acute, every third a an alpha, every third o a CJK ideograph and
+  // every third y an emoji.
+  std::string mixed_text;
+  int         e_count = 0;
+  int         a_count = 0;
+  int         o_count = 0;
+  int         y_count = 0;
+  for (const char* c = demo_string_star_wars; *c != 0; c++) {
+    if (*c == 'e' && e_count++ % 3 == 0) {
+      mixed_text += "\xC3\xA9";
+    } else if (*c == 'a' && a_count++ % 3 == 0) {
+      mixed_text += "\xCE\xB1";
+    } else if (*c == 'o' && o_count++ % 3 == 0) {
+      mixed_text += "\xE4\xB8\xAD";
+    } else if (*c == 'y' && y_count++ % 3 == 0) {
+      mixed_text += "\xF0\x9F\x99\x82";
+    } else {
+      mixed_text += *c;
+    }
+  }
+
+  std::string kerned_text;
+  for (int i = 0; i < 32; i++) {
+    kerned_text += "AVATAR WAVES To Tyrell, \"LT\" Yvonne. P.J. FAWN r. y, 7.4 VA Wo Ye\n";
+  }
+
+  // The kerned text has to exercise kerning, or it checks nothing the demo texts don't.
+  const auto& variant            = font_atlas->variants[0];
+  int         kerned_pairs_count = 0;
+  uint16_t    prev_glyph_index   = FONT_GLYPH_INDEX_NONE;
+  utf8_for_each_codepoint(kerned_text, [&](uint32_t codepoint) {
+    auto glyph_index = font_variant_find_glyph_index(variant, codepoint);
+    if (prev_glyph_index != FONT_GLYPH_INDEX_NONE && glyph_index != FONT_GLYPH_INDEX_NONE &&
+        font_kerning_table_lookup(variant.kerning_table, prev_glyph_index, glyph_index) != 0.0f) {
+      kerned_pairs_count += 1;
+    }
+    prev_glyph_index = glyph_index;
+  });
+  if (kerned_pairs_count == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Kerned text has no kerning pairs in the atlas");
+    return false;
+  }
+
+  std::string_view texts[]      = {
+      demo_string_lorem_ipsum,
+      demo_string_star_wars,
+      mixed_text,
+      kerned_text};
+  const char*      text_names[] = {"lorem ipsum", "star wars", "mixed utf-8", "kerned"};
+
+  Text_Layout_Params params = {};
+  params.font_atlas         = font_atlas;
+  params.font_variant       = 0;
+  params.size               = SIZE;
+  params.h_align            = TEXT_BATCH_H_ALIGN_CENTER;
+  params.v_align            = TEXT_BATCH_V_ALIGN_MIDDLE;
+  params.text_block_size    = HMM_V2(-1.0f, -1.0f);
+  params.multiline          = true;
+
+  auto packed_size  = float_to_half(SIZE);
+  auto packed_color = pack_color_rgba8(HMM_V4(1.0f, 0.5f, 0.25f, 1.0f));
+  auto origin       = HMM_V2(123.25f, 456.75f);
+
+  SDL_Log("-- Instance generation (%d iterations) --", ITERATIONS);
+  bool all_identical = true;
+  for (int t = 0; t < SDL_arraysize(texts); t++) {
+    Text_Layout_Scratch              scratch;
+    std::vector<Text_Batch_Instance> scalar_instances;
+    std::vector<Text_Batch_Instance> instances;
+
+    SDL_Log("%s text", text_names[t]);
+    for (int level = 0; level <= simd_best_level(); level++) {
+      auto simd_level = static_cast<Simd_Level>(level);
+
+      auto start_counter = SDL_GetPerformanceCounter();
+      for (int i = 0; i < ITERATIONS; i++) {
+        text_layout(texts[t], params, &scratch, 0, simd_level);
+        int glyphs_count = static_cast<int>(scratch.glyphs.glyph.size());
+        instances.resize(glyphs_count);
+        text_batch_write_instances(
+            instances.data(),
+            scratch.glyphs,
+            0,
+            glyphs_count,
+            origin,
+            packed_size,
+            packed_color,
+            simd_level);
+      }
+      double runtime_ms = benchmark_elapsed_ms(start_counter);
+
+      if (level == SIMD_LEVEL_SCALAR) { scalar_instances = instances; }
+      bool identical = instances.size() == scalar_instances.size() &&
+                       SDL_memcmp(
+                           instances.data(),
+                           scalar_instances.data(),
+                           sizeof(Text_Batch_Instance) * instances.size()) == 0;
+
+      SDL_Log(
+          "%-6s %8.2f Mglyphs/s  identical to scalar: %s",
+          SIMD_LEVEL_NAMES[level],
+          instances.size() * ITERATIONS / (runtime_ms * 1000.0),
+          identical ? "yes" : "no");
+      if (!identical) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_APPLICATION,
+            "%s instances of the %s text differ from the scalar ones",
+            SIMD_LEVEL_NAMES[level],
+            text_names[t]);
+        all_identical = false;
+      }
+    }
+  }
+
+  return all_identical;
+}
+
+// -- Layout Cache ----------------------------------------------------------------
+
+// Draws the same labels every frame with the layout cache disabled and enabled. With the cache,
+// only the first frame lays the labels out, the others translate the cached glyphs into instances.
+static void benchmark_layout_cache(Text_Batch* text_batch, Font_Atlas* font_atlas) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(font_atlas != nullptr);
+
+  static constexpr int   ITERATIONS   = 100;
+  static constexpr int   LABELS_COUNT = 1000;
+  static constexpr float SIZE         = 18.0f;
+
+  std::vector<std::string> labels(LABELS_COUNT);
+  for (int i = 0; i < LABELS_COUNT; i++) {
+    char buffer[64];
+    SDL_snprintf(buffer, sizeof(buffer), "Label %04d: %s", i, i % 2 ? "Health" : "Distance");
+    labels[i] = buffer;
+  }
+
+  auto  transform = HMM_M4D(1.0f);
+  auto& cache     = text_batch->layout_cache;
+  auto  enabled   = cache.enabled;
+
+  SDL_Log("-- Layout cache (%d labels) --", LABELS_COUNT);
+  for (int pass = 0; pass < 2; pass++) {
+    text_layout_cache_clear(&cache);
+    cache.enabled = pass == 1;
+    cache.stats   = {};
+
+    int  instances_count = 0;
+    auto start_counter   = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++) {
+      text_batch_begin_basic(text_batch, transform, font_atlas, 0);
+      for (int j = 0; j < LABELS_COUNT; j++) {
+        text_batch_draw(
+            text_batch,
+            labels[j],
+            HMM_V3(static_cast<float>(j % 10) * 200.0f, static_cast<float>(j / 10) * SIZE, 0.0f),
+            SIZE,
+            static_cast<Text_Batch_H_Align>(j % 3));
+      }
+      text_batch_end(text_batch);
+      instances_count = text_batch->instances_count;
+      text_batch_reset(text_batch);
+    }
+    double runtime_ms = benchmark_elapsed_ms(start_counter);
+
+    auto lookups_count = cache.stats.hits_count + cache.stats.misses_count;
+    SDL_Log(
+        "cache %-3s  instances %d  record %6.3f ms/frame  hit rate %5.1f%%  memory %.1f KB",
+        cache.enabled ? "on" : "off",
+        instances_count,
+        runtime_ms / ITERATIONS,
+        lookups_count > 0 ? 100.0 * cache.stats.hits_count / lookups_count : 0.0,
+        static_cast<double>(cache.bytes) / 1024.0);
+  }
+
+  text_layout_cache_clear(&cache);
+  cache.enabled = enabled;
+  cache.stats   = {};
+}
+
+// -- Line Clipping ---------------------------------------------------------------
+
+// Draws a 10k line text block through a view that shows a few dozen of its lines, as when scrolled
+// into a long log, without and with a clip rectangle, with the layout cache disabled and enabled.
+// Logs the instances emitted and the CPU time to record a frame.
+static void benchmark_line_clipping(Text_Batch* text_batch, Font_Atlas* font_atlas) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(font_atlas != nullptr);
+
+  static constexpr int   ITERATIONS    = 20;
+  static constexpr int   LINES_COUNT   = 10000;
+  static constexpr int   VISIBLE_LINES = 40;
+  static constexpr float SIZE          = 16.0f;
+
+  std::string_view lorem_ipsum = demo_string_lorem_ipsum;
+  auto             line_length = SDL_min(lorem_ipsum.find('\n'), static_cast<size_t>(80));
+  auto             line        = lorem_ipsum.substr(0, line_length);
+
+  std::string text;
+  text.reserve((line.size() + 1) * LINES_COUNT);
+  for (int i = 0; i < LINES_COUNT; i++) {
+    text += line;
+    text += '\n';
+  }
+
+  const auto& font_data  = font_atlas->variants[0];
+  auto        block_size = font_atlas_string_multiline_block_size(font_data, text, SIZE);
+  auto        position   = HMM_V3(0.0f, 0.0f, 0.0f);
+
+  // The view is scrolled to the middle of the block, which is centered horizontally on position
+  // and hangs down from it.
+  float line_height = font_data.line_height * SIZE;
+  float view_top    = -0.5f * block_size.Y;
+  auto  transform   = HMM_Orthographic_RH_NO(
+      -0.5f * block_size.X,
+      0.5f * block_size.X,
+      view_top - VISIBLE_LINES * line_height,
+      view_top,
+      -1.0f,
+      1.0f);
+  auto clip_rect = text_batch_clip_rect(transform, position.Z);
+
+  auto& cache   = text_batch->layout_cache;
+  auto  enabled = cache.enabled;
+
+  SDL_Log("-- Line clipping (%d lines, %d visible) --", LINES_COUNT, VISIBLE_LINES);
+  for (int pass = 0; pass < 4; pass++) {
+    bool clipped = pass % 2 == 1;
+    text_layout_cache_clear(&cache);
+    cache.enabled = pass >= 2;
+    cache.stats   = {};
+
+    int  instances_count = 0;
+    auto start_counter   = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++) {
+      text_batch_begin_basic(text_batch, transform, font_atlas, 0);
+      text_batch_draw_multiline(
+          text_batch,
+          text,
+          position,
+          SIZE,
+          TEXT_BATCH_H_ALIGN_LEFT,
+          TEXT_BATCH_V_ALIGN_TOP,
+          HMM_V4(1.0f, 1.0f, 1.0f, 1.0f),
+          block_size,
+          clipped ? &clip_rect : nullptr);
+      text_batch_end(text_batch);
+      instances_count = text_batch->instances_count;
+      text_batch_reset(text_batch);
+    }
+    double runtime_ms = benchmark_elapsed_ms(start_counter);
+
+    SDL_Log(
+        "cache %-3s  clip %-3s  instances %7d  record %8.3f ms/frame",
+        cache.enabled ? "on" : "off",
+        clipped ? "on" : "off",
+        instances_count,
+        runtime_ms / ITERATIONS);
+  }
+
+  text_layout_cache_clear(&cache);
+  cache.enabled = enabled;
+  cache.stats   = {};
+}
+
+// -- Text Static -----------------------------------------------------------------
+
+// Compares the CPU time of a frame drawing lorem ipsum blocks with a separate Text_Batch, which
+// lays out and uploads every glyph each frame, against Text_Static, for a growing glyph count.
+// Frames are rendered into an offscreen target, and the GPU is waited on after each frame, outside
+// of the measured time.
+static void benchmark_text_static(
+    const std::string&      base_path,
+    const Font_Atlas_Array& font_atlas_array,
+    Font_Atlas*             font_atlas,
+    SDL_GPUDevice*          device,
+    SDL_GPUTextureFormat    target_format) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(device != nullptr);
+
+  static constexpr int   FRAMES                 = 100;
+  static constexpr float SIZE                   = 24.0f;
+  static constexpr int   TARGET_GLYPHS_COUNTS[] = {50'000, 250'000, 1'000'000, 2'500'000};
+
+  Benchmark_Batch_Fixture fixture = {};
+  defer(benchmark_batch_fixture_destroy(&fixture));
+  if (!benchmark_batch_fixture_create(
+          &fixture,
+          base_path,
+          font_atlas_array,
+          device,
+          target_format,
+          256)) {
+    return;
+  }
+  auto text_batch = &fixture.text_batch;
+
+  const auto& font_data  = font_atlas->variants[0];
+  auto        block_size = font_atlas_string_multiline_block_size(
+      font_data,
+      demo_string_lorem_ipsum,
+      SIZE);
+  auto transform      = HMM_Orthographic_RH_NO(0.0f, 256.0f, 0.0f, 256.0f, -1.0f, 1.0f);
+  auto block_position = [&](int block) {
+    return HMM_V3((block % 16) * block_size.X, (block / 16) * block_size.Y, 0.0f);
+  };
+
+  Text_Static text_static = {};
+  defer(text_static_destroy(&text_static, device));
+  auto build_static = [&](int blocks_count) {
+    auto cmd_buf   = SDL_AcquireGPUCommandBuffer(device);
+    auto copy_pass = SDL_BeginGPUCopyPass(cmd_buf);
+    text_static_begin(&text_static, font_atlas, 0);
+    for (int i = 0; i < blocks_count; i++) {
+      text_static_draw_multiline(&text_static, demo_string_lorem_ipsum, block_position(i), SIZE);
+    }
+    bool succeeded = text_static_end(&text_static, device, copy_pass);
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_SubmitGPUCommandBuffer(cmd_buf);
+    SDL_WaitForGPUIdle(device);
+    return succeeded;
+  };
+
+  if (!build_static(1)) { return; }
+  int glyphs_per_block = text_static.instances_count;
+  if (glyphs_per_block == 0) { return; }
+
+  SDL_Log("-- Text static (%d frames, %d glyphs per block) --", FRAMES, glyphs_per_block);
+  for (auto target_glyphs_count : TARGET_GLYPHS_COUNTS) {
+    int blocks_count = SDL_max(target_glyphs_count / glyphs_per_block, 1);
+
+    Benchmark_Frame_Times batch_times = {};
+    for (int frame = 0; frame < FRAMES; frame++) {
+      auto record = [&]() {
+        text_batch_begin_basic(text_batch, transform, font_atlas, 0);
+        for (int i = 0; i < blocks_count; i++) {
+          text_batch_draw_multiline(text_batch, demo_string_lorem_ipsum, block_position(i), SIZE);
+        }
+        text_batch_end(text_batch);
+      };
+      if (!benchmark_batch_fixture_run_frame(&fixture, record, &batch_times)) { return; }
+    }
+
+    auto build_start_counter = SDL_GetPerformanceCounter();
+    if (!build_static(blocks_count)) { return; }
+    double build_ms = benchmark_elapsed_ms(build_start_counter);
+
+    Benchmark_Frame_Times static_times = {};
+    for (int frame = 0; frame < FRAMES; frame++) {
+      bool submitted = benchmark_batch_fixture_run_frame(
+          &fixture,
+          []() {},
+          [&](SDL_GPUCommandBuffer* cmd_buf, SDL_GPURenderPass* render_pass) {
+            text_static_render_basic(text_static, text_batch, cmd_buf, render_pass, transform);
+          },
+          &static_times);
+      if (!submitted) { return; }
+    }
+
+    SDL_Log(
+        "%8d glyphs  text batch %7.3f ms/frame  text static %7.3f ms/frame  build %8.3f ms",
+        text_static.instances_count,
+        batch_times.cpu_ms / FRAMES,
+        static_times.cpu_ms / FRAMES,
+        build_ms);
+  }
+}
+
+// -- Text Batch Growth -----------------------------------------------------------
+
+// Feeds a separate text batch a frame pattern of quiet stretches with a burst of glyphs in the
+// middle, past TEXT_BATCH_MIN_CAPACITY and the old fixed limit of 65536 instances and 8 draw
+// commands, and logs how its GPU buffers and the arena of its upload scheduler grew and shrank
+// back, and how often a frame had to wait for the GPU to release them. Nothing is rendered.
+static void benchmark_text_batch_growth(
+    const std::string&      base_path,
+    const Font_Atlas_Array& font_atlas_array,
+    Font_Atlas*             font_atlas,
+    SDL_GPUDevice*          device,
+    SDL_GPUTextureFormat    target_format) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(device != nullptr);
+
+  static constexpr int   QUIET_FRAMES       = TEXT_BATCH_SHRINK_FRAMES * 4;
+  static constexpr int   BURST_FRAMES       = 60;
+  static constexpr int   BURST_LABELS_COUNT = 256;
+  static constexpr int   BURST_BLOCKS_COUNT = 12;
+  static constexpr float SIZE               = 24.0f;
+
+  Benchmark_Batch_Fixture fixture = {};
+  defer(benchmark_batch_fixture_destroy(&fixture));
+  if (!benchmark_batch_fixture_create(
+          &fixture,
+          base_path,
+          font_atlas_array,
+          device,
+          target_format,
+          0)) {
+    return;
+  }
+  auto& text_batch       = fixture.text_batch;
+  auto& upload_scheduler = fixture.upload_scheduler;
+
+  auto     transform      = HMM_M4D(1.0f);
+  int      max_capacity   = 0;
+  int      max_draw_cmds  = 0;
+  uint32_t max_block_size = 0;
+  auto     start_counter  = SDL_GetPerformanceCounter();
+  for (int frame = 0; frame < QUIET_FRAMES * 2 + BURST_FRAMES; frame++) {
+    auto record = [&]() {
+      bool burst = frame >= QUIET_FRAMES && frame < QUIET_FRAMES + BURST_FRAMES;
+      if (burst) {
+        // Outline and basic labels alternate, so each label needs its own draw command.
+        for (int i = 0; i < BURST_LABELS_COUNT; i++) {
+          if (i % 2 == 0) {
+            text_batch_begin_basic(&text_batch, transform, font_atlas, 0);
+          } else {
+            text_batch_begin_outline(&text_batch, transform, font_atlas, 0);
+          }
+          text_batch_draw(&text_batch, "Label", HMM_V3(0.0f, i * SIZE, 0.0f), SIZE);
+          text_batch_end(&text_batch);
+        }
+        text_batch_begin_basic(&text_batch, transform, font_atlas, 0);
+        for (int i = 0; i < BURST_BLOCKS_COUNT; i++) {
+          text_batch_draw_multiline(
+              &text_batch,
+              demo_string_lorem_ipsum,
+              HMM_V3(0.0f, 0.0f, 0.0f),
+              SIZE);
+        }
+        text_batch_end(&text_batch);
+      } else {
+        text_batch_begin_basic(&text_batch, transform, font_atlas, 0);
+        text_batch_draw(&text_batch, "Quiet frame", HMM_V3(0.0f, 0.0f, 0.0f), SIZE);
+        text_batch_end(&text_batch);
+      }
+      max_draw_cmds = SDL_max(max_draw_cmds, static_cast<int>(text_batch.draw_cmds.size()));
+    };
+    if (!benchmark_batch_fixture_run_frame(&fixture, record)) { return; }
+
+    max_capacity   = SDL_max(max_capacity, text_batch.capacity);
+    max_block_size = SDL_max(max_block_size, upload_scheduler.block_size);
+  }
+  SDL_WaitForGPUIdle(device);
+  double runtime_ms = benchmark_elapsed_ms(start_counter);
+
+  const auto& stats = text_batch.stats;
+  SDL_Log(
+      "-- Text batch growth (%d quiet, %d burst, %d quiet frames) --",
+      QUIET_FRAMES,
+      BURST_FRAMES,
+      QUIET_FRAMES);
+  SDL_Log(
+      "peak %d instances, %d draw cmds  capacity %d -> %d -> %d  grew %" SDL_PRIu64
+      "  shrank %" SDL_PRIu64 "  %.3f ms/frame",
+      stats.peak_instances_count,
+      max_draw_cmds,
+      TEXT_BATCH_MIN_CAPACITY,
+      max_capacity,
+      text_batch.capacity,
+      stats.grow_count,
+      stats.shrink_count,
+      runtime_ms / (QUIET_FRAMES * 2 + BURST_FRAMES));
+  const auto& upload_stats = upload_scheduler.stats;
+  SDL_Log(
+      "upload arena %u -> %u -> %u bytes  grew %" SDL_PRIu64 "  shrank %" SDL_PRIu64,
+      UPLOAD_SCHEDULER_MIN_BLOCK_SIZE,
+      max_block_size,
+      upload_scheduler.block_size,
+      upload_stats.grow_count,
+      upload_stats.shrink_count);
+  SDL_Log(
+      "%d frames in flight  blocked on a fence %" SDL_PRIu64 " times, max %.3f ms",
+      UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT,
+      upload_stats.fence_waits_count,
+      upload_stats.max_fence_wait_ms);
+}
+
+// -- Demo Uploads ----------------------------------------------------------------
+
+// Instance bytes uploaded by the text batch for the first frame of each demo and for the frames
+// after, once every data buffer holds the unchanged draw commands, against the 80 byte instances
+// that carried their glyph bounds and were all uploaded every frame. draw_demo(i) selects demo i
+// and draws a frame of it into the text batch. The glyph metrics table itself is uploaded once,
+// when the atlases are loaded.
+template <typename Draw_Demo_Func>
+static void benchmark_demo_uploads(
+    Text_Batch*             text_batch,
+    const Font_Atlas_Array& font_atlas_array,
+    SDL_GPUDevice*          device,
+    const char* const*      demo_names,
+    int                     demos_count,
+    Draw_Demo_Func          draw_demo) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(device != nullptr);
+  SDL_assert(demo_names != nullptr);
+
+  static constexpr size_t BOUNDS_INSTANCE_SIZE = 80;
+  static constexpr int    FRAMES               = UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT * 2;
+
+  SDL_Log(
+      "-- Demo uploads (%d byte instances, %d before, %d frames) --",
+      static_cast<int>(sizeof(Text_Batch_Instance)),
+      static_cast<int>(BOUNDS_INSTANCE_SIZE),
+      FRAMES);
+  for (int i = 0; i < demos_count; i++) {
+    int      instances_count    = 0;
+    uint32_t first_frame_bytes  = 0;
+    uint32_t later_frames_bytes = 0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+      draw_demo(i);
+
+      auto cmd_buf = SDL_AcquireGPUCommandBuffer(device);
+      if (cmd_buf == nullptr) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_APPLICATION,
+            "Failed to acquire command buffer: %s",
+            SDL_GetError());
+        text_batch_reset(text_batch);
+        return;
+      }
+      instances_count = text_batch->instances_count;
+      text_batch_prepare_draw_cmds(text_batch);
+      upload_scheduler_flush(text_batch->upload_scheduler, cmd_buf);
+      text_batch_reset(text_batch);
+      upload_scheduler_submit(text_batch->upload_scheduler, cmd_buf);
+
+      if (frame == 0) {
+        first_frame_bytes = text_batch->stats.uploaded_bytes;
+      } else if (frame >= UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT) {
+        later_frames_bytes += text_batch->stats.uploaded_bytes;
+      }
+    }
+
+    const auto& upload_stats = text_batch->upload_scheduler->stats;
+    SDL_Log(
+        "%-24s %7d glyphs  %9u bytes first frame  %9u bytes/frame after  (%9u before)  "
+        "%d copies",
+        demo_names[i],
+        instances_count,
+        first_frame_bytes,
+        later_frames_bytes / (FRAMES - UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT),
+        static_cast<uint32_t>(instances_count * BOUNDS_INSTANCE_SIZE),
+        upload_stats.copies_count);
+  }
+  SDL_Log(
+      "glyph metrics table      %7d glyphs  %9u bytes at load",
+      font_atlas_array.glyph_metrics_count,
+      static_cast<uint32_t>(sizeof(Font_Glyph_Metrics) * font_atlas_array.glyph_metrics_count));
+}
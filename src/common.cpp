@@ -73,3 +73,353 @@ static bool read_file_contents(const std::string& file_path, std::vector<uint8_t
 
   return true;
 }
+
+// -- Memory Mapped Files -------------------------------------------------------
+
+struct Mapped_File {
+  const uint8_t* data;
+  size_t         size;
+#if defined(SDL_PLATFORM_WINDOWS)
+  HANDLE file;
+  HANDLE mapping;
+#endif
+};
+
+static bool map_file(const std::string& file_path, Mapped_File* out_mapped_file) {
+  SDL_assert(!file_path.empty());
+  SDL_assert(out_mapped_file != nullptr);
+
+  *out_mapped_file = {};
+
+#if defined(SDL_PLATFORM_WINDOWS)
+  HANDLE file = CreateFileA(
+      file_path.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open file: %s", file_path.c_str());
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get file size: %s", file_path.c_str());
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map file: %s", file_path.c_str());
+    CloseHandle(file);
+    return false;
+  }
+
+  auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map file view: %s", file_path.c_str());
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  out_mapped_file->data    = static_cast<const uint8_t*>(view);
+  out_mapped_file->size    = static_cast<size_t>(size.QuadPart);
+  out_mapped_file->file    = file;
+  out_mapped_file->mapping = mapping;
+#else
+  int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open file: %s", file_path.c_str());
+    return false;
+  }
+  defer(close(fd));
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get file size: %s", file_path.c_str());
+    return false;
+  }
+
+  auto view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  if (view == MAP_FAILED) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map file: %s", file_path.c_str());
+    return false;
+  }
+  madvise(view, static_cast<size_t>(file_stat.st_size), MADV_WILLNEED);
+
+  out_mapped_file->data = static_cast<const uint8_t*>(view);
+  out_mapped_file->size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+  return true;
+}
+
+static void unmap_file(Mapped_File* mapped_file) {
+  SDL_assert(mapped_file != nullptr);
+
+  if (mapped_file->data == nullptr) { return; }
+
+#if defined(SDL_PLATFORM_WINDOWS)
+  UnmapViewOfFile(mapped_file->data);
+  CloseHandle(mapped_file->mapping);
+  CloseHandle(mapped_file->file);
+#else
+  munmap(const_cast<uint8_t*>(mapped_file->data), mapped_file->size);
+#endif
+
+  *mapped_file = {};
+}
+
+// -- Packing -------------------------------------------------------------------
+
+// Converts a float to IEEE 754 half precision bits, rounding to nearest even. Values out of the
+// half range become infinity.
+static uint16_t float_to_half(float value) {
+  uint32_t bits;
+  SDL_memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign     = (bits >> 16) & 0x8000;
+  int      exponent = static_cast<int>((bits >> 23) & 0xFF);
+  uint32_t mantissa = bits & 0x7FFFFF;
+
+  if (exponent == 0xFF) {
+    return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+  }
+
+  int half_exponent = exponent - 127 + 15;
+  if (half_exponent >= 0x1F) { return static_cast<uint16_t>(sign | 0x7C00); }
+
+  // Rounding up may carry into the exponent, which is still the correctly rounded result.
+  uint32_t half, rest, halfway;
+  if (half_exponent <= 0) {
+    if (half_exponent < -10) { return static_cast<uint16_t>(sign); }
+    int shift = 14 - half_exponent;
+    mantissa |= 0x800000;
+    half    = mantissa >> shift;
+    rest    = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  } else {
+    half    = static_cast<uint32_t>(half_exponent) << 10 | mantissa >> 13;
+    rest    = mantissa & 0x1FFF;
+    halfway = 0x1000;
+  }
+  if (rest > halfway || (rest == halfway && (half & 1) != 0)) { half += 1; }
+
+  return static_cast<uint16_t>(sign | half);
+}
+
+// Packs a color into RGBA8 with red in the lowest byte, as unpacked by the shaders.
+static uint32_t pack_color_rgba8(HMM_Vec4 color) {
+  auto to_unorm8 = [](float value) {
+    return static_cast<uint32_t>(SDL_clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+  };
+  return to_unorm8(color.R) | to_unorm8(color.G) << 8 | to_unorm8(color.B) << 16 |
+         to_unorm8(color.A) << 24;
+}
+
+// -- SIMD ----------------------------------------------------------------------
+
+// Hot loops with SIMD versions dispatch on the best level the CPU supports, picked at runtime.
+// Functions using intrinsics are compiled for their instruction set with SDL_TARGETING, so the
+// build flags don't change.
+
+enum Simd_Level {
+  SIMD_LEVEL_SCALAR,
+  SIMD_LEVEL_SSE2,
+  SIMD_LEVEL_AVX2,
+  SIMD_LEVEL_COUNT,
+};
+
+static constexpr const char* SIMD_LEVEL_NAMES[SIMD_LEVEL_COUNT] = {
+    "scalar",
+    "sse2",
+    "avx2",
+};
+
+static Simd_Level simd_best_level() {
+  static const auto level = []() {
+#ifdef SDL_AVX2_INTRINSICS
+    if (SDL_HasAVX2()) { return SIMD_LEVEL_AVX2; }
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+    if (SDL_HasSSE2()) { return SIMD_LEVEL_SSE2; }
+#endif
+    return SIMD_LEVEL_SCALAR;
+  }();
+  return level;
+}
+
+// -- UTF-8 ---------------------------------------------------------------------
+
+// The run of ASCII bytes text starts with, all of it for ASCII text, is iterated as is, one byte
+// per codepoint, without decoding. The rest is decoded in blocks of UTF8_DECODE_BLOCK_SIZE
+// codepoints: runs of ASCII bytes are expanded a vector at a time with SSE2 or AVX2, and the other
+// sequences are stepped through with SDL_StepUTF8. Like looping over SDL_StepUTF8, invalid
+// sequences are dropped and the text ends at its first NUL byte.
+
+static constexpr int UTF8_DECODE_BLOCK_SIZE = 256;
+
+// Bytes 1 to 127 are ASCII codepoints, NUL ends the text.
+static bool utf8_is_ascii(char byte) {
+  return static_cast<signed char>(byte) > 0;
+}
+
+#ifdef SDL_SSE2_INTRINSICS
+static size_t SDL_TARGETING("sse2") utf8_ascii_prefix_size_sse2(const char* text, size_t size) {
+  const auto zero = _mm_setzero_si128();
+  size_t     i    = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, zero)) != 0xFFFF) { break; }
+  }
+  return i;
+}
+
+static size_t SDL_TARGETING("sse2")
+    utf8_expand_ascii_sse2(const char* text, size_t size, uint32_t* codepoints) {
+  const auto zero = _mm_setzero_si128();
+  size_t     i    = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, zero)) != 0xFFFF) { break; }
+    auto low  = _mm_unpacklo_epi8(bytes, zero);
+    auto high = _mm_unpackhi_epi8(bytes, zero);
+    auto out  = reinterpret_cast<__m128i*>(codepoints + i);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(low, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+  }
+  return i;
+}
+#endif
+
+#ifdef SDL_AVX2_INTRINSICS
+static size_t SDL_TARGETING("avx2") utf8_ascii_prefix_size_avx2(const char* text, size_t size) {
+  const auto zero = _mm256_setzero_si256();
+  size_t     i    = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+    if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(bytes, zero)) != -1) { break; }
+  }
+  return i;
+}
+
+static size_t SDL_TARGETING("avx2")
+    utf8_expand_ascii_avx2(const char* text, size_t size, uint32_t* codepoints) {
+  const auto zero = _mm256_setzero_si256();
+  size_t     i    = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+    if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(bytes, zero)) != -1) { break; }
+    auto out = reinterpret_cast<__m256i*>(codepoints + i);
+    for (int j = 0; j < 4; j++) {
+      auto quarter = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(text + i + j * 8));
+      _mm256_storeu_si256(out + j, _mm256_cvtepu8_epi32(quarter));
+    }
+  }
+  return i;
+}
+#endif
+
+// Returns the size of the run of ASCII bytes text starts with.
+static size_t utf8_ascii_prefix_size(const char* text, size_t size, Simd_Level level) {
+  size_t i = 0;
+  switch (level) {
+#ifdef SDL_AVX2_INTRINSICS
+  case SIMD_LEVEL_AVX2:
+    i  = utf8_ascii_prefix_size_avx2(text, size);
+    // The SSE2 version picks up the last 16 bytes before a non-ASCII byte or the end.
+    i += utf8_ascii_prefix_size_sse2(text + i, size - i);
+    break;
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+  case SIMD_LEVEL_SSE2:
+    i = utf8_ascii_prefix_size_sse2(text, size);
+    break;
+#endif
+  default:
+    break;
+  }
+  while (i < size && utf8_is_ascii(text[i])) { i += 1; }
+  return i;
+}
+
+// Copies the run of ASCII bytes text starts with into codepoints, returns its size.
+static size_t
+utf8_expand_ascii(const char* text, size_t size, uint32_t* codepoints, Simd_Level level) {
+  size_t i = 0;
+  switch (level) {
+#ifdef SDL_AVX2_INTRINSICS
+  case SIMD_LEVEL_AVX2:
+    i  = utf8_expand_ascii_avx2(text, size, codepoints);
+    i += utf8_expand_ascii_sse2(text + i, size - i, codepoints + i);
+    break;
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+  case SIMD_LEVEL_SSE2:
+    i = utf8_expand_ascii_sse2(text, size, codepoints);
+    break;
+#endif
+  default:
+    break;
+  }
+  for (; i < size && utf8_is_ascii(text[i]); i++) {
+    codepoints[i] = static_cast<uint32_t>(text[i]);
+  }
+  return i;
+}
+
+// Decodes up to capacity codepoints from the start of text, advancing it past them. Returns the
+// number of codepoints decoded, text is left empty once its end or a NUL byte is reached.
+static int utf8_decode_block(
+    std::string_view* text,
+    uint32_t*         codepoints,
+    int               capacity,
+    Simd_Level        level) {
+  int count = 0;
+  while (!text->empty() && count < capacity) {
+    auto ascii_size = utf8_expand_ascii(
+        text->data(),
+        SDL_min(text->size(), static_cast<size_t>(capacity - count)),
+        codepoints + count,
+        level);
+    count += static_cast<int>(ascii_size);
+    text->remove_prefix(ascii_size);
+    if (text->empty() || count == capacity) { break; }
+
+    const char* ptr       = text->data();
+    auto        str_size  = text->size();
+    auto        codepoint = SDL_StepUTF8(&ptr, &str_size);
+    if (codepoint == 0) {
+      *text = {};
+      break;
+    }
+    text->remove_prefix(text->size() - str_size);
+    if (codepoint != SDL_INVALID_UNICODE_CODEPOINT) { codepoints[count++] = codepoint; }
+  }
+  return count;
+}
+
+// Calls func(codepoint) for every codepoint of text. The ASCII bytes text starts with, all of it
+// for ASCII text, are passed on as is, only what follows is decoded.
+template <typename Codepoint_Func>
+static void utf8_for_each_codepoint(
+    std::string_view text,
+    Codepoint_Func   func,
+    Simd_Level       level = simd_best_level()) {
+  auto ascii_size = utf8_ascii_prefix_size(text.data(), text.size(), level);
+  for (size_t i = 0; i < ascii_size; i++) { func(static_cast<uint32_t>(text[i])); }
+  text.remove_prefix(ascii_size);
+
+  uint32_t codepoints[UTF8_DECODE_BLOCK_SIZE];
+  while (!text.empty()) {
+    int count = utf8_decode_block(&text, codepoints, UTF8_DECODE_BLOCK_SIZE, level);
+    for (int i = 0; i < count; i++) { func(codepoints[i]); }
+  }
+}
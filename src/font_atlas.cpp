@@ -2,9 +2,14 @@ enum Font_Atlas_Kind {
   FONT_ATLAS_KIND_ROBOTO,
   FONT_ATLAS_KIND_SCIENCE_GOTHIC,
   FONT_ATLAS_KIND_LIMELIGHT,
+  FONT_ATLAS_KIND_ROBOTO_DYNAMIC,
   FONT_ATLAS_KIND_COUNT,
 };
 
+// Kinds before this one are baked by msdf-atlas-gen at build time, the rest are dynamic atlases
+// whose glyphs are generated from the TTFs at runtime (see font_atlas_dynamic.cpp).
+static constexpr int FONT_ATLAS_KIND_BAKED_COUNT = FONT_ATLAS_KIND_ROBOTO_DYNAMIC;
+
 enum Font_Atlas_Roboto_Variant {
   FONT_ATLAS_ROBOTO_VARIANT_REGULAR,
   FONT_ATLAS_ROBOTO_VARIANT_BOLD,
@@ -21,6 +26,15 @@ enum Font_Atlas_Science_Gothic_Variant {
   FONT_ATLAS_SCIENCE_GOTHIC_VARIANT_COUNT,
 };
 
+// MSDF atlases only hold the multi-channel distance, whose median is exact near the outline but
+// not further away from it. MTSDF atlases also hold the true distance in their alpha channel, for
+// effects that reach away from the outline such as shadows, glows and blur.
+enum Font_Atlas_Type {
+  FONT_ATLAS_TYPE_MSDF,
+  FONT_ATLAS_TYPE_MTSDF,
+  FONT_ATLAS_TYPE_COUNT,
+};
+
 struct Font_Glyph_Bounds {
   float left;
   float bottom;
@@ -28,11 +42,16 @@ struct Font_Glyph_Bounds {
   float top;
 };
 
+// Glyph bounds are stored in the exact form the text shaders consume, so filling the glyph metrics
+// table is a straight copy: plane bounds are (left, top, right, bottom) in em units, atlas bounds
+// are (left, top, right, bottom) texture coordinates, normalized to the font atlas array layer and
+// flipped to a top-left origin. layer is the glyph's layer in the font atlas array.
 struct Font_Glyph {
-  int               unicode;
-  float             horizontal_advance;
-  Font_Glyph_Bounds plane_bounds;
-  Font_Glyph_Bounds atlas_bounds;
+  HMM_Vec4 plane_bounds;
+  HMM_Vec4 atlas_bounds;
+  float    horizontal_advance;
+  int      unicode;
+  uint32_t layer;
 };
 
 struct Font_Kerning {
@@ -41,21 +60,93 @@ struct Font_Kerning {
   float advance;
 };
 
+// Glyph lookup is a direct index for the Latin-1 range, and a two-level page table (directory of
+// 256 codepoint pages) for everything above it. Both store 16-bit indices into the contiguous glyph
+// array, so a lookup touches the index table and the glyph record only.
+static constexpr int      FONT_GLYPH_DENSE_COUNT = 256;
+static constexpr int      FONT_GLYPH_PAGE_SHIFT  = 8;
+static constexpr int      FONT_GLYPH_PAGE_SIZE   = 1 << FONT_GLYPH_PAGE_SHIFT;
+static constexpr uint16_t FONT_GLYPH_INDEX_NONE  = 0xFFFF;
+
+// Kerning is looked up by glyph index pair. Small glyph sets store a dense glyphs x glyphs matrix.
+// Larger sets group glyphs with identical kerning rows (left) and columns (right) into classes,
+// like OpenType class-pair kerning, and store a left classes x right classes matrix. If even the
+// class matrix would exceed its memory budget, the sorted pair list is binary searched instead.
+static constexpr int    FONT_KERNING_DENSE_MAX_GLYPHS     = 128;
+static constexpr size_t FONT_KERNING_MAX_CLASSES_BYTES    = 256 * 1024;
+static constexpr int    FONT_KERNING_MAX_CLASSES_PER_SIDE = 0xFFFF;
+
+enum Font_Kerning_Kind {
+  FONT_KERNING_KIND_DENSE,
+  FONT_KERNING_KIND_CLASSES,
+  FONT_KERNING_KIND_PAIRS,
+};
+
+struct Font_Kerning_Table {
+  Font_Kerning_Kind     kind;
+  int                   left_count;
+  int                   right_count;
+  std::vector<uint16_t> left_classes;
+  std::vector<uint16_t> right_classes;
+  std::vector<uint32_t> pair_keys;
+  std::vector<float>    advances;
+};
+
 struct Font_Variant {
-  std::unordered_map<int, Font_Glyph> glyphs;
-  std::unordered_map<uint64_t, float> kernings;
-  float                               line_height;
-  float                               ascender;
-  float                               descender;
+  std::vector<Font_Glyph>   glyphs;
+  uint16_t                  glyph_index_dense[FONT_GLYPH_DENSE_COUNT];
+  std::vector<uint16_t>     glyph_page_directory;
+  std::vector<uint16_t>     glyph_pages;
+  std::vector<Font_Kerning> kernings;
+  Font_Kerning_Table        kerning_table;
+  float                     line_height;
+  float                     ascender;
+  float                     descender;
+  int                       glyph_metrics_offset;
+};
+
+struct Font_Atlas_Dynamic;
+
+// Layers of the font atlas array texture are FONT_ATLAS_LAYER_SIZE squared. A baked atlas takes one
+// layer and sits in its top-left corner, so it can't be larger than a layer.
+static constexpr int FONT_ATLAS_LAYER_SIZE = 1024;
+
+// Entry of the glyph metrics table, the GPU copy of a glyph's bounds and layer. Padded to a
+// multiple of 16 bytes like the text batch instances.
+struct Font_Glyph_Metrics {
+  HMM_Vec4 plane_bounds;
+  HMM_Vec4 atlas_bounds;
+  uint32_t layer;
+  uint32_t padding[3];
+};
+
+// Glyph instances refer to their glyph with a 16-bit index into the glyph metrics table.
+static constexpr int FONT_ATLAS_MAX_GLYPH_METRICS = 1 << 16;
+
+// All font atlases share a single 2D array texture, each owning a range of its layers, so text in
+// any font and variant is drawn with a single texture binding. Array textures can't be shown by
+// ImGui, so one layer at a time is copied into a 2D preview texture for the debug UI.
+//
+// The array also holds the glyph metrics table, a storage buffer in which every font variant owns
+// a range of entries starting at its glyph_metrics_offset, so instances only carry a glyph index.
+struct Font_Atlas_Array {
+  SDL_GPUTexture* texture;
+  int             layers_count;
+  SDL_GPUTexture* preview_texture;
+  SDL_GPUBuffer*  glyph_metrics_buffer;
+  int             glyph_metrics_count;
 };
 
 struct Font_Atlas {
   std::vector<Font_Variant> variants;
+  Font_Atlas_Type           type = FONT_ATLAS_TYPE_MSDF;
   float                     distance_range;
   float                     size;
   int                       width;
   int                       height;
-  SDL_GPUTexture*           texture;
+  int                       layer;
+  int                       layers_count;
+  Font_Atlas_Dynamic*       dynamic = nullptr;
 };
 
 static uint64_t font_atlas_pack_kerning(int unicode1, int unicode2) {
@@ -63,6 +154,262 @@ static uint64_t font_atlas_pack_kerning(int unicode1, int unicode2) {
          static_cast<uint32_t>(unicode2);
 }
 
+static void font_variant_insert_glyph_index(Font_Variant* variant, int codepoint, uint16_t index) {
+  SDL_assert(variant != nullptr);
+
+  auto unsigned_codepoint = static_cast<uint32_t>(codepoint);
+  if (unsigned_codepoint < FONT_GLYPH_DENSE_COUNT) {
+    variant->glyph_index_dense[unsigned_codepoint] = index;
+    return;
+  }
+
+  auto page = unsigned_codepoint >> FONT_GLYPH_PAGE_SHIFT;
+  if (page >= variant->glyph_page_directory.size()) {
+    variant->glyph_page_directory.resize(page + 1, FONT_GLYPH_INDEX_NONE);
+  }
+  if (variant->glyph_page_directory[page] == FONT_GLYPH_INDEX_NONE) {
+    variant->glyph_page_directory[page] =
+        static_cast<uint16_t>(variant->glyph_pages.size() / FONT_GLYPH_PAGE_SIZE);
+    variant->glyph_pages.resize(
+        variant->glyph_pages.size() + FONT_GLYPH_PAGE_SIZE,
+        FONT_GLYPH_INDEX_NONE);
+  }
+  auto page_start = static_cast<size_t>(variant->glyph_page_directory[page]) * FONT_GLYPH_PAGE_SIZE;
+  variant->glyph_pages[page_start + (unsigned_codepoint & (FONT_GLYPH_PAGE_SIZE - 1))] = index;
+}
+
+// Sorts the glyphs by codepoint and builds the dense and paged index tables over them.
+static void font_variant_build_glyph_lookup(Font_Variant* variant) {
+  SDL_assert(variant != nullptr);
+  SDL_assert(variant->glyphs.size() < FONT_GLYPH_INDEX_NONE);
+
+  std::sort(
+      variant->glyphs.begin(),
+      variant->glyphs.end(),
+      [](const Font_Glyph& a, const Font_Glyph& b) { return a.unicode < b.unicode; });
+
+  for (auto& index : variant->glyph_index_dense) { index = FONT_GLYPH_INDEX_NONE; }
+  variant->glyph_page_directory.clear();
+  variant->glyph_pages.clear();
+
+  for (size_t i = 0; i < variant->glyphs.size(); i++) {
+    font_variant_insert_glyph_index(variant, variant->glyphs[i].unicode, static_cast<uint16_t>(i));
+  }
+}
+
+static uint16_t font_variant_find_glyph_index(const Font_Variant& variant, int codepoint) {
+  auto unsigned_codepoint = static_cast<uint32_t>(codepoint);
+  if (unsigned_codepoint < FONT_GLYPH_DENSE_COUNT) {
+    return variant.glyph_index_dense[unsigned_codepoint];
+  }
+
+  auto page = unsigned_codepoint >> FONT_GLYPH_PAGE_SHIFT;
+  if (page >= variant.glyph_page_directory.size()) { return FONT_GLYPH_INDEX_NONE; }
+  auto page_index = variant.glyph_page_directory[page];
+  if (page_index == FONT_GLYPH_INDEX_NONE) { return FONT_GLYPH_INDEX_NONE; }
+  return variant.glyph_pages
+      [static_cast<size_t>(page_index) * FONT_GLYPH_PAGE_SIZE +
+       (unsigned_codepoint & (FONT_GLYPH_PAGE_SIZE - 1))];
+}
+
+// Unmaps a codepoint. Index pages stay allocated for the next codepoint mapped in them.
+static void font_variant_remove_glyph_index(Font_Variant* variant, int codepoint) {
+  SDL_assert(variant != nullptr);
+
+  if (font_variant_find_glyph_index(*variant, codepoint) == FONT_GLYPH_INDEX_NONE) { return; }
+  font_variant_insert_glyph_index(variant, codepoint, FONT_GLYPH_INDEX_NONE);
+}
+
+static uint32_t font_kerning_pair_key(uint16_t left, uint16_t right) {
+  return static_cast<uint32_t>(left) << 16 | right;
+}
+
+// Builds a kerning table of the given kind from the variant's kerning pairs. Pairs that reference
+// glyphs missing from the variant are dropped. A class table whose matrix would exceed
+// FONT_KERNING_MAX_CLASSES_BYTES is built as a pair table instead, decided from the class counts
+// before the matrix is allocated.
+static void font_kerning_table_build(
+    Font_Kerning_Table* table,
+    const Font_Variant& variant,
+    Font_Kerning_Kind   kind) {
+  SDL_assert(table != nullptr);
+
+  struct Pair {
+    uint16_t left;
+    uint16_t right;
+    float    advance;
+  };
+  std::vector<Pair> pairs;
+  pairs.reserve(variant.kernings.size());
+  for (const auto& kerning : variant.kernings) {
+    auto left  = font_variant_find_glyph_index(variant, kerning.unicode1);
+    auto right = font_variant_find_glyph_index(variant, kerning.unicode2);
+    if (left == FONT_GLYPH_INDEX_NONE || right == FONT_GLYPH_INDEX_NONE) { continue; }
+    pairs.push_back({left, right, kerning.advance});
+  }
+
+  auto glyphs_count = static_cast<int>(variant.glyphs.size());
+
+  auto build_pairs = [&]() {
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+      return font_kerning_pair_key(a.left, a.right) < font_kerning_pair_key(b.left, b.right);
+    });
+    table->pair_keys.reserve(pairs.size());
+    table->advances.reserve(pairs.size());
+    for (const auto& pair : pairs) {
+      table->pair_keys.push_back(font_kerning_pair_key(pair.left, pair.right));
+      table->advances.push_back(pair.advance);
+    }
+  };
+
+  *table      = {};
+  table->kind = kind;
+  switch (kind) {
+  case FONT_KERNING_KIND_DENSE: {
+    table->left_count  = glyphs_count;
+    table->right_count = glyphs_count;
+    table->advances.assign(static_cast<size_t>(glyphs_count) * glyphs_count, 0.0f);
+    for (const auto& pair : pairs) {
+      table->advances[static_cast<size_t>(pair.left) * glyphs_count + pair.right] = pair.advance;
+    }
+  } break;
+  case FONT_KERNING_KIND_CLASSES: {
+    // Glyphs whose kerning rows (or columns) are identical share a class. Class 0 is the empty row
+    // (or column), i.e. glyphs that are never kerned on that side.
+    auto assign_classes = [&](bool left_side, std::vector<uint16_t>* out_classes) {
+      std::sort(pairs.begin(), pairs.end(), [&](const Pair& a, const Pair& b) {
+        auto a_key = left_side ? font_kerning_pair_key(a.left, a.right)
+                               : font_kerning_pair_key(a.right, a.left);
+        auto b_key = left_side ? font_kerning_pair_key(b.left, b.right)
+                               : font_kerning_pair_key(b.right, b.left);
+        return a_key < b_key;
+      });
+
+      using Row = std::vector<std::pair<uint16_t, float>>;
+      std::map<Row, uint16_t> row_classes;
+      row_classes[Row()] = 0;
+      out_classes->assign(glyphs_count, 0);
+
+      size_t i = 0;
+      while (i < pairs.size()) {
+        auto glyph = left_side ? pairs[i].left : pairs[i].right;
+        Row  row;
+        for (; i < pairs.size() && (left_side ? pairs[i].left : pairs[i].right) == glyph; i++) {
+          row.emplace_back(left_side ? pairs[i].right : pairs[i].left, pairs[i].advance);
+        }
+        auto it = row_classes.find(row);
+        if (it == row_classes.end()) {
+          it = row_classes.emplace(std::move(row), static_cast<uint16_t>(row_classes.size())).first;
+        }
+        (*out_classes)[glyph] = it->second;
+      }
+      return static_cast<int>(row_classes.size());
+    };
+    table->left_count  = assign_classes(true, &table->left_classes);
+    table->right_count = assign_classes(false, &table->right_classes);
+    SDL_assert(table->left_count <= FONT_KERNING_MAX_CLASSES_PER_SIDE);
+    SDL_assert(table->right_count <= FONT_KERNING_MAX_CLASSES_PER_SIDE);
+
+    auto matrix_bytes = static_cast<size_t>(table->left_count) * table->right_count * sizeof(float);
+    if (matrix_bytes > FONT_KERNING_MAX_CLASSES_BYTES) {
+      *table      = {};
+      table->kind = FONT_KERNING_KIND_PAIRS;
+      build_pairs();
+      break;
+    }
+
+    table->advances.assign(static_cast<size_t>(table->left_count) * table->right_count, 0.0f);
+    for (const auto& pair : pairs) {
+      auto row    = table->left_classes[pair.left];
+      auto column = table->right_classes[pair.right];
+      table->advances[static_cast<size_t>(row) * table->right_count + column] = pair.advance;
+    }
+  } break;
+  case FONT_KERNING_KIND_PAIRS: {
+    build_pairs();
+  } break;
+  }
+}
+
+static size_t font_kerning_table_memory_size(const Font_Kerning_Table& table) {
+  return table.left_classes.size() * sizeof(uint16_t) +
+         table.right_classes.size() * sizeof(uint16_t) +
+         table.pair_keys.size() * sizeof(uint32_t) + table.advances.size() * sizeof(float);
+}
+
+static void font_variant_build_kerning_table(Font_Variant* variant) {
+  SDL_assert(variant != nullptr);
+
+  if (variant->glyphs.size() <= FONT_KERNING_DENSE_MAX_GLYPHS) {
+    font_kerning_table_build(&variant->kerning_table, *variant, FONT_KERNING_KIND_DENSE);
+    return;
+  }
+
+  font_kerning_table_build(&variant->kerning_table, *variant, FONT_KERNING_KIND_CLASSES);
+}
+
+static float font_kerning_table_lookup(const Font_Kerning_Table& table, uint16_t left, uint16_t right) {
+  switch (table.kind) {
+  case FONT_KERNING_KIND_DENSE:
+    return table.advances[static_cast<size_t>(left) * table.right_count + right];
+  case FONT_KERNING_KIND_CLASSES:
+    return table.advances
+        [static_cast<size_t>(table.left_classes[left]) * table.right_count +
+         table.right_classes[right]];
+  case FONT_KERNING_KIND_PAIRS: {
+    auto key = font_kerning_pair_key(left, right);
+    auto it  = std::lower_bound(table.pair_keys.begin(), table.pair_keys.end(), key);
+    if (it == table.pair_keys.end() || *it != key) { return 0.0f; }
+    return table.advances[it - table.pair_keys.begin()];
+  }
+  }
+  return 0.0f;
+}
+
+// Adds a pair to a pair table, or replaces its advance, keeping the pairs sorted. Lets tables whose
+// glyphs come and go, such as those of dynamic atlases, grow without being rebuilt.
+static void font_kerning_table_insert_pair(
+    Font_Kerning_Table* table,
+    uint16_t            left,
+    uint16_t            right,
+    float               advance) {
+  SDL_assert(table != nullptr);
+  SDL_assert(table->kind == FONT_KERNING_KIND_PAIRS);
+
+  auto key = font_kerning_pair_key(left, right);
+  auto it  = std::lower_bound(table->pair_keys.begin(), table->pair_keys.end(), key);
+  auto i   = it - table->pair_keys.begin();
+  if (it != table->pair_keys.end() && *it == key) {
+    table->advances[i] = advance;
+    return;
+  }
+  table->pair_keys.insert(it, key);
+  table->advances.insert(table->advances.begin() + i, advance);
+}
+
+// Drops the pairs of a pair table with a glyph flagged in removed_glyphs on either side, keeping
+// the rest sorted. Lets the slots of removed glyphs be reused by other glyphs.
+static void font_kerning_table_remove_glyphs(
+    Font_Kerning_Table*      table,
+    const std::vector<bool>& removed_glyphs) {
+  SDL_assert(table != nullptr);
+  SDL_assert(table->kind == FONT_KERNING_KIND_PAIRS);
+
+  auto is_removed = [&](uint32_t glyph_index) {
+    return glyph_index < removed_glyphs.size() && removed_glyphs[glyph_index];
+  };
+  size_t kept_count = 0;
+  for (size_t i = 0; i < table->pair_keys.size(); i++) {
+    auto key = table->pair_keys[i];
+    if (is_removed(key >> 16) || is_removed(key & 0xFFFF)) { continue; }
+    table->pair_keys[kept_count] = key;
+    table->advances[kept_count]  = table->advances[i];
+    kept_count += 1;
+  }
+  table->pair_keys.resize(kept_count);
+  table->advances.resize(kept_count);
+}
+
 void from_json(const nlohmann::json& j, Font_Glyph_Bounds& bounds) {
   j.at("left").get_to(bounds.left);
   j.at("bottom").get_to(bounds.bottom);
@@ -71,10 +418,18 @@ void from_json(const nlohmann::json& j, Font_Glyph_Bounds& bounds) {
 }
 
 void from_json(const nlohmann::json& j, Font_Glyph& glyph) {
+  glyph = {};
   j.at("unicode").get_to(glyph.unicode);
   j.at("advance").get_to(glyph.horizontal_advance);
-  if (j.contains("planeBounds")) { j.at("planeBounds").get_to(glyph.plane_bounds); }
-  if (j.contains("atlasBounds")) { j.at("atlasBounds").get_to(glyph.atlas_bounds); }
+  if (j.contains("planeBounds")) {
+    auto bounds        = j.at("planeBounds").get<Font_Glyph_Bounds>();
+    glyph.plane_bounds = HMM_V4(bounds.left, bounds.top, bounds.right, bounds.bottom);
+  }
+  // Atlas bounds stay in pixels here, they are normalized once the atlas size is known.
+  if (j.contains("atlasBounds")) {
+    auto bounds        = j.at("atlasBounds").get<Font_Glyph_Bounds>();
+    glyph.atlas_bounds = HMM_V4(bounds.left, bounds.top, bounds.right, bounds.bottom);
+  }
 }
 
 void from_json(const nlohmann::json& j, Font_Kerning& kerning) {
@@ -89,19 +444,24 @@ void from_json(const nlohmann::json& j, Font_Variant& variant) {
   metrics_j.at("ascender").get_to(variant.ascender);
   metrics_j.at("descender").get_to(variant.descender);
 
-  std::vector<Font_Glyph> glyphs;
-  j.at("glyphs").get_to(glyphs);
-  for (const auto& glyph : glyphs) { variant.glyphs[glyph.unicode] = glyph; }
+  j.at("glyphs").get_to(variant.glyphs);
+  font_variant_build_glyph_lookup(&variant);
 
-  std::vector<Font_Kerning> kernings;
-  j.at("kerning").get_to(kernings);
-  for (const auto& kerning : kernings) {
-    variant.kernings[font_atlas_pack_kerning(kerning.unicode1, kerning.unicode2)] = kerning.advance;
-  }
+  j.at("kerning").get_to(variant.kernings);
+  std::sort(
+      variant.kernings.begin(),
+      variant.kernings.end(),
+      [](const Font_Kerning& a, const Font_Kerning& b) {
+        return font_atlas_pack_kerning(a.unicode1, a.unicode2) <
+               font_atlas_pack_kerning(b.unicode1, b.unicode2);
+      });
+  font_variant_build_kerning_table(&variant);
 }
 
 void from_json(const nlohmann::json& j, Font_Atlas& font_atlas) {
   auto atlas_j = j.at("atlas");
+  font_atlas.type =
+      atlas_j.value("type", "msdf") == "mtsdf" ? FONT_ATLAS_TYPE_MTSDF : FONT_ATLAS_TYPE_MSDF;
   atlas_j.at("distanceRange").get_to(font_atlas.distance_range);
   atlas_j.at("size").get_to(font_atlas.size);
   atlas_j.at("width").get_to(font_atlas.width);
@@ -113,24 +473,97 @@ void from_json(const nlohmann::json& j, Font_Atlas& font_atlas) {
     auto& font_variant = font_atlas.variants.emplace_back();
     from_json(j, font_variant);
   }
+
+  auto atlas_width  = static_cast<float>(font_atlas.width);
+  auto atlas_height = static_cast<float>(font_atlas.height);
+  for (auto& variant : font_atlas.variants) {
+    for (auto& glyph : variant.glyphs) {
+      glyph.atlas_bounds = HMM_V4(
+          glyph.atlas_bounds.X / atlas_width,
+          1.0f - glyph.atlas_bounds.Y / atlas_height,
+          glyph.atlas_bounds.Z / atlas_width,
+          1.0f - glyph.atlas_bounds.W / atlas_height);
+    }
+  }
 }
 
-static bool font_atlas_load(
+// -- Binary Bundle ---------------------------------------------------------------
+//
+// A baked atlas bundle is the msdf-atlas-gen JSON + PNG output flattened into one file that can be
+// memory mapped and consumed without any parsing or image decoding. Layout (all offsets are from
+// the start of the file and 16 byte aligned):
+//
+//   Font_Atlas_Bundle_Header
+//   Font_Atlas_Bundle_Variant[variants_count]
+//   Font_Glyph[glyphs_count]      (grouped by variant)
+//   Font_Kerning[kernings_count]  (grouped by variant)
+//   uint8_t[width * height * 4]   (RGBA8 texels, top row first)
+//
+// Bump FONT_ATLAS_BUNDLE_VERSION whenever any of these structs change.
+
+static constexpr uint32_t FONT_ATLAS_BUNDLE_MAGIC   = 0x4644534D;  // "MSDF"
+static constexpr uint32_t FONT_ATLAS_BUNDLE_VERSION = 4;
+
+struct Font_Atlas_Bundle_Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t type;
+  float    distance_range;
+  float    size;
+  uint32_t width;
+  uint32_t height;
+  uint32_t variants_count;
+  uint32_t variants_offset;
+  uint32_t glyphs_count;
+  uint32_t glyphs_offset;
+  uint32_t kernings_count;
+  uint32_t kernings_offset;
+  uint32_t texels_size;
+  uint32_t texels_offset;
+};
+
+struct Font_Atlas_Bundle_Variant {
+  float    line_height;
+  float    ascender;
+  float    descender;
+  uint32_t first_glyph;
+  uint32_t glyphs_count;
+  uint32_t first_kerning;
+  uint32_t kernings_count;
+};
+
+static constexpr const char* FONT_ATLAS_KIND_NAMES[FONT_ATLAS_KIND_COUNT] = {
+    "roboto",
+    "science_gothic",
+    "limelight",
+    "roboto_dynamic",
+};
+
+// Texel data for an atlas that has been loaded on the CPU but not yet uploaded. Points either into
+// a mapped bundle or at a decoded PNG, whichever source the atlas was loaded from.
+struct Font_Atlas_Texels {
+  const uint8_t* data;
+  size_t         size;
+  Mapped_File    mapped_file;
+  stbi_uc*       decoded_pixels;
+};
+
+static void font_atlas_texels_release(Font_Atlas_Texels* texels) {
+  SDL_assert(texels != nullptr);
+
+  unmap_file(&texels->mapped_file);
+  if (texels->decoded_pixels != nullptr) { stbi_image_free(texels->decoded_pixels); }
+  *texels = {};
+}
+
+static bool font_atlas_load_json(
     Font_Atlas*        font_atlas,
-    Font_Atlas_Kind    kind,
     const std::string& base_path,
-    SDL_GPUDevice*     device,
-    SDL_GPUCopyPass*   copy_pass) {
+    const char*        atlas_name,
+    Font_Atlas_Texels* out_texels) {
   SDL_assert(font_atlas != nullptr);
-  SDL_assert(device != nullptr);
-  SDL_assert(copy_pass != nullptr);
-
-  static constexpr const char* font_atlas_kind_names[FONT_ATLAS_KIND_COUNT] = {
-      "roboto",
-      "science_gothic",
-      "limelight",
-  };
-  auto atlas_name = font_atlas_kind_names[kind];
+  SDL_assert(atlas_name != nullptr);
+  SDL_assert(out_texels != nullptr);
 
   auto        json_file_path = base_path + "/" + atlas_name + ".json";
   std::string json_file_contents;
@@ -154,94 +587,525 @@ static bool font_atlas_load(
   auto png_file_path = base_path + "/" + atlas_name + ".png";
   auto pixels        = stbi_load(png_file_path.c_str(), &x, &y, &n, 4);
   if (pixels == nullptr) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load image data from: %s", png_file_path);
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to load image data from: %s",
+        png_file_path.c_str());
+    return false;
+  }
+  if (x != font_atlas->width || y != font_atlas->height) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Image size does not match atlas size: %s",
+        png_file_path.c_str());
+    stbi_image_free(pixels);
     return false;
   }
-  defer(stbi_image_free(pixels));
 
-  {
-    SDL_GPUTextureCreateInfo info = {};
-    info.type                     = SDL_GPU_TEXTURETYPE_2D;
-    info.format                   = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
-    info.width                    = font_atlas->width;
-    info.height                   = font_atlas->height;
-    info.layer_count_or_depth     = 1;
-    info.num_levels               = 1;
-    info.usage                    = SDL_GPU_TEXTUREUSAGE_SAMPLER;
-    font_atlas->texture           = SDL_CreateGPUTexture(device, &info);
-    if (font_atlas->texture == nullptr) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture: %s", SDL_GetError());
-      return nullptr;
+  *out_texels                = {};
+  out_texels->data           = pixels;
+  out_texels->size           = static_cast<size_t>(x) * y * 4;
+  out_texels->decoded_pixels = pixels;
+
+  return true;
+}
+
+static bool font_atlas_load_bundle(
+    Font_Atlas*        font_atlas,
+    const std::string& base_path,
+    const char*        atlas_name,
+    Font_Atlas_Texels* out_texels) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(atlas_name != nullptr);
+  SDL_assert(out_texels != nullptr);
+
+  auto        bundle_file_path = base_path + "/" + atlas_name + ".atlas";
+  Mapped_File mapped_file;
+  if (!map_file(bundle_file_path, &mapped_file)) { return false; }
+
+  auto fail = [&](const char* reason) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Invalid font atlas bundle %s: %s",
+        bundle_file_path.c_str(),
+        reason);
+    unmap_file(&mapped_file);
+    return false;
+  };
+
+  auto in_bounds = [&](uint64_t offset, uint64_t count, uint64_t stride) {
+    return offset % 16 == 0 && offset + count * stride <= mapped_file.size;
+  };
+
+  if (mapped_file.size < sizeof(Font_Atlas_Bundle_Header)) { return fail("truncated header"); }
+  const auto header = reinterpret_cast<const Font_Atlas_Bundle_Header*>(mapped_file.data);
+  if (header->magic != FONT_ATLAS_BUNDLE_MAGIC) { return fail("bad magic"); }
+  if (header->version != FONT_ATLAS_BUNDLE_VERSION) { return fail("unsupported version"); }
+  if (header->type >= FONT_ATLAS_TYPE_COUNT) { return fail("bad type"); }
+  if (header->texels_size != static_cast<uint64_t>(header->width) * header->height * 4) {
+    return fail("texel size mismatch");
+  }
+  if (!in_bounds(
+          header->variants_offset,
+          header->variants_count,
+          sizeof(Font_Atlas_Bundle_Variant)) ||
+      !in_bounds(header->glyphs_offset, header->glyphs_count, sizeof(Font_Glyph)) ||
+      !in_bounds(header->kernings_offset, header->kernings_count, sizeof(Font_Kerning)) ||
+      !in_bounds(header->texels_offset, header->texels_size, 1)) {
+    return fail("section out of bounds");
+  }
+
+  const auto bundle_variants = reinterpret_cast<const Font_Atlas_Bundle_Variant*>(
+      mapped_file.data + header->variants_offset);
+  const auto bundle_glyphs =
+      reinterpret_cast<const Font_Glyph*>(mapped_file.data + header->glyphs_offset);
+  const auto bundle_kernings =
+      reinterpret_cast<const Font_Kerning*>(mapped_file.data + header->kernings_offset);
+
+  font_atlas->type           = static_cast<Font_Atlas_Type>(header->type);
+  font_atlas->distance_range = header->distance_range;
+  font_atlas->size           = header->size;
+  font_atlas->width          = static_cast<int>(header->width);
+  font_atlas->height         = static_cast<int>(header->height);
+  font_atlas->variants.clear();
+  font_atlas->variants.resize(header->variants_count);
+  for (uint32_t i = 0; i < header->variants_count; i++) {
+    const auto& bundle_variant = bundle_variants[i];
+    if (static_cast<uint64_t>(bundle_variant.first_glyph) + bundle_variant.glyphs_count >
+            header->glyphs_count ||
+        static_cast<uint64_t>(bundle_variant.first_kerning) + bundle_variant.kernings_count >
+            header->kernings_count) {
+      return fail("variant range out of bounds");
     }
+
+    auto& variant       = font_atlas->variants[i];
+    variant.line_height = bundle_variant.line_height;
+    variant.ascender    = bundle_variant.ascender;
+    variant.descender   = bundle_variant.descender;
+    variant.glyphs.assign(
+        bundle_glyphs + bundle_variant.first_glyph,
+        bundle_glyphs + bundle_variant.first_glyph + bundle_variant.glyphs_count);
+    font_variant_build_glyph_lookup(&variant);
+    variant.kernings.assign(
+        bundle_kernings + bundle_variant.first_kerning,
+        bundle_kernings + bundle_variant.first_kerning + bundle_variant.kernings_count);
+    font_variant_build_kerning_table(&variant);
+  }
+
+  *out_texels             = {};
+  out_texels->data        = mapped_file.data + header->texels_offset;
+  out_texels->size        = header->texels_size;
+  out_texels->mapped_file = mapped_file;
+
+  return true;
+}
+
+// Writes the JSON + PNG output of msdf-atlas-gen for the given atlas as a binary bundle next to it.
+static bool font_atlas_bake(const std::string& base_path, const char* atlas_name) {
+  SDL_assert(atlas_name != nullptr);
+
+  Font_Atlas        font_atlas;
+  Font_Atlas_Texels texels;
+  if (!font_atlas_load_json(&font_atlas, base_path, atlas_name, &texels)) { return false; }
+  defer(font_atlas_texels_release(&texels));
+
+  auto align = [](size_t offset) { return (offset + 15) & ~static_cast<size_t>(15); };
+
+  std::vector<Font_Atlas_Bundle_Variant> bundle_variants;
+  std::vector<Font_Glyph>                bundle_glyphs;
+  std::vector<Font_Kerning>              bundle_kernings;
+  for (const auto& variant : font_atlas.variants) {
+    auto& bundle_variant          = bundle_variants.emplace_back();
+    bundle_variant.line_height    = variant.line_height;
+    bundle_variant.ascender       = variant.ascender;
+    bundle_variant.descender      = variant.descender;
+    bundle_variant.first_glyph    = static_cast<uint32_t>(bundle_glyphs.size());
+    bundle_variant.glyphs_count   = static_cast<uint32_t>(variant.glyphs.size());
+    bundle_variant.first_kerning  = static_cast<uint32_t>(bundle_kernings.size());
+    bundle_variant.kernings_count = static_cast<uint32_t>(variant.kernings.size());
+
+    bundle_glyphs.insert(bundle_glyphs.end(), variant.glyphs.begin(), variant.glyphs.end());
+
+    bundle_kernings.insert(bundle_kernings.end(), variant.kernings.begin(), variant.kernings.end());
+  }
+
+  Font_Atlas_Bundle_Header header = {};
+  header.magic                    = FONT_ATLAS_BUNDLE_MAGIC;
+  header.version                  = FONT_ATLAS_BUNDLE_VERSION;
+  header.type                     = static_cast<uint32_t>(font_atlas.type);
+  header.distance_range           = font_atlas.distance_range;
+  header.size                     = font_atlas.size;
+  header.width                    = static_cast<uint32_t>(font_atlas.width);
+  header.height                   = static_cast<uint32_t>(font_atlas.height);
+  header.variants_count           = static_cast<uint32_t>(bundle_variants.size());
+  header.glyphs_count             = static_cast<uint32_t>(bundle_glyphs.size());
+  header.kernings_count           = static_cast<uint32_t>(bundle_kernings.size());
+  header.texels_size              = static_cast<uint32_t>(texels.size);
+
+  size_t offset          = align(sizeof(header));
+  header.variants_offset = static_cast<uint32_t>(offset);
+  offset                 = align(offset + sizeof(Font_Atlas_Bundle_Variant) * bundle_variants.size());
+  header.glyphs_offset   = static_cast<uint32_t>(offset);
+  offset                 = align(offset + sizeof(Font_Glyph) * bundle_glyphs.size());
+  header.kernings_offset = static_cast<uint32_t>(offset);
+  offset                 = align(offset + sizeof(Font_Kerning) * bundle_kernings.size());
+  header.texels_offset   = static_cast<uint32_t>(offset);
+  offset += texels.size;
+
+  std::vector<uint8_t> contents(offset, 0);
+  auto                 write = [&](uint32_t at, const void* data, size_t size) {
+    if (size > 0) { SDL_memcpy(contents.data() + at, data, size); }
+  };
+  write(0, &header, sizeof(header));
+  write(
+      header.variants_offset,
+      bundle_variants.data(),
+      sizeof(Font_Atlas_Bundle_Variant) * bundle_variants.size());
+  write(header.glyphs_offset, bundle_glyphs.data(), sizeof(Font_Glyph) * bundle_glyphs.size());
+  write(
+      header.kernings_offset,
+      bundle_kernings.data(),
+      sizeof(Font_Kerning) * bundle_kernings.size());
+  write(header.texels_offset, texels.data, texels.size);
+
+  auto bundle_file_path = base_path + "/" + atlas_name + ".atlas";
+  if (!SDL_SaveFile(bundle_file_path.c_str(), contents.data(), contents.size())) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to write font atlas bundle %s: %s",
+        bundle_file_path.c_str(),
+        SDL_GetError());
+    return false;
+  }
+
+  SDL_Log(
+      "Baked font atlas bundle %s (%d variants, %d glyphs, %d kernings, %zu bytes)",
+      bundle_file_path.c_str(),
+      static_cast<int>(bundle_variants.size()),
+      static_cast<int>(bundle_glyphs.size()),
+      static_cast<int>(bundle_kernings.size()),
+      contents.size());
+
+  return true;
+}
+
+// -- Loading ---------------------------------------------------------------------
+
+static bool
+font_atlas_array_create(Font_Atlas_Array* array, SDL_GPUDevice* device, int layers_count) {
+  SDL_assert(array != nullptr);
+  SDL_assert(device != nullptr);
+  SDL_assert(layers_count > 0);
+
+  SDL_GPUTextureCreateInfo info = {};
+  info.type                     = SDL_GPU_TEXTURETYPE_2D_ARRAY;
+  info.format                   = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+  info.width                    = FONT_ATLAS_LAYER_SIZE;
+  info.height                   = FONT_ATLAS_LAYER_SIZE;
+  info.layer_count_or_depth     = layers_count;
+  info.num_levels               = 1;
+  info.usage                    = SDL_GPU_TEXTUREUSAGE_SAMPLER;
+  array->texture                = SDL_CreateGPUTexture(device, &info);
+  if (array->texture == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture: %s", SDL_GetError());
+    return false;
+  }
+  array->layers_count = layers_count;
+
+  info.type                 = SDL_GPU_TEXTURETYPE_2D;
+  info.layer_count_or_depth = 1;
+  array->preview_texture    = SDL_CreateGPUTexture(device, &info);
+  if (array->preview_texture == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create texture: %s", SDL_GetError());
+    return false;
   }
 
-  SDL_GPUTransferBuffer* transfer_buffer;
   {
-    SDL_GPUTransferBufferCreateInfo info = {};
-    info.usage                           = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    info.size                            = font_atlas->width * font_atlas->height * 4;
-    transfer_buffer                      = SDL_CreateGPUTransferBuffer(device, &info);
-    if (transfer_buffer == nullptr) {
+    SDL_GPUBufferCreateInfo info = {};
+    info.size                    = sizeof(Font_Glyph_Metrics) * FONT_ATLAS_MAX_GLYPH_METRICS;
+    info.usage =
+        SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ;
+    array->glyph_metrics_buffer  = SDL_CreateGPUBuffer(device, &info);
+    if (array->glyph_metrics_buffer == nullptr) {
       SDL_LogError(
           SDL_LOG_CATEGORY_APPLICATION,
-          "Failed to create transfer buffer: %s",
+          "Failed to create glyph metrics buffer: %s",
           SDL_GetError());
       return false;
     }
+    array->glyph_metrics_count = 0;
+  }
+
+  return true;
+}
+
+static void font_atlas_array_destroy(Font_Atlas_Array* array, SDL_GPUDevice* device) {
+  SDL_assert(array != nullptr);
+  SDL_assert(device != nullptr);
+
+  SDL_ReleaseGPUTexture(device, array->texture);
+  SDL_ReleaseGPUTexture(device, array->preview_texture);
+  SDL_ReleaseGPUBuffer(device, array->glyph_metrics_buffer);
+  array->texture              = nullptr;
+  array->preview_texture      = nullptr;
+  array->glyph_metrics_buffer = nullptr;
+  array->glyph_metrics_count  = 0;
+}
+
+// Reserves count consecutive entries of the glyph metrics table. Returns the first one, or -1 when
+// the table is full.
+static int font_atlas_array_reserve_glyph_metrics(Font_Atlas_Array* array, int count) {
+  SDL_assert(array != nullptr);
+  SDL_assert(count >= 0);
+
+  if (array->glyph_metrics_count + count > FONT_ATLAS_MAX_GLYPH_METRICS) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Glyph metrics table is full: %d + %d entries",
+        array->glyph_metrics_count,
+        count);
+    return -1;
+  }
+
+  int offset = array->glyph_metrics_count;
+  array->glyph_metrics_count += count;
+  return offset;
+}
+
+static Font_Glyph_Metrics font_glyph_metrics(const Font_Glyph& glyph) {
+  Font_Glyph_Metrics metrics = {};
+  metrics.plane_bounds       = glyph.plane_bounds;
+  metrics.atlas_bounds       = glyph.atlas_bounds;
+  metrics.layer              = glyph.layer;
+  return metrics;
+}
+
+// Queues a copy of a layer of the array into the preview texture, after the uploads queued so far.
+static void font_atlas_array_update_preview(
+    Font_Atlas_Array* array,
+    int               layer,
+    Upload_Scheduler* upload_scheduler) {
+  SDL_assert(array != nullptr);
+  SDL_assert(layer >= 0 && layer < array->layers_count);
+  SDL_assert(upload_scheduler != nullptr);
+
+  SDL_GPUTextureLocation source = {};
+  source.texture                = array->texture;
+  source.layer                  = static_cast<uint32_t>(layer);
+  SDL_GPUTextureLocation dest   = {};
+  dest.texture                  = array->preview_texture;
+  upload_scheduler_copy_texture(
+      upload_scheduler,
+      source,
+      dest,
+      FONT_ATLAS_LAYER_SIZE,
+      FONT_ATLAS_LAYER_SIZE);
+}
+
+// Queues the upload of the texels of a baked atlas into its layer of the array, renormalizes the
+// atlas bounds of its glyphs from the atlas size to the layer size and queues their upload into a
+// range of the glyph metrics table reserved for the atlas.
+static bool font_atlas_upload(
+    Font_Atlas*              font_atlas,
+    const Font_Atlas_Texels& texels,
+    Font_Atlas_Array*        array,
+    Upload_Scheduler*        upload_scheduler) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(texels.data != nullptr);
+  SDL_assert(texels.size == static_cast<size_t>(font_atlas->width) * font_atlas->height * 4);
+  SDL_assert(array != nullptr);
+  SDL_assert(font_atlas->layer >= 0 && font_atlas->layer < array->layers_count);
+  SDL_assert(upload_scheduler != nullptr);
+
+  if (font_atlas->width > FONT_ATLAS_LAYER_SIZE || font_atlas->height > FONT_ATLAS_LAYER_SIZE) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Font atlas is %dx%d, larger than a font atlas array layer (%d)",
+        font_atlas->width,
+        font_atlas->height,
+        FONT_ATLAS_LAYER_SIZE);
+    return false;
+  }
+
+  int glyphs_count = 0;
+  for (const auto& variant : font_atlas->variants) {
+    glyphs_count += static_cast<int>(variant.glyphs.size());
+  }
+  int glyph_metrics_offset = font_atlas_array_reserve_glyph_metrics(array, glyphs_count);
+  if (glyph_metrics_offset < 0) { return false; }
+
+  auto scale = HMM_V4(
+      static_cast<float>(font_atlas->width) / FONT_ATLAS_LAYER_SIZE,
+      static_cast<float>(font_atlas->height) / FONT_ATLAS_LAYER_SIZE,
+      static_cast<float>(font_atlas->width) / FONT_ATLAS_LAYER_SIZE,
+      static_cast<float>(font_atlas->height) / FONT_ATLAS_LAYER_SIZE);
+  int variant_offset = glyph_metrics_offset;
+  for (auto& variant : font_atlas->variants) {
+    variant.glyph_metrics_offset = variant_offset;
+    variant_offset += static_cast<int>(variant.glyphs.size());
+    for (auto& glyph : variant.glyphs) {
+      glyph.atlas_bounds = glyph.atlas_bounds * scale;
+      glyph.layer        = static_cast<uint32_t>(font_atlas->layer);
+    }
   }
-  defer(SDL_ReleaseGPUTransferBuffer(device, transfer_buffer));
 
-  auto pixels_ptr = SDL_MapGPUTransferBuffer(device, transfer_buffer, false);
-  if (pixels_ptr == nullptr) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map transfer buffer: %s", SDL_GetError());
+  // The glyph metrics follow the texels in the allocation, 16 byte aligned for their vector
+  // members.
+  auto metrics_offset = static_cast<uint32_t>((texels.size + 15) & ~static_cast<size_t>(15));
+  auto metrics_size   = static_cast<uint32_t>(sizeof(Font_Glyph_Metrics) * glyphs_count);
+
+  Upload_Allocation allocation;
+  if (!upload_scheduler_allocate(
+          upload_scheduler,
+          UPLOAD_CLIENT_FONT_ATLAS,
+          metrics_offset + metrics_size,
+          &allocation)) {
     return false;
   }
-  SDL_memcpy(pixels_ptr, pixels, font_atlas->width * font_atlas->height * 4);
-  SDL_UnmapGPUTransferBuffer(device, transfer_buffer);
+  SDL_memcpy(allocation.ptr, texels.data, texels.size);
+  auto metrics_ptr = reinterpret_cast<Font_Glyph_Metrics*>(allocation.ptr + metrics_offset);
+  for (const auto& variant : font_atlas->variants) {
+    for (const auto& glyph : variant.glyphs) { *metrics_ptr++ = font_glyph_metrics(glyph); }
+  }
 
   {
-    SDL_GPUTextureTransferInfo transfer_info = {};
-    transfer_info.transfer_buffer            = transfer_buffer;
-    transfer_info.offset                     = 0;
-    SDL_GPUTextureRegion region              = {};
-    region.texture                           = font_atlas->texture;
-    region.w                                 = font_atlas->width;
-    region.h                                 = font_atlas->height;
-    region.d                                 = 1;
-    SDL_UploadToGPUTexture(copy_pass, &transfer_info, &region, false);
+    SDL_GPUTextureRegion region = {};
+    region.texture              = array->texture;
+    region.layer                = static_cast<uint32_t>(font_atlas->layer);
+    region.w                    = font_atlas->width;
+    region.h                    = font_atlas->height;
+    region.d                    = 1;
+    upload_scheduler_upload_to_texture(upload_scheduler, allocation, 0, region);
+  }
+
+  if (glyphs_count > 0) {
+    upload_scheduler_upload_to_buffer(
+        upload_scheduler,
+        allocation,
+        metrics_offset,
+        array->glyph_metrics_buffer,
+        static_cast<uint32_t>(sizeof(Font_Glyph_Metrics) * glyph_metrics_offset),
+        metrics_size);
   }
 
   return true;
 }
 
-static void font_atlas_destroy(Font_Atlas* font_atlas, SDL_GPUDevice* device) {
-  SDL_assert(device != nullptr);
+// CPU side of loading an atlas: reads the baked bundle, or the JSON + PNG if no bundle exists.
+// Safe to call from worker threads.
+static bool font_atlas_load_cpu(
+    Font_Atlas*        font_atlas,
+    Font_Atlas_Kind    kind,
+    const std::string& base_path,
+    Font_Atlas_Texels* out_texels) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(out_texels != nullptr);
+
+  auto atlas_name = FONT_ATLAS_KIND_NAMES[kind];
+  if (font_atlas_load_bundle(font_atlas, base_path, atlas_name, out_texels)) { return true; }
+
+  SDL_Log("Falling back to json + png for font atlas: %s", atlas_name);
+  return font_atlas_load_json(font_atlas, base_path, atlas_name, out_texels);
+}
+
+struct Font_Atlas_Load_Job {
+  Font_Atlas*        font_atlas;
+  Font_Atlas_Kind    kind;
+  const std::string* base_path;
+  Font_Atlas_Texels  texels;
+  bool               succeeded;
+  double             load_ms;
+};
+
+static void font_atlas_load_job(void* user_data) {
+  auto job           = static_cast<Font_Atlas_Load_Job*>(user_data);
+  auto start_counter = SDL_GetPerformanceCounter();
+  job->succeeded     = font_atlas_load_cpu(job->font_atlas, job->kind, *job->base_path, &job->texels);
+  job->load_ms       = static_cast<double>(SDL_GetPerformanceCounter() - start_counter) * 1000.0 /
+                 static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+// Loads every baked atlas kind into font_atlases. The CPU side of each atlas runs as a job on the thread
+// pool, only the GPU uploads are recorded on the calling thread.
+// Baked atlas kind i takes layer i of the array.
+static bool font_atlas_load_all(
+    Font_Atlas*        font_atlases,
+    const std::string& base_path,
+    Font_Atlas_Array*  array,
+    Upload_Scheduler*  upload_scheduler,
+    Thread_Pool*       thread_pool) {
+  SDL_assert(font_atlases != nullptr);
+  SDL_assert(array != nullptr);
+  SDL_assert(upload_scheduler != nullptr);
+  SDL_assert(thread_pool != nullptr);
+
+  auto start_counter = SDL_GetPerformanceCounter();
+  auto elapsed_ms    = [](uint64_t from_counter) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - from_counter) * 1000.0 /
+           static_cast<double>(SDL_GetPerformanceFrequency());
+  };
+
+  Font_Atlas_Load_Job jobs[FONT_ATLAS_KIND_BAKED_COUNT] = {};
+  for (int i = 0; i < FONT_ATLAS_KIND_BAKED_COUNT; i++) {
+    jobs[i].font_atlas = &font_atlases[i];
+    jobs[i].kind       = static_cast<Font_Atlas_Kind>(i);
+    jobs[i].base_path  = &base_path;
+    thread_pool_push(thread_pool, font_atlas_load_job, &jobs[i]);
+  }
+  thread_pool_wait(thread_pool);
+
+  bool succeeded = true;
+  for (int i = 0; i < FONT_ATLAS_KIND_BAKED_COUNT; i++) {
+    auto& job = jobs[i];
+    defer(font_atlas_texels_release(&job.texels));
+    if (!job.succeeded) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to load font atlas: %s",
+          FONT_ATLAS_KIND_NAMES[i]);
+      succeeded = false;
+      continue;
+    }
+
+    job.font_atlas->layer        = i;
+    job.font_atlas->layers_count = 1;
+
+    auto upload_start_counter = SDL_GetPerformanceCounter();
+    if (!font_atlas_upload(job.font_atlas, job.texels, array, upload_scheduler)) {
+      succeeded = false;
+      continue;
+    }
+    SDL_Log(
+        "Loaded font atlas %s: %.3f ms cpu (worker), %.3f ms upload",
+        FONT_ATLAS_KIND_NAMES[i],
+        job.load_ms,
+        elapsed_ms(upload_start_counter));
+  }
 
-  SDL_ReleaseGPUTexture(device, font_atlas->texture);
+  SDL_Log(
+      "Loaded %d font atlases in %.3f ms",
+      FONT_ATLAS_KIND_BAKED_COUNT,
+      elapsed_ms(start_counter));
+
+  return succeeded;
 }
 
 static float
 font_atlas_string_width(const Font_Variant& font_data, std::string_view text, float size) {
-  float       width          = 0.0f;
-  const char* ptr            = text.data();
-  auto        str_size       = text.size();
-  int         codepoint      = SDL_INVALID_UNICODE_CODEPOINT;
-  int         prev_codepoint = 0;
-  while (codepoint != 0) {
-    codepoint = SDL_StepUTF8(&ptr, &str_size);
-    if (codepoint == SDL_INVALID_UNICODE_CODEPOINT) { continue; }
-
-    auto glyph_it = font_data.glyphs.find(codepoint);
-    if (glyph_it == font_data.glyphs.end()) { continue; }
-
-    if (prev_codepoint != 0) {
-      auto kerning_it = font_data.kernings.find(font_atlas_pack_kerning(prev_codepoint, codepoint));
-      if (kerning_it != font_data.kernings.end()) { width += kerning_it->second * size; }
+  float    width            = 0.0f;
+  uint16_t prev_glyph_index = FONT_GLYPH_INDEX_NONE;
+  utf8_for_each_codepoint(text, [&](uint32_t codepoint) {
+    auto glyph_index = font_variant_find_glyph_index(font_data, codepoint);
+    if (glyph_index == FONT_GLYPH_INDEX_NONE) { return; }
+
+    if (prev_glyph_index != FONT_GLYPH_INDEX_NONE) {
+      width += font_kerning_table_lookup(font_data.kerning_table, prev_glyph_index, glyph_index) *
+               size;
     }
-    prev_codepoint = codepoint;
+    prev_glyph_index = glyph_index;
 
-    width += glyph_it->second.horizontal_advance * size;
-  }
+    width += font_data.glyphs[glyph_index].horizontal_advance * size;
+  });
   return width;
 }
 
@@ -249,29 +1113,18 @@ static HMM_Vec2 font_atlas_string_multiline_block_size(
     const Font_Variant& font_data,
     std::string_view    text,
     float               size) {
-  int         lines_count    = 1;
-  float       max_line_width = 0.0f;
-  const char* ptr            = text.data();
-  auto        str_size       = text.size();
-  const char* line_start     = ptr;
-  int         codepoint      = SDL_INVALID_UNICODE_CODEPOINT;
-  while (codepoint != 0) {
-    codepoint = SDL_StepUTF8(&ptr, &str_size);
-    if (codepoint == SDL_INVALID_UNICODE_CODEPOINT) { continue; }
-
-    if (codepoint == 10) {
-      std::string_view line(line_start, static_cast<size_t>(ptr - line_start - 1));
-      float            line_width = font_atlas_string_width(font_data, line, size);
-      max_line_width              = std::max(max_line_width, line_width);
-      line_start                  = ptr;
-      lines_count += 1;
-    }
-  }
+  // A line feed byte is never part of a multibyte sequence, lines are split without decoding.
+  int    lines_count    = 1;
+  float  max_line_width = 0.0f;
+  size_t line_start     = 0;
+  while (true) {
+    auto line_end  = text.find('\n', line_start);
+    auto line      = text.substr(line_start, line_end - line_start);
+    max_line_width = std::max(max_line_width, font_atlas_string_width(font_data, line, size));
+    if (line_end == std::string_view::npos) { break; }
 
-  if (ptr > line_start) {
-    std::string_view line(line_start, static_cast<size_t>(ptr - line_start));
-    float            line_width = font_atlas_string_width(font_data, line, size);
-    max_line_width              = std::max(max_line_width, line_width);
+    line_start   = line_end + 1;
+    lines_count += 1;
   }
 
   return HMM_V2(max_line_width, lines_count * font_data.line_height * size);
@@ -0,0 +1,52 @@
+// Converts the JSON + PNG output of msdf-atlas-gen into the binary font atlas bundles that are
+// memory mapped by font_atlas_load_all at startup. Run from the directory containing the atlases,
+// or pass that directory as the first argument.
+
+// -- External Header Includes ------------------------------------------------
+#include <HandmadeMath.h>
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_intrin.h>
+#include <json.hpp>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// -- Std Header Includes -----------------------------------------------------
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// -- Platform Header Includes ------------------------------------------------
+#if defined(SDL_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -- Local Source Includes ---------------------------------------------------
+#include "common.cpp"
+#include "thread_pool.cpp"
+#include "upload_scheduler.cpp"
+#include "font_atlas.cpp"
+
+int main(int argc, char* argv[]) {
+  std::string base_path = argc > 1 ? argv[1] : ".";
+
+  for (int i = 0; i < FONT_ATLAS_KIND_BAKED_COUNT; i++) {
+    if (!font_atlas_bake(base_path, FONT_ATLAS_KIND_NAMES[i])) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to bake font atlas: %s",
+          FONT_ATLAS_KIND_NAMES[i]);
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,813 @@
+// A dynamic font atlas starts out empty and generates MTSDF glyphs from the TTFs on demand. Glyph
+// metrics are read from the font as soon as a glyph is requested. The distance field is generated
+// on the thread pool, along with the kerning of the glyph against the glyphs the variant already
+// has, and packed into the atlas by font_atlas_dynamic_update, which only uploads the texels that
+// changed. Until then the glyph keeps empty bounds and is not emitted. Its kerning pairs are added
+// to the variant's pair table when its job completes, so layout doesn't change once the glyph
+// shows up.
+//
+// The atlas memory is fixed: its layers of the font atlas array are split into pages stacked
+// vertically (the atlas is laid out as one tall image, FONT_ATLAS_LAYER_SIZE rows per layer), each
+// packed with its own skyline packer. Text batches stamp the frame number on every glyph they
+// draw. When no page has room left, the page with the fewest recently drawn glyphs is compacted:
+// its cold glyphs are evicted and the rest are packed again from scratch. Glyphs drawn in the
+// current frame never move.
+//
+// Every variant reserves FONT_ATLAS_DYNAMIC_MAX_GLYPHS glyph slots, each with its entry of the
+// glyph metrics table. Entries of glyphs placed, moved or evicted since the last update are
+// uploaded along with the texels. An evicted glyph gives up its slot: its codepoints and kerning
+// pairs are removed and the slot goes on a free list, to be reused by the next glyph requested. So
+// the cap only applies to the glyphs a variant holds at once, and evicted codepoints are simply
+// requested again the next time they are drawn.
+
+static constexpr int FONT_ATLAS_DYNAMIC_WIDTH       = FONT_ATLAS_LAYER_SIZE;
+static constexpr int FONT_ATLAS_DYNAMIC_PAGE_HEIGHT = FONT_ATLAS_LAYER_SIZE / 2;
+static constexpr int FONT_ATLAS_DYNAMIC_PAGES_COUNT = 4;
+static constexpr int FONT_ATLAS_DYNAMIC_LAYERS_COUNT =
+    FONT_ATLAS_DYNAMIC_PAGE_HEIGHT * FONT_ATLAS_DYNAMIC_PAGES_COUNT / FONT_ATLAS_LAYER_SIZE;
+// Glyphs drawn within this many frames survive the compaction of their page.
+static constexpr uint64_t FONT_ATLAS_DYNAMIC_WARM_FRAMES = 120;
+// Same atlas type, glyph size and distance range as the baked atlases (msdf_common in build.bat).
+static constexpr float FONT_ATLAS_DYNAMIC_SIZE           = 72.0f;
+static constexpr float FONT_ATLAS_DYNAMIC_DISTANCE_RANGE = 4.0f;
+// Texels around the glyph outline, enough to hold half the distance range plus bilinear filtering.
+static constexpr int FONT_ATLAS_DYNAMIC_GLYPH_PADDING = 3;
+static constexpr int FONT_ATLAS_DYNAMIC_GLYPH_SPACING = 1;
+static constexpr int FONT_ATLAS_DYNAMIC_MAX_GLYPHS    = 4096;
+
+static constexpr const char* FONT_ATLAS_DYNAMIC_ROBOTO_FILES[FONT_ATLAS_ROBOTO_VARIANT_COUNT] = {
+    "Roboto-Regular.ttf",
+    "Roboto-Bold.ttf",
+    "Roboto-Italic.ttf",
+    "Roboto-BoldItalic.ttf",
+    "Roboto-Light.ttf",
+};
+
+// Glyph bitmap rectangle in pixels at the atlas size, relative to the glyph origin with y up.
+struct Font_Atlas_Dynamic_Glyph_Box {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+enum Font_Atlas_Dynamic_Glyph_State : uint8_t {
+  FONT_ATLAS_DYNAMIC_GLYPH_STATE_EMPTY,
+  FONT_ATLAS_DYNAMIC_GLYPH_STATE_PENDING,
+  FONT_ATLAS_DYNAMIC_GLYPH_STATE_RESIDENT,
+  FONT_ATLAS_DYNAMIC_GLYPH_STATE_FREE,
+};
+
+// Per glyph state is stored in arrays parallel to the variant's glyphs. Glyphs in
+// [dirty_glyphs_begin, dirty_glyphs_end) have glyph metrics waiting to be uploaded. The codepoints
+// mapped to the .notdef glyph are kept so they can be unmapped when it is evicted.
+struct Font_Atlas_Dynamic_Font {
+  std::vector<uint8_t>                        ttf_data;
+  stbtt_fontinfo                              info;
+  float                                       em_scale;
+  std::vector<int>                            ttf_glyphs;
+  std::vector<SDL_Rect>                       glyph_rects;
+  std::vector<Font_Atlas_Dynamic_Glyph_State> glyph_states;
+  std::vector<uint64_t>                       glyph_last_used_frames;
+  std::vector<uint16_t>                       free_glyph_indices;
+  uint16_t                                    notdef_glyph_index;
+  std::vector<int>                            notdef_codepoints;
+  int                                         dirty_glyphs_begin;
+  int                                         dirty_glyphs_end;
+};
+
+struct Font_Atlas_Dynamic_Page {
+  Skyline_Packer packer;
+  int            glyphs_count;
+  int            used_area;
+};
+
+struct Font_Atlas_Dynamic;
+
+struct Font_Atlas_Dynamic_Kerning_Glyph {
+  int codepoint;
+  int ttf_glyph;
+};
+
+// Jobs of glyphs without an outline have an empty box and only probe kerning. kernings are the
+// nonzero pairs of the glyph with kerning_glyphs, in either order, by codepoint.
+struct Font_Atlas_Dynamic_Job {
+  Font_Atlas_Dynamic*                           dynamic;
+  const Font_Atlas_Dynamic_Font*                font;
+  int                                           font_variant;
+  uint16_t                                      glyph_index;
+  int                                           codepoint;
+  int                                           ttf_glyph;
+  Font_Atlas_Dynamic_Glyph_Box                  box;
+  std::vector<Font_Atlas_Dynamic_Kerning_Glyph> kerning_glyphs;
+  std::vector<Font_Kerning>                     kernings;
+  std::vector<uint8_t>                          texels;
+  double                                        generate_ms;
+};
+
+struct Font_Atlas_Dynamic {
+  std::vector<Font_Atlas_Dynamic_Font> fonts;
+  Thread_Pool*                         thread_pool;
+  SDL_Mutex*                           mutex;
+  std::vector<Font_Atlas_Dynamic_Job*> completed_jobs;
+  std::vector<Font_Atlas_Dynamic_Job*> unplaced_jobs;
+  int                                  pending_jobs_count;
+  std::vector<uint8_t>                 texels;
+  Font_Atlas_Dynamic_Page              pages[FONT_ATLAS_DYNAMIC_PAGES_COUNT];
+  uint64_t                             frame;
+  std::vector<SDL_Rect>                dirty_rects;
+  bool                                 texture_outdated;
+  SDL_GPUTexture*                      texture;
+  SDL_GPUBuffer*                       glyph_metrics_buffer;
+  int                                  resident_glyphs_count;
+  int                                  generated_glyphs_count;
+  double                               generate_ms;
+  uint32_t                             uploaded_bytes;
+  uint64_t                             hits_count;
+  uint64_t                             misses_count;
+  uint64_t                             evicted_glyphs_count;
+  uint64_t                             recycled_glyphs_count;
+  uint64_t                             compacted_pages_count;
+};
+
+static bool font_atlas_dynamic_glyph_box(
+    const Font_Atlas_Dynamic_Font& font,
+    int                            ttf_glyph,
+    Font_Atlas_Dynamic_Glyph_Box*  out_box) {
+  SDL_assert(out_box != nullptr);
+
+  int x0, y0, x1, y1;
+  if (stbtt_IsGlyphEmpty(&font.info, ttf_glyph) ||
+      !stbtt_GetGlyphBox(&font.info, ttf_glyph, &x0, &y0, &x1, &y1)) {
+    return false;
+  }
+
+  float scale     = font.em_scale * FONT_ATLAS_DYNAMIC_SIZE;
+  out_box->x      = static_cast<int>(SDL_floorf(x0 * scale)) - FONT_ATLAS_DYNAMIC_GLYPH_PADDING;
+  out_box->y      = static_cast<int>(SDL_floorf(y0 * scale)) - FONT_ATLAS_DYNAMIC_GLYPH_PADDING;
+  out_box->width =
+      static_cast<int>(SDL_ceilf(x1 * scale)) + FONT_ATLAS_DYNAMIC_GLYPH_PADDING - out_box->x;
+  out_box->height =
+      static_cast<int>(SDL_ceilf(y1 * scale)) + FONT_ATLAS_DYNAMIC_GLYPH_PADDING - out_box->y;
+  return true;
+}
+
+// Generates the RGBA8 MTSDF texels (top row first) of a glyph into out_texels, which must hold
+// box.width * box.height texels. Safe to call from worker threads.
+static void font_atlas_dynamic_generate_glyph(
+    const Font_Atlas_Dynamic_Font&      font,
+    int                                 ttf_glyph,
+    const Font_Atlas_Dynamic_Glyph_Box& box,
+    uint8_t*                            out_texels) {
+  SDL_assert(out_texels != nullptr);
+
+  stbtt_vertex* vertices;
+  int           vertices_count = stbtt_GetGlyphShape(&font.info, ttf_glyph, &vertices);
+  defer(stbtt_FreeShape(&font.info, vertices));
+
+  msdf_generate(
+      vertices,
+      vertices_count,
+      font.em_scale * FONT_ATLAS_DYNAMIC_SIZE,
+      HMM_V2(box.x, box.y),
+      FONT_ATLAS_DYNAMIC_DISTANCE_RANGE,
+      box.width,
+      box.height,
+      out_texels);
+}
+
+static void font_atlas_dynamic_job(void* user_data) {
+  auto        job           = static_cast<Font_Atlas_Dynamic_Job*>(user_data);
+  const auto& font          = *job->font;
+  auto        start_counter = SDL_GetPerformanceCounter();
+
+  if (job->box.width > 0) {
+    job->texels.resize(static_cast<size_t>(job->box.width) * job->box.height * 4);
+    font_atlas_dynamic_generate_glyph(font, job->ttf_glyph, job->box, job->texels.data());
+  }
+  job->generate_ms = static_cast<double>(SDL_GetPerformanceCounter() - start_counter) * 1000.0 /
+                     static_cast<double>(SDL_GetPerformanceFrequency());
+
+  for (const auto& other : job->kerning_glyphs) {
+    auto before = stbtt_GetGlyphKernAdvance(&font.info, other.ttf_glyph, job->ttf_glyph);
+    if (before != 0) {
+      job->kernings.push_back({other.codepoint, job->codepoint, before * font.em_scale});
+    }
+    if (other.codepoint == job->codepoint) { continue; }
+    auto after = stbtt_GetGlyphKernAdvance(&font.info, job->ttf_glyph, other.ttf_glyph);
+    if (after != 0) {
+      job->kernings.push_back({job->codepoint, other.codepoint, after * font.em_scale});
+    }
+  }
+
+  SDL_LockMutex(job->dynamic->mutex);
+  job->dynamic->completed_jobs.push_back(job);
+  SDL_UnlockMutex(job->dynamic->mutex);
+}
+
+// Creates an empty dynamic atlas with one variant per font file in fonts/, taking
+// FONT_ATLAS_DYNAMIC_LAYERS_COUNT layers of the array from first_layer on.
+static bool font_atlas_dynamic_create(
+    Font_Atlas*        font_atlas,
+    const std::string& base_path,
+    const char* const* font_file_names,
+    int                font_files_count,
+    Font_Atlas_Array*  array,
+    int                first_layer,
+    SDL_GPUDevice*     device,
+    Thread_Pool*       thread_pool) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(font_file_names != nullptr);
+  SDL_assert(array != nullptr);
+  SDL_assert(first_layer >= 0);
+  SDL_assert(first_layer + FONT_ATLAS_DYNAMIC_LAYERS_COUNT <= array->layers_count);
+  SDL_assert(device != nullptr);
+  SDL_assert(thread_pool != nullptr);
+
+  auto dynamic        = new Font_Atlas_Dynamic {};
+  font_atlas->dynamic = dynamic;
+
+  dynamic->thread_pool = thread_pool;
+  dynamic->mutex       = SDL_CreateMutex();
+  if (dynamic->mutex == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create mutex: %s", SDL_GetError());
+    return false;
+  }
+
+  font_atlas->type           = FONT_ATLAS_TYPE_MTSDF;
+  font_atlas->distance_range = FONT_ATLAS_DYNAMIC_DISTANCE_RANGE;
+  font_atlas->size           = FONT_ATLAS_DYNAMIC_SIZE;
+  font_atlas->width          = FONT_ATLAS_DYNAMIC_WIDTH;
+  font_atlas->height         = FONT_ATLAS_DYNAMIC_PAGE_HEIGHT * FONT_ATLAS_DYNAMIC_PAGES_COUNT;
+  font_atlas->layer          = first_layer;
+  font_atlas->layers_count   = FONT_ATLAS_DYNAMIC_LAYERS_COUNT;
+  font_atlas->variants.resize(font_files_count);
+  dynamic->fonts.resize(font_files_count);
+  for (int i = 0; i < font_files_count; i++) {
+    auto& font      = dynamic->fonts[i];
+    auto  file_path = base_path + "/fonts/" + font_file_names[i];
+    if (!read_file_contents(file_path, &font.ttf_data)) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to read file contents: %s",
+          file_path.c_str());
+      return false;
+    }
+    if (!stbtt_InitFont(&font.info, font.ttf_data.data(), 0)) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to parse font: %s", file_path.c_str());
+      return false;
+    }
+    font.em_scale           = stbtt_ScaleForMappingEmToPixels(&font.info, 1.0f);
+    font.notdef_glyph_index = FONT_GLYPH_INDEX_NONE;
+
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&font.info, &ascent, &descent, &line_gap);
+    auto& variant       = font_atlas->variants[i];
+    variant.line_height = (ascent - descent + line_gap) * font.em_scale;
+    variant.ascender    = ascent * font.em_scale;
+    variant.descender   = descent * font.em_scale;
+    font_variant_build_glyph_lookup(&variant);
+    // Pairs are inserted as glyphs come in, the class tables are only built for baked atlases.
+    variant.kerning_table      = {};
+    variant.kerning_table.kind = FONT_KERNING_KIND_PAIRS;
+
+    variant.glyph_metrics_offset =
+        font_atlas_array_reserve_glyph_metrics(array, FONT_ATLAS_DYNAMIC_MAX_GLYPHS);
+    if (variant.glyph_metrics_offset < 0) { return false; }
+  }
+
+  dynamic->texture              = array->texture;
+  dynamic->glyph_metrics_buffer = array->glyph_metrics_buffer;
+  dynamic->texels.assign(static_cast<size_t>(font_atlas->width) * font_atlas->height * 4, 0);
+  dynamic->texture_outdated = true;
+  for (auto& page : dynamic->pages) {
+    skyline_packer_reset(&page.packer, font_atlas->width, FONT_ATLAS_DYNAMIC_PAGE_HEIGHT);
+  }
+
+  return true;
+}
+
+static void font_atlas_dynamic_destroy(Font_Atlas* font_atlas, SDL_GPUDevice* device) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(device != nullptr);
+
+  auto dynamic = font_atlas->dynamic;
+  if (dynamic == nullptr) { return; }
+
+  // Jobs in flight point into the atlas.
+  thread_pool_wait(dynamic->thread_pool);
+  for (auto job : dynamic->completed_jobs) { delete job; }
+  for (auto job : dynamic->unplaced_jobs) { delete job; }
+
+  SDL_DestroyMutex(dynamic->mutex);
+
+  delete dynamic;
+  font_atlas->dynamic = nullptr;
+}
+
+// Queues the generation of the distance field of a glyph and the probing of its kerning with
+// kerning_glyphs. A glyph without an outline and nothing to probe is marked empty right away.
+static void font_atlas_dynamic_queue_glyph(
+    Font_Atlas*                                     font_atlas,
+    int                                             font_variant,
+    uint16_t                                        glyph_index,
+    std::vector<Font_Atlas_Dynamic_Kerning_Glyph>&& kerning_glyphs) {
+  auto  dynamic = font_atlas->dynamic;
+  auto& font    = dynamic->fonts[font_variant];
+
+  Font_Atlas_Dynamic_Glyph_Box box = {};
+  if (!font_atlas_dynamic_glyph_box(font, font.ttf_glyphs[glyph_index], &box)) {
+    if (kerning_glyphs.empty()) {
+      font.glyph_states[glyph_index] = FONT_ATLAS_DYNAMIC_GLYPH_STATE_EMPTY;
+      return;
+    }
+  }
+
+  auto job            = new Font_Atlas_Dynamic_Job {};
+  job->dynamic        = dynamic;
+  job->font           = &font;
+  job->font_variant   = font_variant;
+  job->glyph_index    = glyph_index;
+  job->codepoint      = font_atlas->variants[font_variant].glyphs[glyph_index].unicode;
+  job->ttf_glyph      = font.ttf_glyphs[glyph_index];
+  job->box            = box;
+  job->kerning_glyphs = std::move(kerning_glyphs);
+
+  font.glyph_states[glyph_index] = FONT_ATLAS_DYNAMIC_GLYPH_STATE_PENDING;
+  dynamic->pending_jobs_count += 1;
+  thread_pool_push(dynamic->thread_pool, font_atlas_dynamic_job, job);
+}
+
+// Adds the glyph for codepoint to a variant of a dynamic atlas and queues the generation of its
+// distance field and kerning. Codepoints missing from the font get the font's .notdef glyph. The
+// glyph takes a free slot if there is one. Returns the index of the glyph, which is usable for
+// layout straight away, or FONT_GLYPH_INDEX_NONE if every slot is taken.
+static uint16_t
+font_atlas_dynamic_request_glyph(Font_Atlas* font_atlas, int font_variant, int codepoint) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(font_atlas->dynamic != nullptr);
+  SDL_assert(font_variant >= 0 && font_variant < font_atlas->variants.size());
+
+  auto  dynamic = font_atlas->dynamic;
+  auto& variant = font_atlas->variants[font_variant];
+  auto& font    = dynamic->fonts[font_variant];
+
+  auto glyph_index = font_variant_find_glyph_index(variant, codepoint);
+  if (glyph_index != FONT_GLYPH_INDEX_NONE) { return glyph_index; }
+
+  // Missing codepoints share a single .notdef glyph.
+  auto ttf_glyph = stbtt_FindGlyphIndex(&font.info, codepoint);
+  if (ttf_glyph == 0 && font.notdef_glyph_index != FONT_GLYPH_INDEX_NONE) {
+    font_variant_insert_glyph_index(&variant, codepoint, font.notdef_glyph_index);
+    font.notdef_codepoints.push_back(codepoint);
+    return font.notdef_glyph_index;
+  }
+
+  if (!font.free_glyph_indices.empty()) {
+    glyph_index = font.free_glyph_indices.back();
+    font.free_glyph_indices.pop_back();
+    dynamic->recycled_glyphs_count += 1;
+  } else if (variant.glyphs.size() < FONT_ATLAS_DYNAMIC_MAX_GLYPHS) {
+    glyph_index = static_cast<uint16_t>(variant.glyphs.size());
+    variant.glyphs.emplace_back();
+    font.ttf_glyphs.emplace_back();
+    font.glyph_rects.emplace_back();
+    font.glyph_states.emplace_back();
+    font.glyph_last_used_frames.emplace_back();
+  } else {
+    return FONT_GLYPH_INDEX_NONE;
+  }
+
+  int advance, left_side_bearing;
+  stbtt_GetGlyphHMetrics(&font.info, ttf_glyph, &advance, &left_side_bearing);
+
+  auto& glyph              = variant.glyphs[glyph_index];
+  glyph                    = {};
+  glyph.unicode            = codepoint;
+  glyph.horizontal_advance = advance * font.em_scale;
+  font_variant_insert_glyph_index(&variant, codepoint, glyph_index);
+  font.ttf_glyphs[glyph_index]             = ttf_glyph;
+  font.glyph_rects[glyph_index]            = {};
+  font.glyph_states[glyph_index]           = FONT_ATLAS_DYNAMIC_GLYPH_STATE_EMPTY;
+  font.glyph_last_used_frames[glyph_index] = dynamic->frame;
+  if (ttf_glyph == 0) {
+    font.notdef_glyph_index = glyph_index;
+    font.notdef_codepoints.push_back(codepoint);
+  }
+
+  // The glyph is kerned against itself and every glyph the variant holds, glyphs requested later
+  // probe their pairs with this one. .notdef isn't kerned.
+  std::vector<Font_Atlas_Dynamic_Kerning_Glyph> kerning_glyphs;
+  if (ttf_glyph != 0 && (font.info.gpos != 0 || font.info.kern != 0)) {
+    kerning_glyphs.reserve(variant.glyphs.size());
+    for (size_t i = 0; i < variant.glyphs.size(); i++) {
+      if (font.ttf_glyphs[i] == 0 || font.glyph_states[i] == FONT_ATLAS_DYNAMIC_GLYPH_STATE_FREE) {
+        continue;
+      }
+      kerning_glyphs.push_back({variant.glyphs[i].unicode, font.ttf_glyphs[i]});
+    }
+  }
+
+  font_atlas_dynamic_queue_glyph(font_atlas, font_variant, glyph_index, std::move(kerning_glyphs));
+  return glyph_index;
+}
+
+// Marks a glyph as drawn this frame.
+static void
+font_atlas_dynamic_use_glyph(Font_Atlas* font_atlas, int font_variant, uint16_t glyph_index) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(font_atlas->dynamic != nullptr);
+
+  auto  dynamic = font_atlas->dynamic;
+  auto& font    = dynamic->fonts[font_variant];
+  SDL_assert(font.glyph_states[glyph_index] != FONT_ATLAS_DYNAMIC_GLYPH_STATE_FREE);
+  font.glyph_last_used_frames[glyph_index] = dynamic->frame;
+
+  switch (font.glyph_states[glyph_index]) {
+  case FONT_ATLAS_DYNAMIC_GLYPH_STATE_RESIDENT:
+    dynamic->hits_count += 1;
+    break;
+  case FONT_ATLAS_DYNAMIC_GLYPH_STATE_PENDING:
+    dynamic->misses_count += 1;
+    break;
+  default:
+    break;
+  }
+}
+
+static void font_atlas_dynamic_mark_glyph_dirty(Font_Atlas_Dynamic_Font* font, int glyph_index) {
+  if (font->dirty_glyphs_begin == font->dirty_glyphs_end) {
+    font->dirty_glyphs_begin = glyph_index;
+    font->dirty_glyphs_end   = glyph_index + 1;
+    return;
+  }
+  font->dirty_glyphs_begin = SDL_min(font->dirty_glyphs_begin, glyph_index);
+  font->dirty_glyphs_end   = SDL_max(font->dirty_glyphs_end, glyph_index + 1);
+}
+
+static void
+font_atlas_dynamic_set_atlas_bounds(Font_Atlas* font_atlas, Font_Glyph* glyph, SDL_Rect rect) {
+  auto size           = static_cast<float>(FONT_ATLAS_LAYER_SIZE);
+  auto layer_y        = rect.y % FONT_ATLAS_LAYER_SIZE;
+  glyph->atlas_bounds = HMM_V4(
+      (rect.x + 0.5f) / size,
+      (layer_y + 0.5f) / size,
+      (rect.x + rect.w - 0.5f) / size,
+      (layer_y + rect.h - 0.5f) / size);
+  glyph->layer = static_cast<uint32_t>(font_atlas->layer + rect.y / FONT_ATLAS_LAYER_SIZE);
+}
+
+static bool
+font_atlas_dynamic_pack(Font_Atlas_Dynamic* dynamic, int width, int height, SDL_Rect* out_rect) {
+  SDL_assert(dynamic != nullptr);
+  SDL_assert(out_rect != nullptr);
+
+  auto occupied_width  = width + FONT_ATLAS_DYNAMIC_GLYPH_SPACING;
+  auto occupied_height = height + FONT_ATLAS_DYNAMIC_GLYPH_SPACING;
+  for (int i = 0; i < FONT_ATLAS_DYNAMIC_PAGES_COUNT; i++) {
+    auto&     page = dynamic->pages[i];
+    SDL_Point point;
+    if (!skyline_packer_pack(&page.packer, occupied_width, occupied_height, &point)) { continue; }
+
+    page.glyphs_count += 1;
+    page.used_area += occupied_width * occupied_height;
+    *out_rect = {point.x, i * FONT_ATLAS_DYNAMIC_PAGE_HEIGHT + point.y, width, height};
+    return true;
+  }
+  return false;
+}
+
+static void
+font_atlas_dynamic_copy_texels(Font_Atlas* font_atlas, SDL_Rect rect, const uint8_t* texels) {
+  auto dynamic = font_atlas->dynamic;
+  for (int y = 0; y < rect.h; y++) {
+    SDL_memcpy(
+        &dynamic->texels[(static_cast<size_t>(rect.y + y) * font_atlas->width + rect.x) * 4],
+        &texels[static_cast<size_t>(y) * rect.w * 4],
+        static_cast<size_t>(rect.w) * 4);
+  }
+}
+
+// Unmaps the codepoints of an evicted glyph and puts its slot on the free list. Its kerning pairs
+// are left to the caller, which drops those of every glyph it frees in one pass.
+static void
+font_atlas_dynamic_free_glyph(Font_Atlas* font_atlas, int font_variant, uint16_t glyph_index) {
+  auto& variant = font_atlas->variants[font_variant];
+  auto& font    = font_atlas->dynamic->fonts[font_variant];
+
+  if (glyph_index == font.notdef_glyph_index) {
+    for (auto codepoint : font.notdef_codepoints) {
+      font_variant_remove_glyph_index(&variant, codepoint);
+    }
+    font.notdef_codepoints.clear();
+    font.notdef_glyph_index = FONT_GLYPH_INDEX_NONE;
+  } else {
+    font_variant_remove_glyph_index(&variant, variant.glyphs[glyph_index].unicode);
+  }
+  font.glyph_states[glyph_index] = FONT_ATLAS_DYNAMIC_GLYPH_STATE_FREE;
+  font.free_glyph_indices.push_back(glyph_index);
+}
+
+struct Font_Atlas_Dynamic_Page_Glyph {
+  int      font_variant;
+  uint16_t glyph_index;
+  uint64_t last_used_frame;
+};
+
+// Picks the page with the fewest warm glyphs, skipping pages with glyphs drawn this frame, evicts
+// its cold glyphs and packs the warm ones again from scratch. The slots of evicted glyphs are
+// freed. Returns false if no page could be compacted.
+static bool font_atlas_dynamic_compact_page(Font_Atlas* font_atlas) {
+  auto dynamic = font_atlas->dynamic;
+
+  std::vector<Font_Atlas_Dynamic_Page_Glyph> page_glyphs[FONT_ATLAS_DYNAMIC_PAGES_COUNT];
+  uint64_t newest_frames[FONT_ATLAS_DYNAMIC_PAGES_COUNT] = {};
+  int      warm_counts[FONT_ATLAS_DYNAMIC_PAGES_COUNT]   = {};
+  for (size_t i = 0; i < dynamic->fonts.size(); i++) {
+    const auto& font = dynamic->fonts[i];
+    for (size_t j = 0; j < font.glyph_states.size(); j++) {
+      if (font.glyph_states[j] != FONT_ATLAS_DYNAMIC_GLYPH_STATE_RESIDENT) { continue; }
+
+      auto page            = font.glyph_rects[j].y / FONT_ATLAS_DYNAMIC_PAGE_HEIGHT;
+      auto last_used_frame = font.glyph_last_used_frames[j];
+      page_glyphs[page].push_back({static_cast<int>(i), static_cast<uint16_t>(j), last_used_frame});
+      newest_frames[page] = SDL_max(newest_frames[page], last_used_frame);
+      if (last_used_frame + FONT_ATLAS_DYNAMIC_WARM_FRAMES > dynamic->frame) {
+        warm_counts[page] += 1;
+      }
+    }
+  }
+
+  int best_page = -1;
+  for (int i = 0; i < FONT_ATLAS_DYNAMIC_PAGES_COUNT; i++) {
+    if (page_glyphs[i].empty() || newest_frames[i] >= dynamic->frame) { continue; }
+    if (best_page < 0 || warm_counts[i] < warm_counts[best_page] ||
+        (warm_counts[i] == warm_counts[best_page] &&
+         newest_frames[i] < newest_frames[best_page])) {
+      best_page = i;
+    }
+  }
+  if (best_page < 0) { return false; }
+
+  // Keep the texels of the warm glyphs around while the page is cleared, tallest first since that
+  // packs better.
+  auto& glyphs = page_glyphs[best_page];
+  std::sort(glyphs.begin(), glyphs.end(), [&](const auto& a, const auto& b) {
+    return dynamic->fonts[a.font_variant].glyph_rects[a.glyph_index].h >
+           dynamic->fonts[b.font_variant].glyph_rects[b.glyph_index].h;
+  });
+  std::vector<std::vector<uint8_t>> warm_texels(glyphs.size());
+  for (size_t i = 0; i < glyphs.size(); i++) {
+    if (glyphs[i].last_used_frame + FONT_ATLAS_DYNAMIC_WARM_FRAMES <= dynamic->frame) { continue; }
+
+    auto rect = dynamic->fonts[glyphs[i].font_variant].glyph_rects[glyphs[i].glyph_index];
+    warm_texels[i].resize(static_cast<size_t>(rect.w) * rect.h * 4);
+    for (int y = 0; y < rect.h; y++) {
+      SDL_memcpy(
+          &warm_texels[i][static_cast<size_t>(y) * rect.w * 4],
+          &dynamic->texels[(static_cast<size_t>(rect.y + y) * font_atlas->width + rect.x) * 4],
+          static_cast<size_t>(rect.w) * 4);
+    }
+  }
+
+  SDL_Rect page_rect = {
+      0,
+      best_page * FONT_ATLAS_DYNAMIC_PAGE_HEIGHT,
+      font_atlas->width,
+      FONT_ATLAS_DYNAMIC_PAGE_HEIGHT};
+  auto&    page      = dynamic->pages[best_page];
+  skyline_packer_reset(&page.packer, font_atlas->width, FONT_ATLAS_DYNAMIC_PAGE_HEIGHT);
+  page.glyphs_count = 0;
+  page.used_area    = 0;
+  SDL_memset(
+      &dynamic->texels[static_cast<size_t>(page_rect.y) * font_atlas->width * 4],
+      0,
+      static_cast<size_t>(page_rect.w) * page_rect.h * 4);
+  dynamic->dirty_rects.push_back(page_rect);
+  dynamic->compacted_pages_count += 1;
+
+  std::vector<std::vector<bool>> evicted_glyphs(dynamic->fonts.size());
+  for (size_t i = 0; i < glyphs.size(); i++) {
+    auto& font  = dynamic->fonts[glyphs[i].font_variant];
+    auto& glyph = font_atlas->variants[glyphs[i].font_variant].glyphs[glyphs[i].glyph_index];
+    auto& rect  = font.glyph_rects[glyphs[i].glyph_index];
+    font_atlas_dynamic_mark_glyph_dirty(&font, glyphs[i].glyph_index);
+
+    auto      occupied_width  = rect.w + FONT_ATLAS_DYNAMIC_GLYPH_SPACING;
+    auto      occupied_height = rect.h + FONT_ATLAS_DYNAMIC_GLYPH_SPACING;
+    SDL_Point point;
+    if (!warm_texels[i].empty() &&
+        skyline_packer_pack(&page.packer, occupied_width, occupied_height, &point)) {
+      page.glyphs_count += 1;
+      page.used_area += occupied_width * occupied_height;
+      rect = {point.x, page_rect.y + point.y, rect.w, rect.h};
+      font_atlas_dynamic_copy_texels(font_atlas, rect, warm_texels[i].data());
+      font_atlas_dynamic_set_atlas_bounds(font_atlas, &glyph, rect);
+      continue;
+    }
+
+    rect               = {};
+    glyph.plane_bounds = {};
+    glyph.atlas_bounds = {};
+    glyph.layer        = 0;
+    font_atlas_dynamic_free_glyph(font_atlas, glyphs[i].font_variant, glyphs[i].glyph_index);
+    dynamic->resident_glyphs_count -= 1;
+    dynamic->evicted_glyphs_count += 1;
+
+    auto& evicted = evicted_glyphs[glyphs[i].font_variant];
+    evicted.resize(font.glyph_states.size());
+    evicted[glyphs[i].glyph_index] = true;
+  }
+
+  for (size_t i = 0; i < evicted_glyphs.size(); i++) {
+    if (evicted_glyphs[i].empty()) { continue; }
+    font_kerning_table_remove_glyphs(&font_atlas->variants[i].kerning_table, evicted_glyphs[i]);
+  }
+
+  return true;
+}
+
+static void
+font_atlas_dynamic_upload(Font_Atlas* font_atlas, Upload_Scheduler* upload_scheduler) {
+  auto dynamic = font_atlas->dynamic;
+
+  // Rects never cross a layer: glyphs and pages stay within theirs.
+  std::vector<SDL_Rect> layer_rects;
+  for (int i = 0; i < font_atlas->layers_count; i++) {
+    layer_rects.push_back({0, i * FONT_ATLAS_LAYER_SIZE, font_atlas->width, FONT_ATLAS_LAYER_SIZE});
+  }
+  const auto& rects = dynamic->texture_outdated ? layer_rects : dynamic->dirty_rects;
+
+  // The dirty glyph metrics follow the texels in the allocation, 16 byte aligned for their vector
+  // members.
+  uint32_t texels_size = 0;
+  for (const auto& rect : rects) { texels_size += static_cast<uint32_t>(rect.w * rect.h * 4); }
+  uint32_t metrics_offset = (texels_size + 15) & ~15u;
+  uint32_t size           = metrics_offset;
+  for (const auto& font : dynamic->fonts) {
+    size += static_cast<uint32_t>(
+        sizeof(Font_Glyph_Metrics) * (font.dirty_glyphs_end - font.dirty_glyphs_begin));
+  }
+
+  Upload_Allocation allocation;
+  if (!upload_scheduler_allocate(
+          upload_scheduler,
+          UPLOAD_CLIENT_FONT_ATLAS_DYNAMIC,
+          size,
+          &allocation)) {
+    return;
+  }
+
+  uint32_t offset = 0;
+  for (const auto& rect : rects) {
+    auto texels_ptr = allocation.ptr + offset;
+    for (int y = 0; y < rect.h; y++) {
+      SDL_memcpy(
+          texels_ptr,
+          &dynamic->texels[(static_cast<size_t>(rect.y + y) * font_atlas->width + rect.x) * 4],
+          static_cast<size_t>(rect.w) * 4);
+      texels_ptr += rect.w * 4;
+    }
+
+    auto layer   = font_atlas->layer + rect.y / FONT_ATLAS_LAYER_SIZE;
+    auto layer_y = rect.y % FONT_ATLAS_LAYER_SIZE;
+    SDL_assert(layer_y + rect.h <= FONT_ATLAS_LAYER_SIZE);
+
+    SDL_GPUTextureRegion region = {};
+    region.texture              = dynamic->texture;
+    region.layer                = static_cast<uint32_t>(layer);
+    region.x                    = static_cast<uint32_t>(rect.x);
+    region.y                    = static_cast<uint32_t>(layer_y);
+    region.w                    = static_cast<uint32_t>(rect.w);
+    region.h                    = static_cast<uint32_t>(rect.h);
+    region.d                    = 1;
+    upload_scheduler_upload_to_texture(upload_scheduler, allocation, offset, region);
+    offset += static_cast<uint32_t>(rect.w * rect.h * 4);
+  }
+
+  offset = metrics_offset;
+  for (size_t i = 0; i < dynamic->fonts.size(); i++) {
+    auto&       font   = dynamic->fonts[i];
+    const auto& glyphs = font_atlas->variants[i].glyphs;
+    if (font.dirty_glyphs_begin == font.dirty_glyphs_end) { continue; }
+
+    auto metrics_ptr = reinterpret_cast<Font_Glyph_Metrics*>(allocation.ptr + offset);
+    for (int j = font.dirty_glyphs_begin; j < font.dirty_glyphs_end; j++) {
+      *metrics_ptr++ = font_glyph_metrics(glyphs[j]);
+    }
+
+    auto first = font_atlas->variants[i].glyph_metrics_offset + font.dirty_glyphs_begin;
+    auto count = font.dirty_glyphs_end - font.dirty_glyphs_begin;
+    auto bytes = static_cast<uint32_t>(sizeof(Font_Glyph_Metrics) * count);
+    upload_scheduler_upload_to_buffer(
+        upload_scheduler,
+        allocation,
+        offset,
+        dynamic->glyph_metrics_buffer,
+        static_cast<uint32_t>(sizeof(Font_Glyph_Metrics) * first),
+        bytes);
+    offset += bytes;
+
+    font.dirty_glyphs_begin = 0;
+    font.dirty_glyphs_end   = 0;
+  }
+
+  dynamic->uploaded_bytes   = size;
+  dynamic->texture_outdated = false;
+  dynamic->dirty_rects.clear();
+}
+
+// Packs the glyphs finished by the workers into the atlas and queues the upload of the dirty
+// texels and glyph metrics with the upload scheduler. Call once per frame, after drawing and before
+// the upload scheduler is flushed.
+static void
+font_atlas_dynamic_update(Font_Atlas* font_atlas, Upload_Scheduler* upload_scheduler) {
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(font_atlas->dynamic != nullptr);
+  SDL_assert(upload_scheduler != nullptr);
+
+  auto dynamic            = font_atlas->dynamic;
+  dynamic->uploaded_bytes = 0;
+  defer(dynamic->frame += 1);
+
+  // Glyphs that didn't fit last update go first.
+  std::vector<Font_Atlas_Dynamic_Job*> jobs;
+  jobs.swap(dynamic->unplaced_jobs);
+  SDL_LockMutex(dynamic->mutex);
+  for (auto job : dynamic->completed_jobs) {
+    if (job->box.width == 0) { continue; }
+    dynamic->generate_ms += job->generate_ms;
+    dynamic->generated_glyphs_count += 1;
+  }
+  jobs.insert(jobs.end(), dynamic->completed_jobs.begin(), dynamic->completed_jobs.end());
+  dynamic->completed_jobs.clear();
+  SDL_UnlockMutex(dynamic->mutex);
+
+  // Kerning of a glyph goes in once, before it is placed. Pairs with glyphs that are gone by now
+  // are dropped.
+  for (auto job : jobs) {
+    auto& variant = font_atlas->variants[job->font_variant];
+    for (const auto& kerning : job->kernings) {
+      auto left  = font_variant_find_glyph_index(variant, kerning.unicode1);
+      auto right = font_variant_find_glyph_index(variant, kerning.unicode2);
+      if (left == FONT_GLYPH_INDEX_NONE || right == FONT_GLYPH_INDEX_NONE) { continue; }
+      font_kerning_table_insert_pair(&variant.kerning_table, left, right, kerning.advance);
+    }
+    job->kernings.clear();
+  }
+
+  // At most one page is compacted per update, so a burst of new glyphs can't flush the whole atlas.
+  bool compacted = false;
+  for (auto job : jobs) {
+    const auto& box = job->box;
+    if (box.width == 0) {
+      defer(delete job);
+      dynamic->pending_jobs_count -= 1;
+      dynamic->fonts[job->font_variant].glyph_states[job->glyph_index] =
+          FONT_ATLAS_DYNAMIC_GLYPH_STATE_EMPTY;
+      continue;
+    }
+
+    SDL_Rect rect;
+    if (!font_atlas_dynamic_pack(dynamic, box.width, box.height, &rect)) {
+      bool packed = !compacted && font_atlas_dynamic_compact_page(font_atlas) &&
+                    font_atlas_dynamic_pack(dynamic, box.width, box.height, &rect);
+      compacted   = true;
+      if (!packed) {
+        dynamic->unplaced_jobs.push_back(job);
+        continue;
+      }
+    }
+    defer(delete job);
+    dynamic->pending_jobs_count -= 1;
+
+    font_atlas_dynamic_copy_texels(font_atlas, rect, job->texels.data());
+    dynamic->dirty_rects.push_back(rect);
+
+    auto  size         = FONT_ATLAS_DYNAMIC_SIZE;
+    auto& glyph        = font_atlas->variants[job->font_variant].glyphs[job->glyph_index];
+    glyph.plane_bounds = HMM_V4(
+        (box.x + 0.5f) / size,
+        (box.y + box.height - 0.5f) / size,
+        (box.x + box.width - 0.5f) / size,
+        (box.y + 0.5f) / size);
+    font_atlas_dynamic_set_atlas_bounds(font_atlas, &glyph, rect);
+
+    // Freshly placed glyphs count as used so they survive until they are drawn.
+    auto& font                                    = dynamic->fonts[job->font_variant];
+    font.glyph_rects[job->glyph_index]            = rect;
+    font.glyph_states[job->glyph_index]           = FONT_ATLAS_DYNAMIC_GLYPH_STATE_RESIDENT;
+    font.glyph_last_used_frames[job->glyph_index] = dynamic->frame;
+    font_atlas_dynamic_mark_glyph_dirty(&font, job->glyph_index);
+    dynamic->resident_glyphs_count += 1;
+  }
+
+  bool glyph_metrics_dirty = false;
+  for (const auto& font : dynamic->fonts) {
+    glyph_metrics_dirty |= font.dirty_glyphs_begin != font.dirty_glyphs_end;
+  }
+  if (dynamic->dirty_rects.empty() && !dynamic->texture_outdated && !glyph_metrics_dirty) {
+    return;
+  }
+  font_atlas_dynamic_upload(font_atlas, upload_scheduler);
+}
@@ -0,0 +1,468 @@
+// Multi-channel signed distance field generation for glyph outlines, a compact take on msdfgen.
+// Contours are split into edges at their corners and the edges are colored so that the two edges
+// meeting at a corner only share one channel. Each channel stores the signed pseudo-distance to the
+// nearest edge of that channel, so the median of the three channels reconstructs sharp corners.
+//
+// Curves are flattened into line segments before the distance pass, but every segment remembers the
+// edge it was flattened from, so edge selection and the pseudo-distance extension at edge endpoints
+// still happen per original edge. The output matches msdf-atlas-gen's MTSDF: a texel value of 0.5
+// is on the outline, values above it are inside and the distance range spans the full [0, 1] texel
+// range. The alpha channel holds the true signed distance to the outline.
+
+static constexpr uint8_t MSDF_COLOR_BLACK   = 0;
+static constexpr uint8_t MSDF_COLOR_RED     = 1;
+static constexpr uint8_t MSDF_COLOR_GREEN   = 2;
+static constexpr uint8_t MSDF_COLOR_YELLOW  = 3;
+static constexpr uint8_t MSDF_COLOR_BLUE    = 4;
+static constexpr uint8_t MSDF_COLOR_MAGENTA = 5;
+static constexpr uint8_t MSDF_COLOR_CYAN    = 6;
+static constexpr uint8_t MSDF_COLOR_WHITE   = 7;
+
+// Corners are junctions where the outline turns by more than ~3 degrees, same as msdfgen's default.
+static constexpr float MSDF_CORNER_CROSS_THRESHOLD = 0.05233596f;  // sin(3 degrees)
+// Maximum distance in pixels between a flattened curve and its line segments.
+static constexpr float MSDF_FLATTEN_TOLERANCE    = 0.02f;
+static constexpr int   MSDF_FLATTEN_MAX_SEGMENTS = 64;
+
+struct Msdf_Curve {
+  HMM_Vec2 points[4];
+  int      degree;
+  uint8_t  color;
+};
+
+struct Msdf_Segment {
+  HMM_Vec2 a;
+  HMM_Vec2 b;
+};
+
+struct Msdf_Edge {
+  uint8_t color;
+  int     first_segment;
+  int     segments_count;
+};
+
+struct Msdf_Distance {
+  float distance;
+  float dot;
+};
+
+static float msdf_cross(HMM_Vec2 a, HMM_Vec2 b) {
+  return a.X * b.Y - a.Y * b.X;
+}
+
+static bool msdf_distance_less(const Msdf_Distance& a, const Msdf_Distance& b) {
+  float a_abs = SDL_fabsf(a.distance);
+  float b_abs = SDL_fabsf(b.distance);
+  return a_abs < b_abs || (a_abs == b_abs && a.dot < b.dot);
+}
+
+static HMM_Vec2 msdf_curve_point(const Msdf_Curve& curve, float t) {
+  HMM_Vec2 points[4];
+  for (int i = 0; i <= curve.degree; i++) { points[i] = curve.points[i]; }
+  for (int level = curve.degree; level > 0; level--) {
+    for (int i = 0; i < level; i++) { points[i] = HMM_LerpV2(points[i], t, points[i + 1]); }
+  }
+  return points[0];
+}
+
+static HMM_Vec2 msdf_curve_direction(const Msdf_Curve& curve, bool at_end) {
+  const auto& p = curve.points;
+  auto        n = curve.degree;
+  auto direction = at_end ? p[n] - p[n - 1] : p[1] - p[0];
+  if (direction.X == 0.0f && direction.Y == 0.0f && n > 1) {
+    direction = at_end ? p[n] - p[n - 2] : p[2] - p[0];
+  }
+  return direction;
+}
+
+// Splits the curve at t with de Casteljau's algorithm.
+static void
+msdf_curve_split(const Msdf_Curve& curve, float t, Msdf_Curve* left, Msdf_Curve* right) {
+  HMM_Vec2 points[4];
+  for (int i = 0; i <= curve.degree; i++) { points[i] = curve.points[i]; }
+
+  *left  = curve;
+  *right = curve;
+  for (int level = curve.degree; level >= 0; level--) {
+    left->points[curve.degree - level] = points[0];
+    right->points[level]               = points[level];
+    for (int i = 0; i < level; i++) { points[i] = HMM_LerpV2(points[i], t, points[i + 1]); }
+  }
+}
+
+static void msdf_curve_split_in_thirds(const Msdf_Curve& curve, Msdf_Curve* out_parts) {
+  Msdf_Curve rest;
+  msdf_curve_split(curve, 1.0f / 3.0f, &out_parts[0], &rest);
+  msdf_curve_split(rest, 0.5f, &out_parts[1], &out_parts[2]);
+}
+
+// Picks the next edge color, never repeating the current one and avoiding the banned color.
+static uint8_t msdf_switch_color(uint8_t color, uint8_t banned = MSDF_COLOR_BLACK) {
+  uint8_t combined = color & banned;
+  if (combined == MSDF_COLOR_RED || combined == MSDF_COLOR_GREEN || combined == MSDF_COLOR_BLUE) {
+    return combined ^ MSDF_COLOR_WHITE;
+  }
+  if (color == MSDF_COLOR_BLACK || color == MSDF_COLOR_WHITE) { return MSDF_COLOR_CYAN; }
+  int shifted = color << 1;
+  return static_cast<uint8_t>((shifted | shifted >> 3) & MSDF_COLOR_WHITE);
+}
+
+// msdfgen's "simple" edge coloring: smooth contours are white (a plain SDF), contours with a single
+// corner are split in three so the corner is still sharp, and otherwise the color changes at every
+// corner.
+static void msdf_color_contour(std::vector<Msdf_Curve>* contour) {
+  SDL_assert(contour != nullptr);
+
+  if (contour->empty()) { return; }
+
+  std::vector<int> corners;
+  auto prev_direction = HMM_NormV2(msdf_curve_direction(contour->back(), true));
+  for (int i = 0; i < static_cast<int>(contour->size()); i++) {
+    auto direction = HMM_NormV2(msdf_curve_direction((*contour)[i], false));
+    if (HMM_DotV2(prev_direction, direction) <= 0.0f ||
+        SDL_fabsf(msdf_cross(prev_direction, direction)) > MSDF_CORNER_CROSS_THRESHOLD) {
+      corners.push_back(i);
+    }
+    prev_direction = HMM_NormV2(msdf_curve_direction((*contour)[i], true));
+  }
+
+  if (corners.empty()) {
+    for (auto& curve : *contour) { curve.color = MSDF_COLOR_WHITE; }
+    return;
+  }
+
+  if (corners.size() == 1) {
+    uint8_t colors[3];
+    colors[0] = msdf_switch_color(MSDF_COLOR_WHITE);
+    colors[1] = MSDF_COLOR_WHITE;
+    colors[2] = msdf_switch_color(colors[0]);
+
+    auto curves_count = static_cast<int>(contour->size());
+    if (curves_count >= 3) {
+      std::vector<Msdf_Curve> rotated(curves_count);
+      for (int i = 0; i < curves_count; i++) {
+        auto color_index =
+            static_cast<int>(3.0f + 2.875f * i / (curves_count - 1) - 1.4375f + 0.5f) - 2;
+        rotated[i]       = (*contour)[(corners[0] + i) % curves_count];
+        rotated[i].color = colors[color_index];
+      }
+      *contour = std::move(rotated);
+    } else {
+      // Not enough edges to give the corner two differently colored sides, so split them.
+      std::vector<Msdf_Curve> parts(curves_count * 3);
+      for (int i = 0; i < curves_count; i++) {
+        msdf_curve_split_in_thirds((*contour)[(corners[0] + i) % curves_count], &parts[i * 3]);
+      }
+      for (int i = 0; i < static_cast<int>(parts.size()); i++) {
+        parts[i].color = colors[i * 3 / static_cast<int>(parts.size())];
+      }
+      *contour = std::move(parts);
+    }
+    return;
+  }
+
+  auto corners_count = static_cast<int>(corners.size());
+  auto curves_count  = static_cast<int>(contour->size());
+  auto color         = msdf_switch_color(MSDF_COLOR_WHITE);
+  auto initial_color = color;
+  int  spline        = 0;
+  for (int i = 0; i < curves_count; i++) {
+    auto index = (corners[0] + i) % curves_count;
+    if (spline + 1 < corners_count && corners[spline + 1] == index) {
+      spline += 1;
+      color = msdf_switch_color(
+          color,
+          spline == corners_count - 1 ? initial_color : MSDF_COLOR_BLACK);
+    }
+    (*contour)[index].color = color;
+  }
+}
+
+static void msdf_flatten_curve(
+    const Msdf_Curve&          curve,
+    std::vector<Msdf_Segment>* segments,
+    std::vector<Msdf_Edge>*    edges) {
+  const auto& p = curve.points;
+
+  int segments_count = 1;
+  if (curve.degree > 1) {
+    // Chord error of n uniform segments is bounded by |second difference| / (8 n^2).
+    float second_difference = HMM_LenV2(p[0] - p[1] * 2.0f + p[2]);
+    if (curve.degree == 3) {
+      second_difference =
+          SDL_max(second_difference, HMM_LenV2(p[1] - p[2] * 2.0f + p[3])) * 1.5f;
+    }
+    segments_count = static_cast<int>(
+        SDL_ceilf(SDL_sqrtf(second_difference / (8.0f * MSDF_FLATTEN_TOLERANCE))));
+    segments_count = SDL_clamp(segments_count, 1, MSDF_FLATTEN_MAX_SEGMENTS);
+  }
+
+  Msdf_Edge edge     = {};
+  edge.color         = curve.color;
+  edge.first_segment = static_cast<int>(segments->size());
+
+  auto prev_point = p[0];
+  for (int i = 1; i <= segments_count; i++) {
+    auto point = i == segments_count
+                     ? p[curve.degree]
+                     : msdf_curve_point(curve, static_cast<float>(i) / segments_count);
+    if (point.X == prev_point.X && point.Y == prev_point.Y) { continue; }
+    segments->push_back({prev_point, point});
+    prev_point = point;
+  }
+
+  edge.segments_count = static_cast<int>(segments->size()) - edge.first_segment;
+  if (edge.segments_count > 0) { edges->push_back(edge); }
+}
+
+static Msdf_Distance
+msdf_segment_distance(const Msdf_Segment& segment, HMM_Vec2 p, float* out_param) {
+  auto aq    = p - segment.a;
+  auto ab    = segment.b - segment.a;
+  auto param = HMM_DotV2(aq, ab) / HMM_DotV2(ab, ab);
+  *out_param = param;
+
+  auto eq                = (param > 0.5f ? segment.b : segment.a) - p;
+  auto endpoint_distance = HMM_LenV2(eq);
+  auto cross             = msdf_cross(aq, ab);
+  if (param > 0.0f && param < 1.0f) {
+    auto ortho_distance = cross / HMM_LenV2(ab);
+    if (SDL_fabsf(ortho_distance) < endpoint_distance) { return {ortho_distance, 0.0f}; }
+  }
+
+  float dot = 0.0f;
+  if (endpoint_distance > 0.0f) {
+    dot = SDL_fabsf(HMM_DotV2(HMM_NormV2(ab), eq / endpoint_distance));
+  }
+  return {cross < 0.0f ? -endpoint_distance : endpoint_distance, dot};
+}
+
+// Extends the first and last segment of an edge past its endpoints, so the distance to an edge
+// stays a straight line distance around corners instead of rounding off.
+static float msdf_pseudo_distance(
+    const Msdf_Segment& segment,
+    HMM_Vec2            p,
+    float               param,
+    bool                is_first,
+    bool                is_last,
+    float               distance) {
+  if (!(is_first && param < 0.0f) && !(is_last && param > 1.0f)) { return distance; }
+
+  auto direction = HMM_NormV2(segment.b - segment.a);
+  auto q         = p - (param < 0.0f ? segment.a : segment.b);
+  auto ts        = HMM_DotV2(q, direction);
+  if ((param < 0.0f && ts < 0.0f) || (param > 1.0f && ts > 0.0f)) {
+    auto pseudo_distance = msdf_cross(q, direction);
+    if (SDL_fabsf(pseudo_distance) <= SDL_fabsf(distance)) { return pseudo_distance; }
+  }
+  return distance;
+}
+
+static float msdf_median(float a, float b, float c) {
+  return SDL_max(SDL_min(a, b), SDL_min(SDL_max(a, b), c));
+}
+
+// Two neighbouring texels clash when interpolating between them would flip the median across the
+// outline somewhere that isn't an edge, which shows up as specks around corners.
+static bool msdf_detect_clash(const float* a, const float* b, float threshold) {
+  float a0 = a[0], a1 = a[1], a2 = a[2];
+  float b0 = b[0], b1 = b[1], b2 = b[2];
+  if (SDL_fabsf(b1 - a1) < SDL_fabsf(b0 - a0)) {
+    std::swap(a0, a1);
+    std::swap(b0, b1);
+  }
+  if (SDL_fabsf(b2 - a2) < SDL_fabsf(b1 - a1)) {
+    std::swap(a1, a2);
+    std::swap(b1, b2);
+    if (SDL_fabsf(b1 - a1) < SDL_fabsf(b0 - a0)) {
+      std::swap(a0, a1);
+      std::swap(b0, b1);
+    }
+  }
+  return SDL_fabsf(b1 - a1) >= threshold && !(b0 == b1 && b0 == b2) &&
+         SDL_fabsf(a2 - 0.5f) >= SDL_fabsf(b2 - 0.5f);
+}
+
+// Generates a width x height RGBA8 MTSDF (top row first) of a stb_truetype glyph shape. Shape
+// points are mapped to pixels as point * scale - origin, with y up and (0, 0) the bottom left
+// corner of the bitmap. distance_range is in pixels.
+static void msdf_generate(
+    const stbtt_vertex* vertices,
+    int                 vertices_count,
+    float               scale,
+    HMM_Vec2            origin,
+    float               distance_range,
+    int                 width,
+    int                 height,
+    uint8_t*            out_texels) {
+  SDL_assert(width > 0 && height > 0);
+  SDL_assert(distance_range > 0.0f);
+  SDL_assert(out_texels != nullptr);
+
+  std::vector<Msdf_Segment> segments;
+  std::vector<Msdf_Edge>    edges;
+  {
+    std::vector<Msdf_Curve> contour;
+    auto                    flush_contour = [&]() {
+      msdf_color_contour(&contour);
+      for (const auto& curve : contour) { msdf_flatten_curve(curve, &segments, &edges); }
+      contour.clear();
+    };
+
+    HMM_Vec2 pen = {};
+    for (int i = 0; i < vertices_count; i++) {
+      const auto& vertex = vertices[i];
+      auto        point  = HMM_V2(vertex.x, vertex.y) * scale - origin;
+
+      Msdf_Curve curve = {};
+      curve.points[0]  = pen;
+      switch (vertex.type) {
+      case STBTT_vmove:
+        flush_contour();
+        pen = point;
+        continue;
+      case STBTT_vline:
+        curve.degree    = 1;
+        curve.points[1] = point;
+        break;
+      case STBTT_vcurve:
+        curve.degree    = 2;
+        curve.points[1] = HMM_V2(vertex.cx, vertex.cy) * scale - origin;
+        curve.points[2] = point;
+        break;
+      case STBTT_vcubic:
+        curve.degree    = 3;
+        curve.points[1] = HMM_V2(vertex.cx, vertex.cy) * scale - origin;
+        curve.points[2] = HMM_V2(vertex.cx1, vertex.cy1) * scale - origin;
+        curve.points[3] = point;
+        break;
+      default:
+        continue;
+      }
+      pen = point;
+      if (curve.points[0].X == point.X && curve.points[0].Y == point.Y && curve.degree == 1) {
+        continue;
+      }
+      contour.push_back(curve);
+    }
+    flush_contour();
+  }
+
+  // Positive distances are on the right of the outline direction, which is the inside for the
+  // clockwise outer contours of TrueType outlines. Flip them for counter-clockwise (CFF) outlines.
+  float area = 0.0f;
+  for (const auto& segment : segments) { area += msdf_cross(segment.a, segment.b); }
+  float orientation = area > 0.0f ? -1.0f : 1.0f;
+
+  std::vector<float> distances(static_cast<size_t>(width) * height * 3);
+  std::vector<float> true_distances(static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      auto p = HMM_V2(x + 0.5f, height - y - 0.5f);
+
+      struct Channel {
+        Msdf_Distance distance;
+        int           edge;
+        int           segment;
+        float         param;
+      };
+      Channel channels[3];
+      for (auto& channel : channels) { channel = {{FLT_MAX, 0.0f}, -1, -1, 0.0f}; }
+      Msdf_Distance true_distance = {FLT_MAX, 0.0f};
+
+      for (int e = 0; e < static_cast<int>(edges.size()); e++) {
+        const auto& edge = edges[e];
+
+        Channel best = {{FLT_MAX, 0.0f}, e, -1, 0.0f};
+        for (int s = edge.first_segment; s < edge.first_segment + edge.segments_count; s++) {
+          float param;
+          auto  distance = msdf_segment_distance(segments[s], p, &param);
+          if (msdf_distance_less(distance, best.distance)) {
+            best.distance = distance;
+            best.segment  = s;
+            best.param    = param;
+          }
+        }
+
+        if (msdf_distance_less(best.distance, true_distance)) { true_distance = best.distance; }
+        for (int c = 0; c < 3; c++) {
+          if ((edge.color & (1 << c)) != 0 &&
+              msdf_distance_less(best.distance, channels[c].distance)) {
+            channels[c] = best;
+          }
+        }
+      }
+
+      // Nonzero winding number of the flattened outline, used to catch texels whose median landed
+      // on the wrong side of the outline.
+      int winding = 0;
+      for (const auto& segment : segments) {
+        if ((segment.a.Y <= p.Y) == (segment.b.Y <= p.Y)) { continue; }
+        float t = (p.Y - segment.a.Y) / (segment.b.Y - segment.a.Y);
+        if (segment.a.X + t * (segment.b.X - segment.a.X) > p.X) {
+          winding += segment.b.Y > segment.a.Y ? 1 : -1;
+        }
+      }
+      bool inside = winding != 0;
+
+      float channel_distances[3];
+      for (int c = 0; c < 3; c++) {
+        const auto& channel = channels[c];
+        if (channel.edge < 0) {
+          channel_distances[c] = -FLT_MAX;
+          continue;
+        }
+        const auto& edge = edges[channel.edge];
+        channel_distances[c] = msdf_pseudo_distance(
+            segments[channel.segment],
+            p,
+            channel.param,
+            channel.segment == edge.first_segment,
+            channel.segment == edge.first_segment + edge.segments_count - 1,
+            channel.distance.distance) * orientation;
+      }
+
+      float median = msdf_median(channel_distances[0], channel_distances[1], channel_distances[2]);
+      if ((median > 0.0f) != inside) {
+        float distance = SDL_fabsf(true_distance.distance) * (inside ? 1.0f : -1.0f);
+        for (auto& channel_distance : channel_distances) { channel_distance = distance; }
+      }
+
+      auto texel = &distances[(static_cast<size_t>(y) * width + x) * 3];
+      for (int c = 0; c < 3; c++) {
+        texel[c] = SDL_clamp(channel_distances[c] / distance_range + 0.5f, 0.0f, 1.0f);
+      }
+      float true_signed_distance = SDL_fabsf(true_distance.distance) * (inside ? 1.0f : -1.0f);
+      true_distances[static_cast<size_t>(y) * width + x] =
+          SDL_clamp(true_signed_distance / distance_range + 0.5f, 0.0f, 1.0f);
+    }
+  }
+
+  {
+    float             threshold = 1.001f / distance_range;
+    std::vector<int> clashes;
+    auto texel = [&](int x, int y) { return &distances[(static_cast<size_t>(y) * width + x) * 3]; };
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        if ((x > 0 && msdf_detect_clash(texel(x, y), texel(x - 1, y), threshold)) ||
+            (x < width - 1 && msdf_detect_clash(texel(x, y), texel(x + 1, y), threshold)) ||
+            (y > 0 && msdf_detect_clash(texel(x, y), texel(x, y - 1), threshold)) ||
+            (y < height - 1 && msdf_detect_clash(texel(x, y), texel(x, y + 1), threshold))) {
+          clashes.push_back(y * width + x);
+        }
+      }
+    }
+    for (auto index : clashes) {
+      auto clash  = &distances[static_cast<size_t>(index) * 3];
+      auto median = msdf_median(clash[0], clash[1], clash[2]);
+      clash[0] = clash[1] = clash[2] = median;
+    }
+  }
+
+  for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+    for (int c = 0; c < 3; c++) {
+      out_texels[i * 4 + c] = static_cast<uint8_t>(distances[i * 3 + c] * 255.0f + 0.5f);
+    }
+    out_texels[i * 4 + 3] = static_cast<uint8_t>(true_distances[i] * 255.0f + 0.5f);
+  }
+}
@@ -1,6 +1,7 @@
 // -- External Header Includes ------------------------------------------------
 #include <HandmadeMath.h>
 #include <SDL3/SDL.h>
+#include <SDL3/SDL_intrin.h>
 #define SDL_MAIN_USE_CALLBACKS 1
 #include <SDL3/SDL_main.h>
 #include <imgui.h>
@@ -9,32 +10,66 @@
 #include <json.hpp>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_STATIC
+#include <imstb_truetype.h>
 
 // -- Std Header Includes -----------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <deque>
+#include <list>
+#include <map>
 #include <unordered_map>
 #include <vector>
 
+// -- Platform Header Includes ------------------------------------------------
+#if defined(SDL_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // -- Local Source Includes ---------------------------------------------------
 #include "common.cpp"
+#include "thread_pool.cpp"
+#include "upload_scheduler.cpp"
+#include "skyline_packer.cpp"
 #include "imgui_font.cpp"
 #include "demo_strings.cpp"
 #include "font_atlas.cpp"
+#include "msdf.cpp"
+#include "font_atlas_dynamic.cpp"
 #include "text_batch.cpp"
+#include "text_static.cpp"
+#include "benchmark.cpp"
 
 // TODOs:
-// - Text Static.
-// - MSDFA atlases and a blur effect example.
 // - Add on hover descriptions for demo kinds.
 
 enum Demo_Kind {
   DEMO_KIND_TEXT_BATCH_SINGLELINE,
   DEMO_KIND_TEXT_BATCH_MULTILINE,
   DEMO_KIND_TEXT_BATCH_STARWARS,
+  DEMO_KIND_TEXT_STATIC,
   DEMO_KIND_COUNT,
 };
 
+static constexpr const char* DEMO_KIND_NAMES[DEMO_KIND_COUNT] = {
+    "Text Batch Single-Line",
+    "Text Batch Multi-Line",
+    "Text Batch Star Wars",
+    "Text Static",
+};
+
 struct App_State {
   std::string          base_path;
+  Thread_Pool          thread_pool;
   SDL_GPUDevice*       device;
   SDL_Window*          window;
   SDL_GPUTextureFormat swapchain_texture_format;
@@ -50,10 +85,14 @@ struct App_State {
 
   ImFont* imgui_font;
 
+  Upload_Scheduler   upload_scheduler;
   Font_Atlas_Kind    font_atlas_kind;
   int                font_variant;
   Font_Atlas         font_atlases[FONT_ATLAS_KIND_COUNT];
+  Font_Atlas_Array   font_atlas_array;
+  int                font_atlas_preview_layer = -1;
   Text_Batch         text_batch;
+  Text_Static        text_static;
   Demo_Kind          demo_kind;
   HMM_Vec2           text_block_size;
   HMM_Vec4           bg_color               = HMM_V4(0.078f, 0.076f, 0.069f, 1.0f);
@@ -64,12 +103,19 @@ struct App_State {
   HMM_Vec4           text_color             = HMM_V4(0.024f, 0.02f, 0.019f, 1.0f);
   HMM_Vec4           text_outline_color;
   float              text_outline_thickness;
+  bool               text_glow;
+  HMM_Vec4           text_glow_color;
+  float              text_glow_thickness;
+  float              text_blur_radius;
   struct {
     std::string text = "Example Text!";
   } demo_basic;
   struct {
-    HMM_Vec2 camera_position;
-    float    camera_zoom = 1.0f;
+    HMM_Vec2 position;
+    float    zoom = 1.0f;
+  } demo_camera;
+  struct {
+    bool clip_lines = true;
   } demo_multiline;
   struct {
     float scroll_position;
@@ -77,12 +123,18 @@ struct App_State {
     float fade_out_timer;
     float fade_out_duration;
   } demo_starwars;
+  struct {
+    int      grid_size = 10;
+    double   build_ms;
+    HMM_Mat4 world_to_clip_transform;
+  } demo_static;
 };
 
 static void update_demo_view_to_clip_transform(App_State* as) {
   switch (as->demo_kind) {
   case DEMO_KIND_TEXT_BATCH_SINGLELINE:
   case DEMO_KIND_TEXT_BATCH_MULTILINE:
+  case DEMO_KIND_TEXT_STATIC:
     as->view_to_clip_transform = HMM_Orthographic_RH_NO(
         0.0f,
         as->window_size_pixels.X,
@@ -103,6 +155,19 @@ static void update_demo_view_to_clip_transform(App_State* as) {
   }
 }
 
+static bool demo_kind_has_camera(Demo_Kind kind) {
+  return kind == DEMO_KIND_TEXT_BATCH_MULTILINE || kind == DEMO_KIND_TEXT_STATIC;
+}
+
+static HMM_Mat4 demo_camera_world_to_clip_transform(App_State* as) {
+  auto camera_pos              = as->demo_camera.position;
+  auto camera_zoom             = as->demo_camera.zoom;
+  auto translation             = HMM_Translate(HMM_V3(camera_pos.X, camera_pos.Y, 0.0f));
+  auto scale                   = HMM_Scale(HMM_V3(camera_zoom, camera_zoom, 1.0f));
+  auto world_to_view_transform = translation * scale;
+  return as->view_to_clip_transform * world_to_view_transform;
+}
+
 static void on_window_pixel_size_changed(App_State* as, int width, int height) {
   if (as->window_size_pixels.X == width && as->window_size_pixels.Y == height) { return; }
   as->window_size_pixels = HMM_V2(width, height);
@@ -130,9 +195,57 @@ static void on_vsync_changed(App_State* as, bool vsync) {
       present_mode);
 }
 
+// Lays out a grid of grid_size x grid_size lorem ipsum blocks into the static text, about 10k
+// glyphs per block, and uploads it.
+static bool demo_static_build(App_State* as) {
+  auto start_counter = SDL_GetPerformanceCounter();
+
+  auto cmd_buf = SDL_AcquireGPUCommandBuffer(as->device);
+  if (cmd_buf == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to acquire command buffer: %s",
+        SDL_GetError());
+    return false;
+  }
+  auto copy_pass = SDL_BeginGPUCopyPass(cmd_buf);
+
+  auto  grid_size  = as->demo_static.grid_size;
+  auto  block_size = as->text_block_size + HMM_V2(48.0f, 48.0f);
+  auto  grid_start = block_size * (static_cast<float>(grid_size - 1) * -0.5f);
+  auto& font_atlas = as->font_atlases[as->font_atlas_kind];
+  text_static_begin(&as->text_static, &font_atlas, as->font_variant);
+  for (int y = 0; y < grid_size; y++) {
+    for (int x = 0; x < grid_size; x++) {
+      text_static_draw_multiline(
+          &as->text_static,
+          demo_string_lorem_ipsum,
+          HMM_V3(grid_start.X + x * block_size.X, grid_start.Y + y * block_size.Y, 0.0f),
+          as->text_size,
+          as->text_h_align,
+          as->text_v_align,
+          as->text_color,
+          as->text_block_size);
+    }
+  }
+  bool succeeded = text_static_end(&as->text_static, as->device, copy_pass);
+
+  SDL_EndGPUCopyPass(copy_pass);
+  SDL_SubmitGPUCommandBuffer(cmd_buf);
+
+  as->demo_static.build_ms =
+      static_cast<double>(SDL_GetPerformanceCounter() - start_counter) * 1000.0 /
+      static_cast<double>(SDL_GetPerformanceFrequency());
+
+  return succeeded;
+}
+
 static void on_demo_kind_selection(App_State* as, Demo_Kind kind) {
   as->demo_kind = kind;
 
+  // The static text of the last selection can take hundreds of megabytes.
+  if (as->demo_kind != DEMO_KIND_TEXT_STATIC) { text_static_destroy(&as->text_static, as->device); }
+
   switch (as->demo_kind) {
   case DEMO_KIND_TEXT_BATCH_SINGLELINE:
     as->font_atlas_kind = FONT_ATLAS_KIND_ROBOTO;
@@ -152,11 +265,11 @@ static void on_demo_kind_selection(App_State* as, Demo_Kind kind) {
         as->font_atlases[as->font_atlas_kind].variants[as->font_variant],
         demo_string_lorem_ipsum,
         as->text_size);
-    as->text_color                     = HMM_V4(0.024f, 0.02f, 0.019f, 1.0f);
-    as->demo_multiline.camera_position = as->window_size_pixels * 0.5f;
-    as->demo_multiline.camera_zoom     = 1.0f;
-    as->text_h_align                   = TEXT_BATCH_H_ALIGN_LEFT;
-    as->text_v_align                   = TEXT_BATCH_V_ALIGN_MIDDLE;
+    as->text_color           = HMM_V4(0.024f, 0.02f, 0.019f, 1.0f);
+    as->demo_camera.position = as->window_size_pixels * 0.5f;
+    as->demo_camera.zoom     = 1.0f;
+    as->text_h_align         = TEXT_BATCH_H_ALIGN_LEFT;
+    as->text_v_align         = TEXT_BATCH_V_ALIGN_MIDDLE;
     break;
   case DEMO_KIND_TEXT_BATCH_STARWARS:
     as->demo_starwars.scroll_position = 250.0f;
@@ -172,9 +285,31 @@ static void on_demo_kind_selection(App_State* as, Demo_Kind kind) {
     as->text_color             = HMM_V4(0.014f, 0.985f, 0.998f, 1.0f);
     as->text_outline_color     = HMM_V4(0.998f, 0.987f, 0.997f, 1.0f);
     as->text_outline_thickness = 0.4f;
+    as->text_glow              = false;
+    as->text_glow_color        = HMM_V4(0.2f, 0.6f, 1.0f, 0.8f);
+    as->text_glow_thickness    = 0.3f;
+    as->text_blur_radius       = 0.0f;
     as->text_h_align           = TEXT_BATCH_H_ALIGN_CENTER;
     as->text_v_align           = TEXT_BATCH_V_ALIGN_TOP;
     break;
+  case DEMO_KIND_TEXT_STATIC:
+    as->font_atlas_kind = FONT_ATLAS_KIND_ROBOTO;
+    as->font_variant    = FONT_ATLAS_ROBOTO_VARIANT_REGULAR;
+    as->bg_color        = HMM_V4(0.97f, 0.95f, 0.86f, 1.0f);
+    as->text_size       = 24.0f;
+    as->text_block_size = font_atlas_string_multiline_block_size(
+        as->font_atlases[as->font_atlas_kind].variants[as->font_variant],
+        demo_string_lorem_ipsum,
+        as->text_size);
+    as->text_color           = HMM_V4(0.024f, 0.02f, 0.019f, 1.0f);
+    as->text_h_align         = TEXT_BATCH_H_ALIGN_LEFT;
+    as->text_v_align         = TEXT_BATCH_V_ALIGN_MIDDLE;
+    as->demo_camera.position = as->window_size_pixels * 0.5f;
+    as->demo_camera.zoom     = 0.1f;
+    if (!demo_static_build(as)) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build static text");
+    }
+    break;
   default:
     break;
   }
@@ -182,6 +317,8 @@ static void on_demo_kind_selection(App_State* as, Demo_Kind kind) {
   update_demo_view_to_clip_transform(as);
 }
 
+static void update_and_draw_demo(App_State* as, float dt);
+
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
   if (!SDL_Init(SDL_INIT_VIDEO)) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to init SDL: %s", SDL_GetError());
@@ -197,6 +334,11 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
 
   as->base_path = SDL_GetBasePath();
 
+  bool run_benchmarks = false;
+  for (int i = 1; i < argc; i++) {
+    if (SDL_strcmp(argv[i], "--benchmark") == 0) { run_benchmarks = true; }
+  }
+
   SDL_GPUShaderFormat format_flags = 0;
 #ifdef SDL_PLATFORM_WINDOWS
   format_flags |= SDL_GPU_SHADERFORMAT_DXIL;
@@ -209,6 +351,11 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
 #ifdef BUILD_DEBUG
   debug = true;
 #endif
+  if (!thread_pool_create(&as->thread_pool, SDL_max(SDL_GetNumLogicalCPUCores() - 1, 1))) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create thread pool");
+    return SDL_APP_FAILURE;
+  }
+
   as->device = SDL_CreateGPUDevice(format_flags, debug, nullptr);
   if (as->device == nullptr) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create gpu device: %s", SDL_GetError());
@@ -290,24 +437,44 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
         SDL_GetError());
     return SDL_APP_FAILURE;
   }
-  auto copy_pass = SDL_BeginGPUCopyPass(cmd_buf);
-  for (int i = 0; i < FONT_ATLAS_KIND_COUNT; i++) {
-    if (!font_atlas_load(
-            &as->font_atlases[i],
-            static_cast<Font_Atlas_Kind>(i),
-            as->base_path,
-            as->device,
-            copy_pass)) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font atlas");
-      return SDL_APP_FAILURE;
-    }
+  if (!font_atlas_array_create(
+          &as->font_atlas_array,
+          as->device,
+          FONT_ATLAS_KIND_BAKED_COUNT + FONT_ATLAS_DYNAMIC_LAYERS_COUNT)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create font atlas array");
+    return SDL_APP_FAILURE;
+  }
+  upload_scheduler_create(&as->upload_scheduler, as->device);
+  if (!font_atlas_load_all(
+          as->font_atlases,
+          as->base_path,
+          &as->font_atlas_array,
+          &as->upload_scheduler,
+          &as->thread_pool)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font atlases");
+    return SDL_APP_FAILURE;
+  }
+  upload_scheduler_flush(&as->upload_scheduler, cmd_buf);
+  upload_scheduler_submit(&as->upload_scheduler, cmd_buf);
+
+  if (!font_atlas_dynamic_create(
+          &as->font_atlases[FONT_ATLAS_KIND_ROBOTO_DYNAMIC],
+          as->base_path,
+          FONT_ATLAS_DYNAMIC_ROBOTO_FILES,
+          FONT_ATLAS_ROBOTO_VARIANT_COUNT,
+          &as->font_atlas_array,
+          FONT_ATLAS_KIND_BAKED_COUNT,
+          as->device,
+          &as->thread_pool)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create dynamic font atlas");
+    return SDL_APP_FAILURE;
   }
-  SDL_EndGPUCopyPass(copy_pass);
-  SDL_SubmitGPUCommandBuffer(cmd_buf);
 
   if (!text_batch_create(
           &as->text_batch,
           as->base_path,
+          as->font_atlas_array,
+          &as->upload_scheduler,
           as->device,
           as->swapchain_texture_format)) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create text batch");
@@ -322,6 +489,69 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
   }
   on_demo_kind_selection(as, DEMO_KIND_TEXT_BATCH_SINGLELINE);
 
+  // Benchmarks that check their results return false when a check fails, which fails the run.
+  if (run_benchmarks) {
+    bool checks_passed = true;
+    benchmark_font_atlas_load(as->base_path, as->device);
+    benchmark_glyph_lookup(as->font_atlases[FONT_ATLAS_KIND_ROBOTO]);
+    benchmark_utf8_decode();
+    for (int i = 0; i < FONT_ATLAS_KIND_BAKED_COUNT; i++) {
+      benchmark_kerning_lookup(as->font_atlases[i], FONT_ATLAS_KIND_NAMES[i]);
+    }
+    benchmark_glyph_emission(as->font_atlases[FONT_ATLAS_KIND_ROBOTO]);
+    checks_passed &= benchmark_dynamic_glyphs(
+        as->font_atlases[FONT_ATLAS_KIND_ROBOTO_DYNAMIC],
+        as->base_path);
+    checks_passed &= benchmark_glyph_cache(as->base_path, as->device, &as->thread_pool);
+    benchmark_mixed_fonts(&as->text_batch, as->font_atlases);
+    benchmark_text_layout(&as->font_atlases[FONT_ATLAS_KIND_ROBOTO]);
+    checks_passed &= benchmark_instance_generation(&as->font_atlases[FONT_ATLAS_KIND_ROBOTO]);
+    benchmark_layout_cache(&as->text_batch, &as->font_atlases[FONT_ATLAS_KIND_ROBOTO]);
+    benchmark_line_clipping(&as->text_batch, &as->font_atlases[FONT_ATLAS_KIND_ROBOTO]);
+    benchmark_text_static(
+        as->base_path,
+        as->font_atlas_array,
+        &as->font_atlases[FONT_ATLAS_KIND_ROBOTO],
+        as->device,
+        as->swapchain_texture_format);
+    benchmark_text_batch_growth(
+        as->base_path,
+        as->font_atlas_array,
+        &as->font_atlases[FONT_ATLAS_KIND_ROBOTO],
+        as->device,
+        as->swapchain_texture_format);
+    benchmark_draw_submission(
+        as->base_path,
+        as->font_atlas_array,
+        &as->font_atlases[FONT_ATLAS_KIND_ROBOTO],
+        as->device,
+        as->swapchain_texture_format);
+    benchmark_effect_batching(
+        as->base_path,
+        as->font_atlas_array,
+        &as->font_atlases[FONT_ATLAS_KIND_ROBOTO],
+        as->device,
+        as->swapchain_texture_format);
+    checks_passed &= benchmark_effect_reference(as->font_atlases[FONT_ATLAS_KIND_ROBOTO_DYNAMIC]);
+    benchmark_gpu_culling(
+        as->base_path,
+        as->font_atlas_array,
+        &as->font_atlases[FONT_ATLAS_KIND_ROBOTO],
+        as->device,
+        as->swapchain_texture_format);
+    benchmark_demo_uploads(
+        &as->text_batch,
+        as->font_atlas_array,
+        as->device,
+        DEMO_KIND_NAMES,
+        DEMO_KIND_COUNT,
+        [&](int i) {
+          on_demo_kind_selection(as, static_cast<Demo_Kind>(i));
+          update_and_draw_demo(as, 0.0f);
+        });
+    return checks_passed ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+  }
+
   as->count_per_second  = SDL_GetPerformanceFrequency();
   as->last_counter      = SDL_GetPerformanceCounter();
   as->max_counter_delta = as->count_per_second / 60 * 8;
@@ -351,26 +581,25 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
     on_display_content_scale_changed(as, SDL_GetDisplayContentScale(event->display.displayID));
     break;
   case SDL_EVENT_MOUSE_MOTION: {
-    if (as->demo_kind == DEMO_KIND_TEXT_BATCH_MULTILINE && !io.WantCaptureMouse) {
+    if (demo_kind_has_camera(as->demo_kind) && !io.WantCaptureMouse) {
       if ((event->motion.state & SDL_BUTTON_LEFT) != 0) {
-        as->demo_multiline.camera_position += HMM_V2(event->motion.xrel, -event->motion.yrel);
+        as->demo_camera.position += HMM_V2(event->motion.xrel, -event->motion.yrel);
       }
     }
   } break;
   case SDL_EVENT_MOUSE_WHEEL: {
-    if (as->demo_kind == DEMO_KIND_TEXT_BATCH_MULTILINE && !io.WantCaptureMouse) {
+    if (demo_kind_has_camera(as->demo_kind) && !io.WantCaptureMouse) {
       HMM_Vec2 mouse_pos =
           HMM_V2(event->wheel.mouse_x, as->window_size_pixels.Y - event->wheel.mouse_y);
-      HMM_Vec2 last_mouse_world =
-          (mouse_pos - as->demo_multiline.camera_position) / as->demo_multiline.camera_zoom;
+      HMM_Vec2 last_mouse_world = (mouse_pos - as->demo_camera.position) / as->demo_camera.zoom;
 
-      as->demo_multiline.camera_zoom += event->wheel.y * 0.1f * as->demo_multiline.camera_zoom;
-      as->demo_multiline.camera_zoom = HMM_Clamp(0.25f, as->demo_multiline.camera_zoom, 15.0f);
+      // The static text grid is far larger than the multi-line one, let it zoom out further.
+      float min_zoom = as->demo_kind == DEMO_KIND_TEXT_STATIC ? 0.02f : 0.25f;
+      as->demo_camera.zoom += event->wheel.y * 0.1f * as->demo_camera.zoom;
+      as->demo_camera.zoom = HMM_Clamp(min_zoom, as->demo_camera.zoom, 15.0f);
 
-      HMM_Vec2 mouse_world =
-          (mouse_pos - as->demo_multiline.camera_position) / as->demo_multiline.camera_zoom;
-      as->demo_multiline.camera_position +=
-          (mouse_world - last_mouse_world) * as->demo_multiline.camera_zoom;
+      HMM_Vec2 mouse_world = (mouse_pos - as->demo_camera.position) / as->demo_camera.zoom;
+      as->demo_camera.position += (mouse_world - last_mouse_world) * as->demo_camera.zoom;
     }
   } break;
   }
@@ -397,12 +626,10 @@ static void update_and_draw_demo(App_State* as, float dt) {
     text_batch_end(&as->text_batch);
   } break;
   case DEMO_KIND_TEXT_BATCH_MULTILINE: {
-    auto camera_pos  = as->demo_multiline.camera_position;
-    auto translation = HMM_Translate(HMM_V3(camera_pos.X, camera_pos.Y, 0.0f));
-    auto scale =
-        HMM_Scale(HMM_V3(as->demo_multiline.camera_zoom, as->demo_multiline.camera_zoom, 1.0f));
-    auto world_to_view_transform = translation * scale;
-    auto world_to_clip_transform = as->view_to_clip_transform * world_to_view_transform;
+    // Zoomed in, most lines of the blocks are off-screen and aren't emitted.
+    auto world_to_clip_transform = demo_camera_world_to_clip_transform(as);
+    auto clip_rect               = text_batch_clip_rect(world_to_clip_transform, 0.0f);
+    auto clip_rect_ptr           = as->demo_multiline.clip_lines ? &clip_rect : nullptr;
 
     text_batch_begin_basic(
         &as->text_batch,
@@ -417,7 +644,8 @@ static void update_and_draw_demo(App_State* as, float dt) {
         as->text_h_align,
         as->text_v_align,
         as->text_color,
-        as->text_block_size);
+        as->text_block_size,
+        clip_rect_ptr);
     text_batch_draw_multiline(
         &as->text_batch,
         demo_string_lorem_ipsum,
@@ -426,7 +654,8 @@ static void update_and_draw_demo(App_State* as, float dt) {
         as->text_h_align,
         as->text_v_align,
         as->text_color,
-        as->text_block_size);
+        as->text_block_size,
+        clip_rect_ptr);
     text_batch_draw_multiline(
         &as->text_batch,
         demo_string_lorem_ipsum,
@@ -435,7 +664,8 @@ static void update_and_draw_demo(App_State* as, float dt) {
         as->text_h_align,
         as->text_v_align,
         as->text_color,
-        as->text_block_size);
+        as->text_block_size,
+        clip_rect_ptr);
     text_batch_end(&as->text_batch);
   } break;
   case DEMO_KIND_TEXT_BATCH_STARWARS: {
@@ -463,13 +693,38 @@ static void update_and_draw_demo(App_State* as, float dt) {
     auto world_to_view_transform = HMM_LookAt_RH(camera_position, camera_target, camera_up);
     auto world_to_clip_transform = as->view_to_clip_transform * world_to_view_transform;
 
-    text_batch_begin_outline(
-        &as->text_batch,
-        world_to_clip_transform,
-        &as->font_atlases[as->font_atlas_kind],
-        as->font_variant,
-        HMM_V4(as->text_outline_color.R, as->text_outline_color.G, as->text_outline_color.B, alpha),
-        as->text_outline_thickness);
+    // The glow and blur are only drawn by the uber pipeline, which takes the outline along.
+    Text_Batch_Style style  = {};
+    style.effects           = TEXT_BATCH_EFFECT_OUTLINE;
+    style.outline_color     = as->text_outline_color;
+    style.outline_color.A   = alpha;
+    style.outline_thickness = as->text_outline_thickness;
+    if (as->text_glow) {
+      style.effects        |= TEXT_BATCH_EFFECT_GLOW;
+      style.glow_color      = as->text_glow_color;
+      style.glow_color.A   *= alpha;
+      style.glow_thickness  = as->text_glow_thickness;
+    }
+    if (as->text_blur_radius > 0.0f) {
+      style.effects     |= TEXT_BATCH_EFFECT_BLUR;
+      style.blur_radius  = as->text_blur_radius;
+    }
+    if (style.effects != TEXT_BATCH_EFFECT_OUTLINE) {
+      text_batch_begin_effects(
+          &as->text_batch,
+          world_to_clip_transform,
+          &as->font_atlases[as->font_atlas_kind],
+          as->font_variant,
+          style);
+    } else {
+      text_batch_begin_outline(
+          &as->text_batch,
+          world_to_clip_transform,
+          &as->font_atlases[as->font_atlas_kind],
+          as->font_variant,
+          style.outline_color,
+          style.outline_thickness);
+    }
     text_batch_draw_multiline(
         &as->text_batch,
         demo_string_star_wars,
@@ -481,6 +736,10 @@ static void update_and_draw_demo(App_State* as, float dt) {
         as->text_block_size);
     text_batch_end(&as->text_batch);
   } break;
+  case DEMO_KIND_TEXT_STATIC: {
+    // Nothing is laid out or uploaded per frame, only the transform changes.
+    as->demo_static.world_to_clip_transform = demo_camera_world_to_clip_transform(as);
+  } break;
   default:
     break;
   }
@@ -488,15 +747,10 @@ static void update_and_draw_demo(App_State* as, float dt) {
 
 static void draw_imgui(App_State* as) {
   if (ImGui::Begin("SDL3 GPU MSDF Text Demo", nullptr, ImGuiWindowFlags_HorizontalScrollbar)) {
-    static constexpr const char* demo_kind_strings[DEMO_KIND_COUNT] = {
-        "Text Batch Single-Line",
-        "Text Batch Multi-Line",
-        "Text Batch Star Wars",
-    };
-    if (ImGui::BeginCombo("Demo Selection", demo_kind_strings[as->demo_kind])) {
+    if (ImGui::BeginCombo("Demo Selection", DEMO_KIND_NAMES[as->demo_kind])) {
       for (int i = 0; i < DEMO_KIND_COUNT; i++) {
         bool is_selected = as->demo_kind == i;
-        if (ImGui::Selectable(demo_kind_strings[i], is_selected)) {
+        if (ImGui::Selectable(DEMO_KIND_NAMES[i], is_selected)) {
           on_demo_kind_selection(as, static_cast<Demo_Kind>(i));
         }
         if (is_selected) { ImGui::SetItemDefaultFocus(); }
@@ -523,6 +777,7 @@ static void draw_imgui(App_State* as) {
       const auto& font_atlas = as->font_atlases[as->font_atlas_kind];
 
       ImGui::ColorEdit4("Text Color", &as->text_color.X);
+      bool text_color_edited = ImGui::IsItemDeactivatedAfterEdit();
 
       switch (as->demo_kind) {
       case DEMO_KIND_TEXT_BATCH_SINGLELINE: {
@@ -603,6 +858,7 @@ static void draw_imgui(App_State* as) {
           }
           ImGui::EndCombo();
         }
+        ImGui::Checkbox("Clip Lines", &as->demo_multiline.clip_lines);
       } break;
       case DEMO_KIND_TEXT_BATCH_STARWARS: {
         ImGui::ColorEdit4("Text Outline Color", &as->text_outline_color.X);
@@ -612,23 +868,151 @@ static void draw_imgui(App_State* as) {
             0.0f,
             0.4f,
             "%.1f");
+        ImGui::Checkbox("Text Glow", &as->text_glow);
+        if (as->text_glow) {
+          ImGui::ColorEdit4("Text Glow Color", &as->text_glow_color.X);
+          ImGui::SliderFloat(
+              "Text Glow Thickness",
+              &as->text_glow_thickness,
+              0.0f,
+              0.5f,
+              "%.2f");
+        }
+        ImGui::SliderFloat("Text Blur Radius", &as->text_blur_radius, 0.0f, 0.5f, "%.2f");
 
         ImGui::SliderFloat("Scroll Speed", &as->demo_starwars.scroll_speed, 0.0f, 200.0f, "%.0f");
 
         if (ImGui::Button("Reset")) { on_demo_kind_selection(as, DEMO_KIND_TEXT_BATCH_STARWARS); }
       } break;
+      case DEMO_KIND_TEXT_STATIC: {
+        // The text is only laid out and uploaded again when the grid size or color changes.
+        ImGui::SliderInt("Grid Size", &as->demo_static.grid_size, 1, 16);
+        bool rebuild = text_color_edited || ImGui::IsItemDeactivatedAfterEdit();
+        if ((ImGui::Button("Rebuild") || rebuild) && !demo_static_build(as)) {
+          SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build static text");
+        }
+
+        ImGui::LabelText("Glyphs", "%d", as->text_static.instances_count);
+        ImGui::LabelText(
+            "GPU Memory",
+            "%.1f MB",
+            static_cast<double>(as->text_static.instances_count) * sizeof(Text_Batch_Instance) /
+                (1024.0 * 1024.0));
+        ImGui::LabelText("Build Time", "%.3f ms", as->demo_static.build_ms);
+      } break;
       default:
         break;
       }
     }
     ImGui::Separator();
 
+    if (ImGui::CollapsingHeader("Text Batch")) {
+      const auto& text_batch = as->text_batch;
+      ImGui::LabelText(
+          "Capacity",
+          "%d instances (%.1f MB)",
+          text_batch.capacity,
+          static_cast<double>(text_batch.capacity) * sizeof(Text_Batch_Instance) /
+              (1024.0 * 1024.0));
+      ImGui::LabelText("Peak Instances", "%d", text_batch.stats.peak_instances_count);
+      ImGui::LabelText(
+          "Uploaded",
+          "%.1f KB/frame",
+          static_cast<double>(text_batch.stats.uploaded_bytes) / 1024.0);
+      ImGui::LabelText(
+          "Reused",
+          "%.1f KB/frame",
+          static_cast<double>(text_batch.stats.reused_bytes) / 1024.0);
+      ImGui::LabelText("Repacks", "%" SDL_PRIu64, text_batch.stats.repack_count);
+      ImGui::LabelText("Grow Events", "%" SDL_PRIu64, text_batch.stats.grow_count);
+      ImGui::LabelText("Shrink Events", "%" SDL_PRIu64, text_batch.stats.shrink_count);
+      ImGui::Checkbox("Sort Draw Cmds", &as->text_batch.sort_draw_cmds);
+      ImGui::Checkbox("Uber Effects", &as->text_batch.uber_effects);
+      ImGui::LabelText(
+          "Draws",
+          "%d for %d draw cmds",
+          text_batch.stats.draws_count,
+          text_batch.stats.draw_cmds_count);
+      ImGui::LabelText("Pipeline Binds", "%d/frame", text_batch.stats.pipeline_binds_count);
+      ImGui::LabelText("Uniform Pushes", "%d/frame", text_batch.stats.uniform_pushes_count);
+      ImGui::Checkbox("GPU Culling", &as->text_batch.gpu_culling);
+      if (as->text_batch.gpu_culling) {
+        const auto& stats = text_batch.stats;
+        ImGui::LabelText(
+            "Visible",
+            "%d of %d instances (%.1f%% culled)",
+            stats.cull_visible_count,
+            stats.cull_tested_count,
+            stats.cull_tested_count > 0
+                ? 100.0 * (stats.cull_tested_count - stats.cull_visible_count) /
+                      stats.cull_tested_count
+                : 0.0);
+      }
+    }
+    ImGui::Separator();
+
+    if (ImGui::CollapsingHeader("Layout Cache")) {
+      auto&       cache = as->text_batch.layout_cache;
+      const auto& stats = cache.stats;
+      if (ImGui::Checkbox("Enabled", &cache.enabled) && !cache.enabled) {
+        text_layout_cache_clear(&cache);
+      }
+      auto lookups_count = stats.hits_count + stats.misses_count;
+      ImGui::LabelText(
+          "Hit Rate",
+          "%.1f%% (%" SDL_PRIu64 " hits, %" SDL_PRIu64 " misses)",
+          lookups_count > 0 ? 100.0 * stats.hits_count / lookups_count : 0.0,
+          stats.hits_count,
+          stats.misses_count);
+      ImGui::LabelText("Entries", "%d", static_cast<int>(cache.entries.size()));
+      ImGui::LabelText(
+          "Memory",
+          "%.1f KB / %.1f KB",
+          static_cast<double>(cache.bytes) / 1024.0,
+          static_cast<double>(cache.budget_bytes) / 1024.0);
+      ImGui::LabelText("Evictions", "%" SDL_PRIu64, stats.evictions_count);
+    }
+    ImGui::Separator();
+
+    if (ImGui::CollapsingHeader("Uploads")) {
+      const auto& scheduler = as->upload_scheduler;
+      const auto& stats     = scheduler.stats;
+      ImGui::LabelText(
+          "Arena",
+          "%.1f MB x %d frames",
+          static_cast<double>(scheduler.block_size) / (1024.0 * 1024.0),
+          UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT);
+      ImGui::LabelText(
+          "Used",
+          "%.1f KB/frame (%d blocks)",
+          static_cast<double>(stats.used_bytes) / 1024.0,
+          stats.blocks_count);
+      ImGui::LabelText("Copies", "%d/frame", stats.copies_count);
+      for (int i = 0; i < UPLOAD_CLIENT_COUNT; i++) {
+        ImGui::LabelText(
+            UPLOAD_CLIENT_NAMES[i],
+            "%.1f KB in %d allocations",
+            static_cast<double>(stats.client_bytes[i]) / 1024.0,
+            stats.client_allocations_count[i]);
+      }
+      ImGui::LabelText("Grow Events", "%" SDL_PRIu64, stats.grow_count);
+      ImGui::LabelText("Shrink Events", "%" SDL_PRIu64, stats.shrink_count);
+      ImGui::LabelText("Fence Waits", "%" SDL_PRIu64, stats.fence_waits_count);
+      ImGui::LabelText(
+          "Fence Wait",
+          "%.3f ms (max %.3f ms)",
+          stats.fence_wait_ms,
+          stats.max_fence_wait_ms);
+    }
+    ImGui::Separator();
+
     if (ImGui::CollapsingHeader("Font Atlas", ImGuiTreeNodeFlags_DefaultOpen)) {
       ImGui::BeginDisabled(as->demo_kind != DEMO_KIND_TEXT_BATCH_SINGLELINE);
       static constexpr const char* font_atlas_kind_strings[FONT_ATLAS_KIND_COUNT] = {
           "Roboto",
           "Science Gothic",
           "Limelight",
+          "Roboto (Dynamic)",
       };
       if (ImGui::BeginCombo("Font Selection", font_atlas_kind_strings[as->font_atlas_kind])) {
         for (int i = 0; i < FONT_ATLAS_KIND_COUNT; i++) {
@@ -658,7 +1042,8 @@ static void draw_imgui(App_State* as) {
               "Light",
           };
       switch (as->font_atlas_kind) {
-      case FONT_ATLAS_KIND_ROBOTO: {
+      case FONT_ATLAS_KIND_ROBOTO:
+      case FONT_ATLAS_KIND_ROBOTO_DYNAMIC: {
         if (ImGui::BeginCombo(
                 "Font Variant Selection",
                 font_roboto_variant_strings[as->font_variant])) {
@@ -691,11 +1076,57 @@ static void draw_imgui(App_State* as) {
       ImGui::EndDisabled();
 
       ImGui::LabelText("Width", "%d", font_atlas.width);
-      ImGui::LabelText("Height", "%d", font_atlas.width);
+      ImGui::LabelText("Height", "%d", font_atlas.height);
+      if (font_atlas.dynamic != nullptr) {
+        const auto& dynamic = *font_atlas.dynamic;
+        ImGui::LabelText("Resident Glyphs", "%d", dynamic.resident_glyphs_count);
+        ImGui::LabelText("Pending Glyphs", "%d", dynamic.pending_jobs_count);
+        ImGui::LabelText(
+            "Generate Time",
+            "%.3f ms/glyph",
+            dynamic.generated_glyphs_count > 0
+                ? dynamic.generate_ms / dynamic.generated_glyphs_count
+                : 0.0);
+        ImGui::LabelText("Uploaded", "%u bytes", dynamic.uploaded_bytes);
+
+        auto lookups_count = dynamic.hits_count + dynamic.misses_count;
+        ImGui::LabelText(
+            "Hit Rate",
+            "%.2f%%",
+            lookups_count > 0 ? 100.0 * dynamic.hits_count / lookups_count : 0.0);
+        ImGui::LabelText("Evicted Glyphs", "%" SDL_PRIu64, dynamic.evicted_glyphs_count);
+        ImGui::LabelText("Recycled Glyphs", "%" SDL_PRIu64, dynamic.recycled_glyphs_count);
+        ImGui::LabelText("Compacted Pages", "%" SDL_PRIu64, dynamic.compacted_pages_count);
+        for (int i = 0; i < FONT_ATLAS_DYNAMIC_PAGES_COUNT; i++) {
+          const auto& page       = dynamic.pages[i];
+          auto        page_area  = font_atlas.width * FONT_ATLAS_DYNAMIC_PAGE_HEIGHT;
+          auto        page_label = "Page " + std::to_string(i);
+          ImGui::LabelText(
+              page_label.c_str(),
+              "%d glyphs, %.1f%% occupied",
+              page.glyphs_count,
+              100.0f * page.used_area / page_area);
+        }
+      }
+      as->font_atlas_preview_layer = -1;
       if (ImGui::TreeNode("Texture")) {
+        // The preview texture is a copy of one layer of the array, refreshed by the next frame.
+        static int layer_offset = 0;
+        if (font_atlas.layers_count > 1) {
+          ImGui::SliderInt("Layer", &layer_offset, 0, font_atlas.layers_count - 1);
+        }
+        layer_offset = SDL_clamp(layer_offset, 0, font_atlas.layers_count - 1);
+        as->font_atlas_preview_layer = font_atlas.layer + layer_offset;
+
+        auto layer_height = SDL_min(font_atlas.height, FONT_ATLAS_LAYER_SIZE);
         ImGui::Image(
-            static_cast<ImTextureID>(reinterpret_cast<uintptr_t>(font_atlas.texture)),
-            ImVec2(font_atlas.width, font_atlas.height));
+            static_cast<ImTextureID>(
+                reinterpret_cast<uintptr_t>(as->font_atlas_array.preview_texture)),
+            ImVec2(font_atlas.width, layer_height),
+            ImVec2(0.0f, 0.0f),
+            ImVec2(
+                static_cast<float>(font_atlas.width) / FONT_ATLAS_LAYER_SIZE,
+                static_cast<float>(layer_height) / FONT_ATLAS_LAYER_SIZE));
         ImGui::TreePop();
       }
     }
@@ -747,7 +1178,19 @@ SDL_AppResult SDL_AppIterate(void* appstate) {
 
     ImDrawData* draw_data = ImGui::GetDrawData();
 
-    text_batch_prepare_draw_cmds(&as->text_batch, as->device, cmd_buf);
+    // Every upload of the frame goes through one copy pass, except for the ImGui backend's.
+    font_atlas_dynamic_update(
+        &as->font_atlases[FONT_ATLAS_KIND_ROBOTO_DYNAMIC],
+        &as->upload_scheduler);
+    text_batch_prepare_draw_cmds(&as->text_batch);
+    if (as->font_atlas_preview_layer >= 0) {
+      font_atlas_array_update_preview(
+          &as->font_atlas_array,
+          as->font_atlas_preview_layer,
+          &as->upload_scheduler);
+    }
+    upload_scheduler_flush(&as->upload_scheduler, cmd_buf);
+    text_batch_cull_draw_cmds(&as->text_batch, cmd_buf);
 
     ImGui_ImplSDLGPU3_PrepareDrawData(draw_data, cmd_buf);
 
@@ -760,13 +1203,21 @@ SDL_AppResult SDL_AppIterate(void* appstate) {
       SDL_GPURenderPass* render_pass = SDL_BeginGPURenderPass(cmd_buf, &target_info, 1, nullptr);
       defer(SDL_EndGPURenderPass(render_pass));
 
+      if (as->demo_kind == DEMO_KIND_TEXT_STATIC) {
+        text_static_render_basic(
+            as->text_static,
+            &as->text_batch,
+            cmd_buf,
+            render_pass,
+            as->demo_static.world_to_clip_transform);
+      }
       text_batch_render_draw_cmds(&as->text_batch, cmd_buf, render_pass);
 
       ImGui_ImplSDLGPU3_RenderDrawData(draw_data, cmd_buf, render_pass);
     }
   }
 
-  SDL_SubmitGPUCommandBuffer(cmd_buf);
+  upload_scheduler_submit(&as->upload_scheduler, cmd_buf);
 
   return SDL_APP_CONTINUE;
 }
@@ -776,10 +1227,11 @@ void SDL_AppQuit(void* appstate, SDL_AppResult result) {
 
   SDL_WaitForGPUIdle(as->device);
 
+  text_static_destroy(&as->text_static, as->device);
   text_batch_destroy(&as->text_batch, as->device);
-  for (int i = 0; i < FONT_ATLAS_KIND_COUNT; i++) {
-    font_atlas_destroy(&as->font_atlases[i], as->device);
-  }
+  font_atlas_dynamic_destroy(&as->font_atlases[FONT_ATLAS_KIND_ROBOTO_DYNAMIC], as->device);
+  font_atlas_array_destroy(&as->font_atlas_array, as->device);
+  upload_scheduler_destroy(&as->upload_scheduler);
 
   ImGui_ImplSDL3_Shutdown();
   ImGui_ImplSDLGPU3_Shutdown();
@@ -789,6 +1241,8 @@ void SDL_AppQuit(void* appstate, SDL_AppResult result) {
   SDL_DestroyWindow(as->window);
   SDL_DestroyGPUDevice(as->device);
 
+  thread_pool_destroy(&as->thread_pool);
+
   delete as;
 
   SDL_Quit();
@@ -0,0 +1,97 @@
+// Bottom-left skyline rectangle packer. The packed area is tracked as a list of horizontal
+// segments, each the top edge of the rectangles below it. Rectangles can't be freed one by one,
+// the whole packer is reset instead.
+
+struct Skyline_Packer_Node {
+  int x;
+  int y;
+  int width;
+};
+
+struct Skyline_Packer {
+  int                              width;
+  int                              height;
+  std::vector<Skyline_Packer_Node> nodes;
+};
+
+static void skyline_packer_reset(Skyline_Packer* packer, int width, int height) {
+  SDL_assert(packer != nullptr);
+  SDL_assert(width > 0 && height > 0);
+
+  packer->width  = width;
+  packer->height = height;
+  packer->nodes.clear();
+  packer->nodes.push_back({0, 0, width});
+}
+
+// Returns the lowest y at which a rectangle starting at node_index fits, or -1.
+static int
+skyline_packer_fit(const Skyline_Packer& packer, size_t node_index, int width, int height) {
+  const auto& node = packer.nodes[node_index];
+  if (node.x + width > packer.width) { return -1; }
+
+  int y         = node.y;
+  int remaining = width;
+  for (size_t i = node_index; remaining > 0; i++) {
+    SDL_assert(i < packer.nodes.size());
+    y = SDL_max(y, packer.nodes[i].y);
+    if (y + height > packer.height) { return -1; }
+    remaining -= packer.nodes[i].width;
+  }
+  return y;
+}
+
+// Places a width x height rectangle at the lowest position available, preferring the narrowest
+// segment on ties. Returns false when it doesn't fit.
+static bool
+skyline_packer_pack(Skyline_Packer* packer, int width, int height, SDL_Point* out_point) {
+  SDL_assert(packer != nullptr);
+  SDL_assert(out_point != nullptr);
+
+  size_t best_index = SIZE_MAX;
+  int    best_top   = SDL_MAX_SINT32;
+  int    best_width = SDL_MAX_SINT32;
+  int    best_y     = 0;
+  for (size_t i = 0; i < packer->nodes.size(); i++) {
+    int y = skyline_packer_fit(*packer, i, width, height);
+    if (y < 0) { continue; }
+
+    int top = y + height;
+    if (top < best_top || (top == best_top && packer->nodes[i].width < best_width)) {
+      best_index = i;
+      best_top   = top;
+      best_width = packer->nodes[i].width;
+      best_y     = y;
+    }
+  }
+  if (best_index == SIZE_MAX) { return false; }
+
+  int x = packer->nodes[best_index].x;
+  packer->nodes.insert(packer->nodes.begin() + best_index, {x, best_top, width});
+
+  // Trim or remove the segments now covered by the new one.
+  for (size_t i = best_index + 1; i < packer->nodes.size();) {
+    auto& node    = packer->nodes[i];
+    int   covered = x + width - node.x;
+    if (covered <= 0) { break; }
+    if (covered < node.width) {
+      node.x += covered;
+      node.width -= covered;
+      break;
+    }
+    packer->nodes.erase(packer->nodes.begin() + i);
+  }
+
+  // Merge neighbouring segments of the same height.
+  for (size_t i = 0; i + 1 < packer->nodes.size();) {
+    if (packer->nodes[i].y == packer->nodes[i + 1].y) {
+      packer->nodes[i].width += packer->nodes[i + 1].width;
+      packer->nodes.erase(packer->nodes.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+
+  *out_point = {x, best_y};
+  return true;
+}
@@ -1,8 +1,31 @@
-static constexpr int TEXT_BATCH_MAX_DRAW_CMDS              = 8;
-static constexpr int TEXT_BATCH_MAX_INSTANCES_PER_DRAW_CMD = 8192;
-static constexpr int TEXT_BATCH_MAX_INSTANCES =
-    TEXT_BATCH_MAX_DRAW_CMDS * TEXT_BATCH_MAX_INSTANCES_PER_DRAW_CMD;
-static constexpr int TEXT_BATCH_INDICES_PER_INSTANCE = 6;
+// The instance storage starts with room for TEXT_BATCH_MIN_CAPACITY instances and doubles whenever
+// a frame needs more. It is halved again once a frame has used at most a quarter of it for
+// TEXT_BATCH_SHRINK_FRAMES frames in a row, but never below the minimum.
+//
+// Instances are written straight into memory allocated from the upload scheduler's arena at the
+// first begin/end block of a frame, there is no CPU copy of them. A frame that outgrows it goes on
+// in a new chunk holding the rest of the doubled capacity, the instances written so far stay where
+// they are. Their upload is queued when the draw commands are prepared, one copy per chunk. Mapped
+// memory may be write-combined: instances are only ever written, never read back. Every one of the
+// scheduler's frames in flight has its own data buffer, guarded by the same fence as the arena.
+//
+// Only draw commands whose instances changed are uploaded. Each draw command hashes its instances
+// as they are emitted, and a data buffer remembers the hash of every range it holds from the last
+// time its frame came around. Draw commands matching the range at the same index keep drawing it
+// where it is, the others are appended after the ranges in use. Once the buffer is full, all
+// instances are uploaded again, packed from the start.
+static constexpr int      TEXT_BATCH_MIN_CAPACITY         = 16 * 1024;
+static constexpr int      TEXT_BATCH_SHRINK_FRAMES        = 600;
+static constexpr int      TEXT_BATCH_INDICES_PER_INSTANCE = 6;
+static constexpr uint64_t TEXT_BATCH_HASH_SEED            = 0xCBF29CE484222325ull;
+
+// With gpu_culling, compute passes cull the instances of every draw against its clip space
+// transform before the draw, in blocks of TEXT_BATCH_CULL_GROUP_SIZE instances, one per thread
+// group, and the draw is issued indirectly over the visible ones only. A frame with more than
+// TEXT_BATCH_CULL_MAX_BLOCKS blocks, the most a single dispatch dimension allows, isn't culled.
+static constexpr int TEXT_BATCH_CULL_GROUP_SIZE      = 256;
+static constexpr int TEXT_BATCH_CULL_SCAN_GROUP_SIZE = 64;
+static constexpr int TEXT_BATCH_CULL_MAX_BLOCKS      = 65535;
 
 enum Text_Batch_H_Align {
   TEXT_BATCH_H_ALIGN_LEFT,
@@ -19,69 +42,419 @@ enum Text_Batch_V_Align {
   TEXT_BATCH_V_ALIGN_COUNT,
 };
 
+// A glyph instance only holds what changes per glyph: the glyph bounds are looked up in the glyph
+// metrics table by glyph index. size is a half float and color is RGBA8. The z position is shared
+// by the whole draw command and passed as a uniform. 16 bytes, so the structured buffer stride is
+// the same with and without HLSL's constant buffer packing rules.
 struct Text_Batch_Instance {
-  HMM_Vec3 position;
-  float    size;
-  HMM_Vec4 color;
-  HMM_Vec4 plane_bounds;
-  HMM_Vec4 atlas_bounds;
+  HMM_Vec2 position;
+  uint16_t glyph;
+  uint16_t size;
+  uint32_t color;
+};
+static_assert(sizeof(Text_Batch_Instance) == 16);
+
+// Effects of text drawn with text_batch_begin_effects, as flags. Matches the EFFECT_ constants in
+// text_batch.hlsl. TEXT_BATCH_EFFECT_TRUE_DISTANCE isn't part of styles, it is set in the draw
+// parameters of text from MTSDF atlases.
+enum Text_Batch_Effect {
+  TEXT_BATCH_EFFECT_OUTLINE       = 1 << 0,
+  TEXT_BATCH_EFFECT_SHADOW        = 1 << 1,
+  TEXT_BATCH_EFFECT_GLOW          = 1 << 2,
+  TEXT_BATCH_EFFECT_BLUR          = 1 << 3,
+  TEXT_BATCH_EFFECT_TRUE_DISTANCE = 1 << 8,
 };
 
-struct Text_Batch_Draw_Cmd {
-  SDL_GPUGraphicsPipeline* pipeline;
-  HMM_Vec4                 outline_color;
-  float                    outline_thickness;
-  HMM_Mat4                 world_to_clip_transform;
-  const Font_Atlas*        font_atlas;
-  int                      font_variant;
-  int                      first_instance;
-  int                      instances_count;
+// Parameters of the effects of a draw command, those of the effects without their flag are
+// ignored. Thicknesses, the shadow offset, its softness and the blur radius are in distance ranges
+// of the font atlas: glyphs are only padded by half of one, so they are at most 0.4 for the outline
+// and 0.5 for the others.
+struct Text_Batch_Style {
+  uint32_t effects;
+  HMM_Vec4 outline_color;
+  float    outline_thickness;
+  HMM_Vec4 shadow_color;
+  HMM_Vec2 shadow_offset;
+  float    shadow_softness;
+  HMM_Vec4 glow_color;
+  float    glow_thickness;
+  float    blur_radius;
 };
 
-struct Text_Batch {
-  Text_Batch_Draw_Cmd      draw_cmds[TEXT_BATCH_MAX_DRAW_CMDS];
-  int                      draw_cmds_count;
-  Text_Batch_Instance      instances[TEXT_BATCH_MAX_INSTANCES];
-  int                      total_instances_count;
-  bool                     begin_called;
-  SDL_GPUBuffer*           data_buffer;
-  SDL_GPUTransferBuffer*   transfer_buffer;
-  SDL_GPUGraphicsPipeline* pipeline_basic;
-  SDL_GPUGraphicsPipeline* pipeline_outline;
-  SDL_GPUSampler*          sampler;
+// Distances read from a font atlas texel, 0.5 on the outline and a distance range across [0, 1]:
+// the median of the MSDF channels, and the distance effects reach away from the outline with, the
+// true distance of MTSDF atlases or the median again for MSDF ones.
+struct Text_Batch_Effect_Sample {
+  float median;
+  float distance;
 };
 
-struct Vertex_Uniform_Data {
-  HMM_Mat4 world_to_clip_transform;
-  uint32_t first_instance;
+static float text_batch_smoothstep(float edge0, float edge1, float x) {
+  float t = SDL_clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+static HMM_Vec4 text_batch_premultiply(HMM_Vec4 color, float opacity) {
+  float alpha = color.A * opacity;
+  return HMM_V4(color.R * alpha, color.G * alpha, color.B * alpha, alpha);
+}
+
+// Premultiplied colors, top drawn over bottom.
+static HMM_Vec4 text_batch_blend_over(HMM_Vec4 top, HMM_Vec4 bottom) {
+  return top + bottom * (1.0f - top.A);
+}
+
+// CPU reference of the uber fragment shader of text_batch.hlsl, step for step, to check effects
+// without a GPU. Returns the premultiplied color of a fragment of text in color, from the samples
+// at its texture coordinates and at those of its shadow. px_range is the screen pixels covered by a
+// distance range.
+//
+// The glyph is blurred by widening its edge by the blur radius, the shadow by widening it by the
+// softness. Both then use the true distance, which doesn't round off corners, like the glow.
+static HMM_Vec4 text_batch_effects_reference(
+    const Text_Batch_Style&  style,
+    HMM_Vec4                 color,
+    float                    px_range,
+    Text_Batch_Effect_Sample glyph,
+    Text_Batch_Effect_Sample shadow) {
+  bool  blur       = (style.effects & TEXT_BATCH_EFFECT_BLUR) != 0;
+  float sd         = blur ? glyph.distance : glyph.median;
+  float edge_scale = blur ? 1.0f / (style.blur_radius + 1.0f / px_range) : px_range;
+
+  HMM_Vec4 result;
+  if ((style.effects & TEXT_BATCH_EFFECT_OUTLINE) != 0) {
+    static constexpr float MID_BODY_THICKNESS = -0.1f;
+
+    float body_sd         = sd - 0.5f + MID_BODY_THICKNESS;
+    float char_sd         = body_sd + style.outline_thickness;
+    float body_opacity    = text_batch_smoothstep(-0.5f, 0.5f, edge_scale * body_sd);
+    float outline_opacity = text_batch_smoothstep(-0.5f, 0.5f, edge_scale * char_sd) - body_opacity;
+    if (sd <= 0.0001f) {
+      body_opacity    = 0.0f;
+      outline_opacity = 0.0f;
+    }
+
+    auto rgb = style.outline_color.XYZ + (color.XYZ - style.outline_color.XYZ) * body_opacity;
+    result.A = body_opacity * color.A + outline_opacity * style.outline_color.A;
+    result.R = rgb.R * result.A;
+    result.G = rgb.G * result.A;
+    result.B = rgb.B * result.A;
+  } else {
+    float opacity = SDL_clamp(edge_scale * (sd - 0.5f) + 0.5f, 0.0f, 1.0f);
+    result        = text_batch_premultiply(color, opacity);
+  }
+
+  if ((style.effects & TEXT_BATCH_EFFECT_SHADOW) != 0) {
+    float    width   = style.shadow_softness + 1.0f / px_range;
+    float    opacity = SDL_clamp((shadow.distance - 0.5f) / width + 0.5f, 0.0f, 1.0f);
+    HMM_Vec4 layer   = text_batch_premultiply(style.shadow_color, opacity);
+    result           = text_batch_blend_over(result, layer);
+  }
+
+  if ((style.effects & TEXT_BATCH_EFFECT_GLOW) != 0) {
+    float    thickness = SDL_max(style.glow_thickness, 1.0f / px_range);
+    float    opacity   = text_batch_smoothstep(0.5f - thickness, 0.5f, glyph.distance);
+    HMM_Vec4 layer     = text_batch_premultiply(style.glow_color, opacity);
+    result             = text_batch_blend_over(result, layer);
+  }
+
+  return result;
+}
+
+// Graphics pipelines of a Text_Batch, in the order sort_draw_cmds groups draw commands in.
+enum Text_Batch_Pipeline : uint8_t {
+  TEXT_BATCH_PIPELINE_BASIC,
+  TEXT_BATCH_PIPELINE_OUTLINE,
+  TEXT_BATCH_PIPELINE_UBER,
 };
 
-struct Fragment_Uniform_Data_Basic {
-  float    font_size;
-  HMM_Vec2 unit_range;
+// A draw command covers every begin/end block with the same pipeline, transform and effect
+// parameters, whatever their font atlas and variant: glyphs of all fonts are sampled from the same
+// font atlas array. font_atlas is the atlas of the first block, for the distance range uniforms,
+// blocks with an atlas of a different size, distance range or type start a new command, as does
+// text drawn at a different z position. order_independent is set by blocks whose text doesn't
+// overlap the text of other order independent blocks, sort_draw_cmds only reorders those.
+struct Text_Batch_Draw_Cmd {
+  Text_Batch_Pipeline pipeline;
+  bool                order_independent;
+  Text_Batch_Style    style;
+  HMM_Mat4            world_to_clip_transform;
+  float               position_z;
+  Font_Atlas*         font_atlas;
+  int                 first_instance;
+  int                 instances_count;
+  uint64_t            instances_hash;
+  int                 buffer_first_instance;
 };
 
-struct Fragment_Uniform_Data_Outline {
-  float    font_size;
-  HMM_Vec2 unit_range;
+// Parameters of a draw command as read by the vertex shader, from a storage buffer sorted by
+// first_instance for a Text_Batch or from the uniforms for a Text_Static. Matches Draw_Params in
+// text_batch.hlsl.
+struct Text_Batch_Draw_Params {
+  HMM_Mat4 world_to_clip_transform;
   HMM_Vec4 outline_color;
+  HMM_Vec4 shadow_color;
+  HMM_Vec4 glow_color;
+  uint32_t first_instance;
+  float    position_z;
+  float    unit_range;
   float    outline_thickness;
+  HMM_Vec2 shadow_offset;
+  float    shadow_softness;
+  float    glow_thickness;
+  uint32_t effects;
+  float    blur_radius;
+  uint32_t padding[2];
+};
+static_assert(sizeof(Text_Batch_Draw_Params) == 160);
+
+// A draw of text_batch_render_draw_cmds, covering every draw command with the same pipeline whose
+// instances follow the previous one's in the data buffer. The pipeline is bound only when it
+// differs from the previous draw's.
+struct Text_Batch_Draw {
+  Text_Batch_Pipeline pipeline;
+  int                 first_instance;
+  int                 instances_count;
+  bool                bind_pipeline;
 };
 
-static bool text_batch_create(
-    Text_Batch*          text_batch,
-    const std::string&   base_path,
-    SDL_GPUDevice*       device,
-    SDL_GPUTextureFormat swapchain_texture_format) {
+// A draw as culled on the GPU, its blocks are first_block onwards in the cull blocks buffer, which
+// holds the index of the draw of each block. Matches Cull_Draw in text_batch.hlsl.
+struct Text_Batch_Cull_Draw {
+  uint32_t first_instance;
+  uint32_t instances_count;
+  uint32_t first_block;
+  uint32_t blocks_count;
+};
+
+// Instances of a draw command as held by a data buffer.
+struct Text_Batch_Range {
+  uint64_t hash;
+  int      first_instance;
+  int      instances_count;
+};
+
+// Instances of the current frame from first_instance on, up to the first instance of the next
+// chunk, in an allocation from the upload scheduler's arena with room for capacity instances.
+struct Text_Batch_Chunk {
+  Upload_Allocation allocation;
+  int               first_instance;
+  int               capacity;
+};
+
+// Data buffer of a frame in flight. capacity lags behind the one of the text batch until the frame
+// comes around again. ranges are those of the draw commands last rendered from the buffer,
+// instances_end the end of the furthest of them. The draw parameters of the frame are uploaded
+// whole into draw_params_buffer, and with gpu_culling so are the cull draws and blocks.
+// cull_readback_buffer receives the indirect draw arguments written by the culling, read back when
+// the frame comes around again: cull_readback_draws_count draws over cull_readback_tested_count
+// instances, none if the frame wasn't culled.
+struct Text_Batch_Frame {
+  SDL_GPUBuffer*                data_buffer;
+  int                           capacity;
+  std::vector<Text_Batch_Range> ranges;
+  int                           instances_end;
+  SDL_GPUBuffer*                draw_params_buffer;
+  int                           draw_params_capacity;
+  SDL_GPUBuffer*                cull_draws_buffer;
+  int                           cull_draws_capacity;
+  SDL_GPUBuffer*                cull_blocks_buffer;
+  int                           cull_blocks_capacity;
+  SDL_GPUTransferBuffer*        cull_readback_buffer;
+  int                           cull_readback_capacity;
+  int                           cull_readback_draws_count;
+  int                           cull_readback_tested_count;
+};
+
+// uploaded_bytes and reused_bytes are of the last frame, reused_bytes are instances left in place
+// in the data buffer instead of being uploaded again. The draw counts are of the last frame too,
+// draw_cmds_count only counts draw commands with instances. The culling counts are of the latest
+// culled frame whose results could be read back, UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT frames ago.
+struct Text_Batch_Stats {
+  uint64_t grow_count;
+  uint64_t shrink_count;
+  uint64_t repack_count;
+  int      peak_instances_count;
+  uint32_t uploaded_bytes;
+  uint32_t reused_bytes;
+  int      draw_cmds_count;
+  int      draws_count;
+  int      pipeline_binds_count;
+  int      uniform_pushes_count;
+  int      cull_tested_count;
+  int      cull_visible_count;
+};
+
+// Layouts of text drawn with a baked atlas are cached by text, font atlas, variant, size, alignment
+// and text block size, as the glyphs positioned relative to where the text is drawn, so a hit only
+// translates them into instances. The least recently drawn layouts are dropped once the cache holds
+// more than budget_bytes. Layouts of dynamic atlases aren't cached: every draw requests their
+// glyphs, stamps them as used and skips those that aren't resident.
+static constexpr size_t TEXT_LAYOUT_CACHE_BUDGET = 4 * 1024 * 1024;
+
+// Glyphs laid out relative to the position their text is drawn at, as a structure of arrays with
+// glyph the index of each in the glyph metrics table.
+struct Text_Layout_Glyphs {
+  std::vector<float>    x;
+  std::vector<float>    y;
+  std::vector<uint16_t> glyph;
+};
+
+// trailing_advance is the advance after the last glyph of the line, in ems.
+struct Text_Layout_Line {
+  int   glyphs_end;
+  float trailing_advance;
+  float y;
+  float width;
+};
+
+// Glyphs first to first + count of a layout, emitted together.
+struct Text_Layout_Run {
+  int first;
+  int count;
+};
+
+// Scratch space of text_layout, reused from one draw to the next. runs are those of the glyphs of
+// a clipped draw that are emitted.
+struct Text_Layout_Scratch {
+  Text_Layout_Glyphs            glyphs;
+  std::vector<Text_Layout_Line> lines;
+  std::vector<Text_Layout_Run>  runs;
+};
+
+// Everything but the text that a layout depends on. text_block_size only applies to multiline text,
+// (-1, -1) sizes the block to fit the text.
+struct Text_Layout_Params {
+  Font_Atlas*        font_atlas;
+  int                font_variant;
+  float              size;
+  Text_Batch_H_Align h_align;
+  Text_Batch_V_Align v_align;
+  HMM_Vec2           text_block_size;
+  bool               multiline;
+};
+
+struct Text_Layout_Entry {
+  uint64_t           hash;
+  std::string        text;
+  Text_Layout_Params params;
+  Text_Layout_Glyphs glyphs;
+  size_t             bytes;
+};
+
+struct Text_Layout_Cache_Stats {
+  uint64_t hits_count;
+  uint64_t misses_count;
+  uint64_t evictions_count;
+};
+
+// entries are ordered from the most to the least recently drawn.
+struct Text_Layout_Cache {
+  bool                                                                 enabled;
+  size_t                                                               budget_bytes;
+  size_t                                                               bytes;
+  std::list<Text_Layout_Entry>                                         entries;
+  std::unordered_map<uint64_t, std::list<Text_Layout_Entry>::iterator> index;
+  Text_Layout_Cache_Stats                                              stats;
+};
+
+// With sort_draw_cmds, order independent draw commands are rendered grouped by pipeline instead of
+// in the order they were recorded, the others keep their place. With
+// uber_effects, basic and outline text is also drawn with the uber pipeline, which reads the
+// effects of each draw command from its draw parameters: text of any effects then shares one
+// pipeline and one draw, at the cost of a heavier fragment shader for plain text. With
+// gpu_culling, only the instances inside the clip volume of their draw command reach the vertex
+// shader, see text_batch_cull_draw_cmds. The buffers only written by the GPU, visible_buffer,
+// block_offsets_buffer and indirect_buffer, are cycled by the culling pass that writes them first
+// in a frame, so a frame never overwrites them while a frame still in flight reads them.
+struct Text_Batch {
+  std::vector<Text_Batch_Draw_Cmd>    draw_cmds;
+  std::vector<int>                    draw_cmds_order;
+  std::vector<Text_Batch_Draw>        draws;
+  std::vector<Text_Batch_Draw_Params> draw_params;
+  std::vector<Text_Batch_Cull_Draw>   cull_draws;
+  std::vector<uint32_t>               cull_blocks;
+  bool                                sort_draw_cmds;
+  bool                                uber_effects;
+  bool                                gpu_culling;
+  bool                                cull_uploaded;
+  bool                                draws_culled;
+  std::vector<Text_Batch_Chunk>       instances_chunks;
+  int                                 instances_count;
+  bool                                begin_called;
+  Font_Atlas*                         font_atlas;
+  int                                 font_variant;
+  Upload_Scheduler*                   upload_scheduler;
+  uint64_t                            instances_frame_number;
+  Text_Batch_Frame                    frames[UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT];
+  int                                 capacity;
+  int                                 low_use_frames_count;
+  Text_Batch_Stats                    stats;
+  Text_Layout_Scratch                 layout_scratch;
+  Text_Layout_Cache                   layout_cache;
+  SDL_GPUGraphicsPipeline*            pipeline_basic;
+  SDL_GPUGraphicsPipeline*            pipeline_outline;
+  SDL_GPUGraphicsPipeline*            pipeline_uber;
+  SDL_GPUComputePipeline*             pipeline_cull_count;
+  SDL_GPUComputePipeline*             pipeline_cull_scan;
+  SDL_GPUComputePipeline*             pipeline_cull_compact;
+  SDL_GPUBuffer*                      visible_buffer;
+  int                                 visible_capacity;
+  SDL_GPUBuffer*                      block_offsets_buffer;
+  int                                 block_offsets_capacity;
+  SDL_GPUBuffer*                      indirect_buffer;
+  int                                 indirect_capacity;
+  SDL_GPUSampler*                     sampler;
+  SDL_GPUTexture*                     font_atlas_texture;
+  SDL_GPUBuffer*                      glyph_metrics_buffer;
+  SDL_GPUDevice*                      device;
+};
+
+// With draw_params_count, params is ignored and the parameters of each instance are looked up in
+// the draw parameters buffer. With culled, vertices are of the instances in the visible buffer.
+struct Vertex_Uniform_Data {
+  Text_Batch_Draw_Params params;
+  uint32_t               draw_params_count;
+  uint32_t               culled;
+};
+
+struct Cull_Uniform_Data {
+  uint32_t draw_params_count;
+  uint32_t draws_count;
+  uint32_t blocks_count;
+  uint32_t padding;
+};
+
+// Folds an instance into the hash of a draw command's instances. Hashed from the values written
+// rather than read back from the mapped memory, which may be write-combined.
+static uint64_t text_batch_hash_instance(uint64_t hash, const Text_Batch_Instance& instance) {
+  uint64_t words[2];
+  SDL_memcpy(words, &instance, sizeof(instance));
+  for (auto word : words) {
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+// Replaces the data buffer of the current frame with one holding capacity instances, keeping the
+// current one if that fails. Buffers still in use by submitted command buffers are only destroyed
+// by SDL once these complete.
+static bool text_batch_resize_data_buffer(Text_Batch* text_batch, int capacity) {
   SDL_assert(text_batch != nullptr);
-  SDL_assert(device != nullptr);
+  SDL_assert(capacity >= text_batch->instances_count && capacity > 0);
 
+  auto  device = text_batch->device;
+  auto& frame  = text_batch->frames[text_batch->upload_scheduler->frame_index];
+
+  SDL_GPUBuffer* data_buffer;
   {
     SDL_GPUBufferCreateInfo info = {};
-    info.size                    = sizeof(Text_Batch_Instance) * TEXT_BATCH_MAX_INSTANCES;
-    info.usage                   = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
-    text_batch->data_buffer      = SDL_CreateGPUBuffer(device, &info);
-    if (text_batch->data_buffer == nullptr) {
+    info.size                    = sizeof(Text_Batch_Instance) * capacity;
+    info.usage =
+        SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ;
+    data_buffer                  = SDL_CreateGPUBuffer(device, &info);
+    if (data_buffer == nullptr) {
       SDL_LogError(
           SDL_LOG_CATEGORY_APPLICATION,
           "Failed to create data buffer: %s",
@@ -90,20 +463,203 @@ static bool text_batch_create(
     }
   }
 
-  {
-    SDL_GPUTransferBufferCreateInfo info = {};
-    info.size                            = sizeof(Text_Batch_Instance) * TEXT_BATCH_MAX_INSTANCES;
-    info.usage                           = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    text_batch->transfer_buffer          = SDL_CreateGPUTransferBuffer(device, &info);
-    if (text_batch->data_buffer == nullptr) {
+  SDL_ReleaseGPUBuffer(device, frame.data_buffer);
+  frame.data_buffer   = data_buffer;
+  frame.capacity      = capacity;
+  frame.instances_end = 0;
+  frame.ranges.clear();
+
+  return true;
+}
+
+// Replaces the draw parameters buffer of the current frame with one holding at least count draw
+// parameters, keeping the current one if that fails.
+static bool text_batch_resize_draw_params_buffer(Text_Batch* text_batch, int count) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(count > 0);
+
+  auto  device   = text_batch->device;
+  auto& frame    = text_batch->frames[text_batch->upload_scheduler->frame_index];
+  int   capacity = SDL_max(frame.draw_params_capacity, 64);
+  while (capacity < count) { capacity *= 2; }
+
+  SDL_GPUBufferCreateInfo info = {};
+  info.size                    = sizeof(Text_Batch_Draw_Params) * capacity;
+  info.usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ;
+  auto draw_params_buffer      = SDL_CreateGPUBuffer(device, &info);
+  if (draw_params_buffer == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to create draw params buffer: %s",
+        SDL_GetError());
+    return false;
+  }
+
+  SDL_ReleaseGPUBuffer(device, frame.draw_params_buffer);
+  frame.draw_params_buffer   = draw_params_buffer;
+  frame.draw_params_capacity = capacity;
+
+  return true;
+}
+
+// Replaces *buffer with one holding at least count elements of stride bytes, doubling its capacity
+// from 64 elements, unless it is already large enough. Keeps the current one if that fails.
+static bool text_batch_reserve_buffer(
+    SDL_GPUDevice*          device,
+    SDL_GPUBuffer**         buffer,
+    int*                    capacity,
+    int                     count,
+    uint32_t                stride,
+    SDL_GPUBufferUsageFlags usage,
+    const char*             name) {
+  SDL_assert(buffer != nullptr);
+  SDL_assert(capacity != nullptr);
+  SDL_assert(count > 0);
+
+  if (*buffer != nullptr && *capacity >= count) { return true; }
+  int new_capacity = SDL_max(*capacity, 64);
+  while (new_capacity < count) { new_capacity *= 2; }
+
+  SDL_GPUBufferCreateInfo info = {};
+  info.size                    = stride * new_capacity;
+  info.usage                   = usage;
+  auto new_buffer              = SDL_CreateGPUBuffer(device, &info);
+  if (new_buffer == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to create %s buffer: %s",
+        name,
+        SDL_GetError());
+    return false;
+  }
+
+  SDL_ReleaseGPUBuffer(device, *buffer);
+  *buffer   = new_buffer;
+  *capacity = new_capacity;
+
+  return true;
+}
+
+// Makes room for culling the current frame's draws: its cull tables and readback buffer, and the
+// buffers the culling writes, with a visible buffer as large as the frame's data buffer.
+static bool text_batch_reserve_cull_buffers(Text_Batch* text_batch) {
+  SDL_assert(text_batch != nullptr);
+
+  auto  device       = text_batch->device;
+  auto& frame        = text_batch->frames[text_batch->upload_scheduler->frame_index];
+  int   draws_count  = static_cast<int>(text_batch->cull_draws.size());
+  int   blocks_count = static_cast<int>(text_batch->cull_blocks.size());
+  if (!text_batch_reserve_buffer(
+          device,
+          &frame.cull_draws_buffer,
+          &frame.cull_draws_capacity,
+          draws_count,
+          sizeof(Text_Batch_Cull_Draw),
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+          "cull draws") ||
+      !text_batch_reserve_buffer(
+          device,
+          &frame.cull_blocks_buffer,
+          &frame.cull_blocks_capacity,
+          blocks_count,
+          sizeof(uint32_t),
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+          "cull blocks") ||
+      !text_batch_reserve_buffer(
+          device,
+          &text_batch->block_offsets_buffer,
+          &text_batch->block_offsets_capacity,
+          blocks_count,
+          sizeof(uint32_t),
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+          "block offsets") ||
+      !text_batch_reserve_buffer(
+          device,
+          &text_batch->indirect_buffer,
+          &text_batch->indirect_capacity,
+          draws_count,
+          sizeof(SDL_GPUIndirectDrawCommand),
+          SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+          "indirect") ||
+      !text_batch_reserve_buffer(
+          device,
+          &text_batch->visible_buffer,
+          &text_batch->visible_capacity,
+          frame.capacity,
+          sizeof(uint32_t),
+          SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+          "visible")) {
+    return false;
+  }
+
+  if (frame.cull_readback_buffer == nullptr || frame.cull_readback_capacity < draws_count) {
+    int                             capacity = frame.cull_draws_capacity;
+    SDL_GPUTransferBufferCreateInfo info     = {};
+    info.usage                               = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+    info.size                                = sizeof(SDL_GPUIndirectDrawCommand) * capacity;
+    auto readback_buffer = SDL_CreateGPUTransferBuffer(device, &info);
+    if (readback_buffer == nullptr) {
       SDL_LogError(
           SDL_LOG_CATEGORY_APPLICATION,
           "Failed to create transfer buffer: %s",
           SDL_GetError());
       return false;
     }
+    SDL_ReleaseGPUTransferBuffer(device, frame.cull_readback_buffer);
+    frame.cull_readback_buffer      = readback_buffer;
+    frame.cull_readback_capacity    = capacity;
+    frame.cull_readback_draws_count = 0;
   }
 
+  return true;
+}
+
+// Allocates a chunk from the upload scheduler's arena for the instances from the current count up
+// to capacity. The instances of the frame so far stay in the previous chunks, which are never read
+// back.
+static bool text_batch_allocate_instances(Text_Batch* text_batch, int capacity) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(capacity > text_batch->instances_count);
+
+  auto              chunk_capacity = capacity - text_batch->instances_count;
+  Upload_Allocation allocation;
+  if (!upload_scheduler_allocate(
+          text_batch->upload_scheduler,
+          UPLOAD_CLIENT_TEXT_BATCH,
+          sizeof(Text_Batch_Instance) * chunk_capacity,
+          &allocation)) {
+    return false;
+  }
+
+  text_batch->instances_chunks.push_back({allocation, text_batch->instances_count, chunk_capacity});
+  text_batch->instances_frame_number = text_batch->upload_scheduler->frame_number;
+  text_batch->capacity               = capacity;
+
+  return true;
+}
+
+static bool text_batch_create(
+    Text_Batch*             text_batch,
+    const std::string&      base_path,
+    const Font_Atlas_Array& font_atlas_array,
+    Upload_Scheduler*       upload_scheduler,
+    SDL_GPUDevice*          device,
+    SDL_GPUTextureFormat    swapchain_texture_format) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(font_atlas_array.texture != nullptr);
+  SDL_assert(font_atlas_array.glyph_metrics_buffer != nullptr);
+  SDL_assert(upload_scheduler != nullptr);
+  SDL_assert(device != nullptr);
+
+  text_batch->font_atlas_texture   = font_atlas_array.texture;
+  text_batch->glyph_metrics_buffer = font_atlas_array.glyph_metrics_buffer;
+  text_batch->upload_scheduler     = upload_scheduler;
+  text_batch->device               = device;
+  text_batch->capacity             = TEXT_BATCH_MIN_CAPACITY;
+
+  text_batch->layout_cache.enabled      = true;
+  text_batch->layout_cache.budget_bytes = TEXT_LAYOUT_CACHE_BUDGET;
+
   {
     auto                shader_formats = SDL_GetGPUShaderFormats(device);
     const char*         file_ext;
@@ -139,7 +695,7 @@ static bool text_batch_create(
       info.code_size               = file_contents.size();
       info.entrypoint              = "main";
       info.format                  = format;
-      info.num_storage_buffers     = 1;
+      info.num_storage_buffers     = 4;
       info.num_uniform_buffers     = 1;
       info.stage                   = SDL_GPU_SHADERSTAGE_VERTEX;
       vertex_shader                = SDL_CreateGPUShader(device, &info);
@@ -171,7 +727,6 @@ static bool text_batch_create(
       info.entrypoint              = "main";
       info.format                  = format;
       info.num_samplers            = 1;
-      info.num_uniform_buffers     = 1;
       info.stage                   = SDL_GPU_SHADERSTAGE_FRAGMENT;
       fragment_shader_basic        = SDL_CreateGPUShader(device, &info);
       if (fragment_shader_basic == nullptr) {
@@ -202,7 +757,6 @@ static bool text_batch_create(
       info.entrypoint              = "main";
       info.format                  = format;
       info.num_samplers            = 1;
-      info.num_uniform_buffers     = 1;
       info.stage                   = SDL_GPU_SHADERSTAGE_FRAGMENT;
       fragment_shader_outline      = SDL_CreateGPUShader(device, &info);
       if (fragment_shader_outline == nullptr) {
@@ -215,6 +769,36 @@ static bool text_batch_create(
     }
     defer(SDL_ReleaseGPUShader(device, fragment_shader_outline));
 
+    SDL_GPUShader* fragment_shader_uber;
+    {
+      auto                 file_path = base_path + "/text_batch_uber.frag." + file_ext;
+      std::vector<uint8_t> file_contents;
+      if (!read_file_contents(file_path.c_str(), &file_contents)) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_APPLICATION,
+            "Failed to read file contents: %s",
+            file_path.c_str());
+        return false;
+      }
+
+      SDL_GPUShaderCreateInfo info = {};
+      info.code                    = file_contents.data();
+      info.code_size               = file_contents.size();
+      info.entrypoint              = "main";
+      info.format                  = format;
+      info.num_samplers            = 1;
+      info.stage                   = SDL_GPU_SHADERSTAGE_FRAGMENT;
+      fragment_shader_uber         = SDL_CreateGPUShader(device, &info);
+      if (fragment_shader_uber == nullptr) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_APPLICATION,
+            "Failed to create uber fragment shader: %s",
+            SDL_GetError());
+        return false;
+      }
+    }
+    defer(SDL_ReleaseGPUShader(device, fragment_shader_uber));
+
     SDL_GPUColorTargetDescription desc     = {};
     desc.format                            = swapchain_texture_format;
     desc.blend_state.enable_blend          = true;
@@ -249,6 +833,63 @@ static bool text_batch_create(
           SDL_GetError());
       return false;
     }
+
+    info.fragment_shader      = fragment_shader_uber;
+    text_batch->pipeline_uber = SDL_CreateGPUGraphicsPipeline(device, &info);
+    if (text_batch->pipeline_uber == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to create uber pipeline: %s",
+          SDL_GetError());
+      return false;
+    }
+
+    // The culling kernels share a uniform block, the draw parameters count and the number of draws
+    // and blocks culled.
+    auto create_cull_pipeline = [&](const char* name,
+                                    uint32_t    num_readonly_storage_buffers,
+                                    uint32_t    num_readwrite_storage_buffers,
+                                    uint32_t    threadcount) -> SDL_GPUComputePipeline* {
+      auto                 file_path = base_path + "/text_batch_" + name + ".comp." + file_ext;
+      std::vector<uint8_t> file_contents;
+      if (!read_file_contents(file_path.c_str(), &file_contents)) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_APPLICATION,
+            "Failed to read file contents: %s",
+            file_path.c_str());
+        return nullptr;
+      }
+
+      SDL_GPUComputePipelineCreateInfo info = {};
+      info.code                             = file_contents.data();
+      info.code_size                        = file_contents.size();
+      info.entrypoint                       = "main";
+      info.format                           = format;
+      info.num_readonly_storage_buffers     = num_readonly_storage_buffers;
+      info.num_readwrite_storage_buffers    = num_readwrite_storage_buffers;
+      info.num_uniform_buffers              = 1;
+      info.threadcount_x                    = threadcount;
+      info.threadcount_y                    = 1;
+      info.threadcount_z                    = 1;
+      auto pipeline                         = SDL_CreateGPUComputePipeline(device, &info);
+      if (pipeline == nullptr) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_APPLICATION,
+            "Failed to create %s pipeline: %s",
+            name,
+            SDL_GetError());
+      }
+      return pipeline;
+    };
+    text_batch->pipeline_cull_count =
+        create_cull_pipeline("cull_count", 5, 1, TEXT_BATCH_CULL_GROUP_SIZE);
+    if (text_batch->pipeline_cull_count == nullptr) { return false; }
+    text_batch->pipeline_cull_scan =
+        create_cull_pipeline("cull_scan", 1, 2, TEXT_BATCH_CULL_SCAN_GROUP_SIZE);
+    if (text_batch->pipeline_cull_scan == nullptr) { return false; }
+    text_batch->pipeline_cull_compact =
+        create_cull_pipeline("cull_compact", 6, 1, TEXT_BATCH_CULL_GROUP_SIZE);
+    if (text_batch->pipeline_cull_compact == nullptr) { return false; }
   }
 
   {
@@ -275,77 +916,246 @@ static void text_batch_destroy(Text_Batch* text_batch, SDL_GPUDevice* device) {
 
   SDL_ReleaseGPUGraphicsPipeline(device, text_batch->pipeline_basic);
   SDL_ReleaseGPUGraphicsPipeline(device, text_batch->pipeline_outline);
-  SDL_ReleaseGPUTransferBuffer(device, text_batch->transfer_buffer);
-  SDL_ReleaseGPUBuffer(device, text_batch->data_buffer);
+  SDL_ReleaseGPUGraphicsPipeline(device, text_batch->pipeline_uber);
+  SDL_ReleaseGPUComputePipeline(device, text_batch->pipeline_cull_count);
+  SDL_ReleaseGPUComputePipeline(device, text_batch->pipeline_cull_scan);
+  SDL_ReleaseGPUComputePipeline(device, text_batch->pipeline_cull_compact);
+  SDL_ReleaseGPUBuffer(device, text_batch->visible_buffer);
+  SDL_ReleaseGPUBuffer(device, text_batch->block_offsets_buffer);
+  SDL_ReleaseGPUBuffer(device, text_batch->indirect_buffer);
+  text_batch->visible_buffer       = nullptr;
+  text_batch->block_offsets_buffer = nullptr;
+  text_batch->indirect_buffer      = nullptr;
+  text_batch->instances_chunks.clear();
+  for (auto& frame : text_batch->frames) {
+    SDL_ReleaseGPUBuffer(device, frame.data_buffer);
+    SDL_ReleaseGPUBuffer(device, frame.draw_params_buffer);
+    SDL_ReleaseGPUBuffer(device, frame.cull_draws_buffer);
+    SDL_ReleaseGPUBuffer(device, frame.cull_blocks_buffer);
+    SDL_ReleaseGPUTransferBuffer(device, frame.cull_readback_buffer);
+    frame = {};
+  }
+  text_batch->layout_cache = {};
+}
+
+static bool text_batch_style_equal(const Text_Batch_Style& a, const Text_Batch_Style& b) {
+  return a.effects == b.effects && a.outline_color == b.outline_color &&
+         a.outline_thickness == b.outline_thickness && a.shadow_color == b.shadow_color &&
+         a.shadow_offset == b.shadow_offset && a.shadow_softness == b.shadow_softness &&
+         a.glow_color == b.glow_color && a.glow_thickness == b.glow_thickness &&
+         a.blur_radius == b.blur_radius;
+}
+
+static bool text_batch_style_is_valid(const Text_Batch_Style& style) {
+  return style.outline_thickness >= 0.0f && style.outline_thickness <= 0.4f &&
+         SDL_fabsf(style.shadow_offset.X) <= 0.5f && SDL_fabsf(style.shadow_offset.Y) <= 0.5f &&
+         style.shadow_softness >= 0.0f && style.shadow_softness <= 0.5f &&
+         style.glow_thickness >= 0.0f && style.glow_thickness <= 0.5f &&
+         style.blur_radius >= 0.0f && style.blur_radius <= 0.5f &&
+         (style.effects & TEXT_BATCH_EFFECT_TRUE_DISTANCE) == 0;
+}
+
+static SDL_GPUGraphicsPipeline*
+text_batch_graphics_pipeline(const Text_Batch& text_batch, Text_Batch_Pipeline pipeline) {
+  switch (pipeline) {
+  case TEXT_BATCH_PIPELINE_BASIC:
+    return text_batch.pipeline_basic;
+  case TEXT_BATCH_PIPELINE_OUTLINE:
+    return text_batch.pipeline_outline;
+  case TEXT_BATCH_PIPELINE_UBER:
+  default:
+    return text_batch.pipeline_uber;
+  }
 }
 
 static Text_Batch_Draw_Cmd* text_batch_push_draw_cmd(
-    Text_Batch*              text_batch,
-    SDL_GPUGraphicsPipeline* pipeline,
-    const HMM_Mat4&          world_to_clip_transform,
-    const Font_Atlas*        font_atlas,
-    int                      font_variant) {
-  SDL_assert(text_batch->draw_cmds_count < TEXT_BATCH_MAX_DRAW_CMDS);
-
-  auto draw_cmd                     = &text_batch->draw_cmds[text_batch->draw_cmds_count];
+    Text_Batch*             text_batch,
+    Text_Batch_Pipeline     pipeline,
+    bool                    order_independent,
+    const HMM_Mat4&         world_to_clip_transform,
+    Font_Atlas*             font_atlas,
+    const Text_Batch_Style& style) {
+  auto draw_cmd                     = &text_batch->draw_cmds.emplace_back();
   draw_cmd->pipeline                = pipeline;
+  draw_cmd->order_independent       = order_independent;
+  draw_cmd->style                   = style;
   draw_cmd->world_to_clip_transform = world_to_clip_transform;
+  draw_cmd->position_z              = 0.0f;
   draw_cmd->font_atlas              = font_atlas;
-  draw_cmd->font_variant            = font_variant;
-  draw_cmd->first_instance  = text_batch->draw_cmds_count * TEXT_BATCH_MAX_INSTANCES_PER_DRAW_CMD;
-  draw_cmd->instances_count = 0;
-
-  text_batch->draw_cmds_count += 1;
+  draw_cmd->first_instance          = text_batch->instances_count;
+  draw_cmd->instances_count         = 0;
+  draw_cmd->instances_hash          = TEXT_BATCH_HASH_SEED;
+  draw_cmd->buffer_first_instance   = draw_cmd->first_instance;
 
   return draw_cmd;
 }
 
-static void text_batch_begin_basic(
-    Text_Batch*       text_batch,
-    const HMM_Mat4&   world_to_clip_transform,
-    const Font_Atlas* font_atlas,
-    int               font_variant) {
+// Starts a begin/end block, continuing the last draw command when its state matches. A last draw
+// command left without instances is dropped first, so blocks that drew nothing don't keep the
+// blocks around them apart.
+static void text_batch_begin(
+    Text_Batch*             text_batch,
+    Text_Batch_Pipeline     pipeline,
+    bool                    order_independent,
+    const HMM_Mat4&         world_to_clip_transform,
+    Font_Atlas*             font_atlas,
+    int                     font_variant,
+    const Text_Batch_Style& style) {
   SDL_assert(text_batch != nullptr);
   SDL_assert(font_atlas != nullptr);
   SDL_assert(font_variant >= 0 && font_variant < font_atlas->variants.size());
   SDL_assert(!text_batch->begin_called);
-  SDL_assert(text_batch->draw_cmds_count < TEXT_BATCH_MAX_DRAW_CMDS);
 
   text_batch->begin_called = true;
+  text_batch->font_atlas   = font_atlas;
+  text_batch->font_variant = font_variant;
+
+  // The instances of the last frame were unmapped when the upload scheduler was flushed.
+  if (text_batch->instances_frame_number != text_batch->upload_scheduler->frame_number) {
+    text_batch->instances_chunks.clear();
+  }
+  if (text_batch->instances_chunks.empty()) {
+    text_batch_allocate_instances(text_batch, text_batch->capacity);
+  }
+
+  if (!text_batch->draw_cmds.empty() && text_batch->draw_cmds.back().instances_count == 0) {
+    text_batch->draw_cmds.pop_back();
+  }
+  if (!text_batch->draw_cmds.empty()) {
+    const auto& draw_cmd = text_batch->draw_cmds.back();
+    if (draw_cmd.pipeline == pipeline && draw_cmd.order_independent == order_independent &&
+        SDL_memcmp(
+            &draw_cmd.world_to_clip_transform,
+            &world_to_clip_transform,
+            sizeof(HMM_Mat4)) == 0 &&
+        text_batch_style_equal(draw_cmd.style, style) &&
+        draw_cmd.font_atlas->size == font_atlas->size &&
+        draw_cmd.font_atlas->distance_range == font_atlas->distance_range &&
+        draw_cmd.font_atlas->type == font_atlas->type) {
+      return;
+    }
+  }
 
   text_batch_push_draw_cmd(
       text_batch,
-      text_batch->pipeline_basic,
+      pipeline,
+      order_independent,
       world_to_clip_transform,
       font_atlas,
-      font_variant);
+      style);
+}
+
+// Starts a begin/end block of plain text. With order_independent, the caller guarantees that its
+// text doesn't overlap the text of other order independent blocks of the frame, which
+// sort_draw_cmds may then draw before or after it.
+static void text_batch_begin_basic(
+    Text_Batch*     text_batch,
+    const HMM_Mat4& world_to_clip_transform,
+    Font_Atlas*     font_atlas,
+    int             font_variant,
+    bool            order_independent = false) {
+  SDL_assert(text_batch != nullptr);
+
+  text_batch_begin(
+      text_batch,
+      text_batch->uber_effects ? TEXT_BATCH_PIPELINE_UBER : TEXT_BATCH_PIPELINE_BASIC,
+      order_independent,
+      world_to_clip_transform,
+      font_atlas,
+      font_variant,
+      {});
 }
 
 static void text_batch_begin_outline(
-    Text_Batch*       text_batch,
-    const HMM_Mat4&   world_to_clip_transform,
-    const Font_Atlas* font_atlas,
-    int               font_variant,
-    HMM_Vec4          outline_color     = HMM_V4(0.0f, 0.0f, 0.0f, 1.0f),
-    float             outline_thickness = 0.4f) {
+    Text_Batch*     text_batch,
+    const HMM_Mat4& world_to_clip_transform,
+    Font_Atlas*     font_atlas,
+    int             font_variant,
+    HMM_Vec4        outline_color     = HMM_V4(0.0f, 0.0f, 0.0f, 1.0f),
+    float           outline_thickness = 0.4f,
+    bool            order_independent = false) {
   SDL_assert(text_batch != nullptr);
-  SDL_assert(font_atlas != nullptr);
-  SDL_assert(font_variant >= 0 && font_variant < font_atlas->variants.size());
-  SDL_assert(!text_batch->begin_called);
-  SDL_assert(text_batch->draw_cmds_count < TEXT_BATCH_MAX_DRAW_CMDS);
   SDL_assert(outline_thickness >= 0.0f && outline_thickness <= 0.4f);
 
-  text_batch->begin_called = true;
+  Text_Batch_Style style  = {};
+  style.effects           = TEXT_BATCH_EFFECT_OUTLINE;
+  style.outline_color     = outline_color;
+  style.outline_thickness = outline_thickness;
+  text_batch_begin(
+      text_batch,
+      text_batch->uber_effects ? TEXT_BATCH_PIPELINE_UBER : TEXT_BATCH_PIPELINE_OUTLINE,
+      order_independent,
+      world_to_clip_transform,
+      font_atlas,
+      font_variant,
+      style);
+}
+
+// Starts a begin/end block of text with any combination of effects, always drawn with the uber
+// pipeline.
+static void text_batch_begin_effects(
+    Text_Batch*             text_batch,
+    const HMM_Mat4&         world_to_clip_transform,
+    Font_Atlas*             font_atlas,
+    int                     font_variant,
+    const Text_Batch_Style& style,
+    bool                    order_independent = false) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(text_batch_style_is_valid(style));
 
-  auto draw_cmd = text_batch_push_draw_cmd(
+  text_batch_begin(
       text_batch,
-      text_batch->pipeline_outline,
+      TEXT_BATCH_PIPELINE_UBER,
+      order_independent,
       world_to_clip_transform,
       font_atlas,
-      font_variant);
+      font_variant,
+      style);
+}
+
+// Drops the draw commands and instances recorded since the last reset, and shrinks the instance
+// storage once it has been mostly unused for long enough. The instances' allocation is reused by
+// the next begin/end block of the same frame, unless the frame grew it into several chunks: the
+// next block then starts over in a single one.
+static void text_batch_reset(Text_Batch* text_batch) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(!text_batch->begin_called);
+
+  text_batch->draw_cmds.clear();
+  text_batch->draws.clear();
+  text_batch->draw_params.clear();
+  text_batch->instances_count = 0;
+  text_batch->cull_uploaded   = false;
+  text_batch->draws_culled    = false;
+
+  // Each frame's data buffer is shrunk when it comes around again.
+  if (text_batch->low_use_frames_count >= TEXT_BATCH_SHRINK_FRAMES) {
+    text_batch->low_use_frames_count = 0;
+    text_batch->capacity /= 2;
+    text_batch->stats.shrink_count += 1;
+    text_batch->instances_chunks.clear();
+  }
+  if (text_batch->instances_chunks.size() > 1) { text_batch->instances_chunks.clear(); }
+}
 
-  draw_cmd->outline_color     = outline_color;
-  draw_cmd->outline_thickness = outline_thickness;
+// Returns room for count instances in the mapped arena memory, doubling the capacity until they
+// fit, or nullptr if the instances can't be stored. The last chunk always ends at the capacity.
+static Text_Batch_Instance* text_batch_push_instances(Text_Batch* text_batch, int count) {
+  if (text_batch->instances_chunks.empty()) { return nullptr; }
+
+  if (text_batch->instances_count + count > text_batch->capacity) {
+    auto capacity = text_batch->capacity * 2;
+    while (text_batch->instances_count + count > capacity) { capacity *= 2; }
+    if (!text_batch_allocate_instances(text_batch, capacity)) { return nullptr; }
+    text_batch->stats.grow_count += 1;
+    text_batch->low_use_frames_count = 0;
+  }
+
+  const auto& chunk     = text_batch->instances_chunks.back();
+  auto        instances = reinterpret_cast<Text_Batch_Instance*>(chunk.allocation.ptr);
+  instances                   += text_batch->instances_count - chunk.first_instance;
+  text_batch->instances_count += count;
+  return instances;
 }
 
 static void text_batch_end(Text_Batch* text_batch) {
@@ -355,115 +1165,664 @@ static void text_batch_end(Text_Batch* text_batch) {
   text_batch->begin_called = false;
 }
 
-static void text_batch_draw_internal(
-    Text_Batch*         text_batch,
-    const Font_Variant& font_data,
-    std::string_view    text,
-    HMM_Vec3            position,
-    float               size,
-    HMM_Vec4            color) {
-  SDL_assert(text_batch != nullptr);
-  SDL_assert(text_batch->begin_called);
+// Turns the advances of a line's glyphs into their x positions with an inclusive prefix sum, four
+// values at a time. The scalar version adds in the same order as the SSE2 one, lane by lane, so
+// both give bit-identical positions.
+static void text_layout_prefix_sum_scalar(float* values, int count) {
+  float carry = 0.0f;
+  for (int i = 0; i < count; i += 4) {
+    int   lanes_count = SDL_min(4, count - i);
+    float v[4]        = {};
+    for (int j = 0; j < lanes_count; j++) { v[j] = values[i + j]; }
+    float t[4] = {v[0] + 0.0f, v[1] + v[0], v[2] + v[1], v[3] + v[2]};
+    float u[4] = {t[0] + 0.0f, t[1] + 0.0f, t[2] + t[0], t[3] + t[1]};
+    for (int j = 0; j < lanes_count; j++) { values[i + j] = u[j] + carry; }
+    carry = u[3] + carry;
+  }
+}
 
-  HMM_Vec3    current_position = position;
-  const char* ptr              = text.data();
-  auto        str_size         = text.size();
-  int         codepoint        = SDL_INVALID_UNICODE_CODEPOINT;
-  int         prev_codepoint   = 0;
-  while (codepoint != 0) {
-    codepoint = SDL_StepUTF8(&ptr, &str_size);
-    if (codepoint == SDL_INVALID_UNICODE_CODEPOINT) { continue; }
-
-    auto glyph_it = font_data.glyphs.find(codepoint);
-    if (glyph_it == font_data.glyphs.end()) { continue; }
-
-    if (prev_codepoint != 0) {
-      auto kerning_it = font_data.kernings.find(font_atlas_pack_kerning(prev_codepoint, codepoint));
-      if (kerning_it != font_data.kernings.end()) {
-        current_position.X += kerning_it->second * size;
-      }
+#ifdef SDL_SSE2_INTRINSICS
+static void SDL_TARGETING("sse2") text_layout_prefix_sum_sse2(float* values, int count) {
+  auto prefix_sum = [](__m128 v, __m128 carry) {
+    v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+    v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+    return _mm_add_ps(v, carry);
+  };
+
+  auto carry = _mm_setzero_ps();
+  int  i     = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto v = prefix_sum(_mm_loadu_ps(values + i), carry);
+    _mm_storeu_ps(values + i, v);
+    carry = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  if (i < count) {
+    float tail[4] = {};
+    SDL_memcpy(tail, values + i, sizeof(float) * (count - i));
+    _mm_storeu_ps(tail, prefix_sum(_mm_loadu_ps(tail), carry));
+    SDL_memcpy(values + i, tail, sizeof(float) * (count - i));
+  }
+}
+#endif
+
+static void text_layout_prefix_sum(float* values, int count, Simd_Level level) {
+  switch (level) {
+#ifdef SDL_SSE2_INTRINSICS
+  case SIMD_LEVEL_AVX2:
+  case SIMD_LEVEL_SSE2:
+    text_layout_prefix_sum_sse2(values, count);
+    break;
+#endif
+  default:
+    text_layout_prefix_sum_scalar(values, count);
+    break;
+  }
+}
+
+// Baseline of the first line of a multiline text block of block_height, relative to the position
+// it is drawn at.
+static float text_layout_block_offset_y(
+    const Font_Variant&       font_data,
+    const Text_Layout_Params& params,
+    float                     block_height) {
+  float size = params.size;
+  switch (params.v_align) {
+  case TEXT_BATCH_V_ALIGN_TOP:
+    return -font_data.ascender * size;
+  case TEXT_BATCH_V_ALIGN_MIDDLE:
+    return block_height * 0.5f - font_data.ascender * size;
+  case TEXT_BATCH_V_ALIGN_BOTTOM:
+    return block_height - font_data.line_height * size - font_data.descender * size;
+  case TEXT_BATCH_V_ALIGN_BASELINE:
+  default:
+    return 0.0f;
+  }
+}
+
+// Lays out text in a single pass, decoding and looking up every glyph once, into scratch->glyphs
+// relative to the position the text is drawn at. Only glyphs with an outline are kept, with glyph
+// their index in the glyph metrics table. Shared by Text_Batch and Text_Static. Glyphs a dynamic
+// atlas doesn't have yet are requested as they are decoded, they are laid out right away but only
+// kept once they are resident.
+//
+// The glyphs of a line are gathered with the advance from the previous glyph kept, in ems, which
+// includes kerning and the glyphs without an outline. A prefix sum turns the advances into
+// positions and gives the line width, then each line is scaled and shifted by its alignment.
+//
+// A single line is aligned around the position. Multiline text is split on line feeds and aligned
+// within a text block centered horizontally on the position. Text starting at line first_line of
+// a multiline text block is laid out where those lines are in the whole block.
+static void text_layout(
+    std::string_view          text,
+    const Text_Layout_Params& params,
+    Text_Layout_Scratch*      scratch,
+    int                       first_line = 0,
+    Simd_Level                level      = simd_best_level()) {
+  auto        font_atlas   = params.font_atlas;
+  auto        font_variant = params.font_variant;
+  auto        size         = params.size;
+  const auto& font_data    = font_atlas->variants[font_variant];
+  auto&       glyphs       = scratch->glyphs;
+
+  glyphs.x.clear();
+  glyphs.y.clear();
+  glyphs.glyph.clear();
+  scratch->lines.clear();
+
+  // The baseline of each line is computed from its index rather than accumulated, so that it
+  // doesn't depend on the line the text starts at.
+  float    advance          = 0.0f;
+  int      line             = first_line;
+  float    line_y           = -line * font_data.line_height * size;
+  uint16_t prev_glyph_index = FONT_GLYPH_INDEX_NONE;
+  utf8_for_each_codepoint(text, [&](uint32_t codepoint) {
+    if (codepoint == 10 && params.multiline) {
+      scratch->lines.push_back({static_cast<int>(glyphs.glyph.size()), advance, line_y, 0.0f});
+      line             += 1;
+      advance           = 0.0f;
+      line_y            = -line * font_data.line_height * size;
+      prev_glyph_index  = FONT_GLYPH_INDEX_NONE;
+      return;
     }
-    prev_codepoint = codepoint;
-
-    if (codepoint != 32) {
-      auto draw_cmd = &text_batch->draw_cmds[text_batch->draw_cmds_count - 1];
-      if (draw_cmd->instances_count >= TEXT_BATCH_MAX_INSTANCES_PER_DRAW_CMD) {
-        draw_cmd = text_batch_push_draw_cmd(
-            text_batch,
-            draw_cmd->pipeline,
-            draw_cmd->world_to_clip_transform,
-            draw_cmd->font_atlas,
-            draw_cmd->font_variant);
-      }
 
-      auto instance = &text_batch->instances[text_batch->total_instances_count];
-      text_batch->total_instances_count += 1;
-      draw_cmd->instances_count += 1;
+    auto glyph_index = font_variant_find_glyph_index(font_data, codepoint);
+    if (glyph_index == FONT_GLYPH_INDEX_NONE && font_atlas->dynamic != nullptr) {
+      glyph_index = font_atlas_dynamic_request_glyph(font_atlas, font_variant, codepoint);
+    }
+    if (glyph_index == FONT_GLYPH_INDEX_NONE) { return; }
+    auto glyph = &font_data.glyphs[glyph_index];
 
-      instance->position     = current_position;
-      instance->size         = size;
-      instance->color        = color;
-      instance->plane_bounds = HMM_V4(
-          glyph_it->second.plane_bounds.left,
-          glyph_it->second.plane_bounds.top,
-          glyph_it->second.plane_bounds.right,
-          glyph_it->second.plane_bounds.bottom);
-      float atlas_width      = static_cast<float>(draw_cmd->font_atlas->width);
-      float atlas_height     = static_cast<float>(draw_cmd->font_atlas->height);
-      instance->atlas_bounds = HMM_V4(
-          glyph_it->second.atlas_bounds.left / atlas_width,
-          1.0f - glyph_it->second.atlas_bounds.top / atlas_height,
-          glyph_it->second.atlas_bounds.right / atlas_width,
-          1.0f - glyph_it->second.atlas_bounds.bottom / atlas_height);
+    if (font_atlas->dynamic != nullptr) {
+      font_atlas_dynamic_use_glyph(font_atlas, font_variant, glyph_index);
     }
 
-    current_position.X += glyph_it->second.horizontal_advance * size;
-  }
-}
+    if (prev_glyph_index != FONT_GLYPH_INDEX_NONE) {
+      advance += font_kerning_table_lookup(font_data.kerning_table, prev_glyph_index, glyph_index);
+    }
+    prev_glyph_index = glyph_index;
 
-static void text_batch_draw(
-    Text_Batch*        text_batch,
-    std::string_view   text,
-    HMM_Vec3           position,
-    float              size,
-    Text_Batch_H_Align h_align = TEXT_BATCH_H_ALIGN_LEFT,
-    Text_Batch_V_Align v_align = TEXT_BATCH_V_ALIGN_TOP,
-    HMM_Vec4           color   = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f)) {
-  SDL_assert(text_batch != nullptr);
-  SDL_assert(text_batch->begin_called);
+    if (codepoint != 32 && glyph->plane_bounds.X != glyph->plane_bounds.Z) {
+      glyphs.x.push_back(advance);
+      glyphs.glyph.push_back(static_cast<uint16_t>(font_data.glyph_metrics_offset + glyph_index));
+      advance = 0.0f;
+    }
 
-  const auto& draw_cmd  = text_batch->draw_cmds[text_batch->draw_cmds_count - 1];
-  const auto& font_data = draw_cmd.font_atlas->variants[draw_cmd.font_variant];
+    advance += glyph->horizontal_advance;
+  });
+  scratch->lines.push_back({static_cast<int>(glyphs.glyph.size()), advance, line_y, 0.0f});
+
+  int glyphs_begin = 0;
+  for (auto& line : scratch->lines) {
+    int glyphs_count = line.glyphs_end - glyphs_begin;
+    text_layout_prefix_sum(&glyphs.x[glyphs_begin], glyphs_count, level);
+
+    float line_advance = glyphs_count > 0 ? glyphs.x[line.glyphs_end - 1] : 0.0f;
+    line.width         = (line_advance + line.trailing_advance) * size;
+    glyphs_begin       = line.glyphs_end;
+  }
 
-  HMM_Vec3 current_position = position;
-  switch (h_align) {
+  // Offset of the first line's baseline start, and how much of the free width of a line goes
+  // before it.
+  HMM_Vec2 offset;
+  float    free_width_factor;
+  switch (params.h_align) {
   case TEXT_BATCH_H_ALIGN_CENTER:
-    current_position.X -= font_atlas_string_width(font_data, text, size) * 0.5f;
-    0.5f;
+    free_width_factor = 0.5f;
     break;
   case TEXT_BATCH_H_ALIGN_RIGHT:
-    current_position.X -= font_atlas_string_width(font_data, text, size);
+    free_width_factor = 1.0f;
     break;
   case TEXT_BATCH_H_ALIGN_LEFT:
   default:
+    free_width_factor = 0.0f;
     break;
   }
-  switch (v_align) {
-  case TEXT_BATCH_V_ALIGN_TOP:
-    current_position.Y -= font_data.ascender * size;
-    break;
-  case TEXT_BATCH_V_ALIGN_MIDDLE:
-    current_position.Y -= (font_data.ascender + font_data.descender) * 0.5f * size;
-    break;
-  case TEXT_BATCH_V_ALIGN_BOTTOM:
-    current_position.Y -= font_data.descender * size;
+
+  float block_width = 0.0f;
+  if (params.multiline) {
+    auto text_block_size = params.text_block_size;
+    if (text_block_size == HMM_V2(-1.0f, -1.0f)) {
+      text_block_size.X = 0.0f;
+      for (const auto& line : scratch->lines) {
+        text_block_size.X = std::max(text_block_size.X, line.width);
+      }
+      text_block_size.Y = scratch->lines.size() * font_data.line_height * size;
+    }
+    block_width = text_block_size.X;
+
+    offset.X = -text_block_size.X * 0.5f;
+    offset.Y = text_layout_block_offset_y(font_data, params, text_block_size.Y);
+  } else {
+    offset.X = 0.0f;
+    switch (params.v_align) {
+    case TEXT_BATCH_V_ALIGN_TOP:
+      offset.Y = -font_data.ascender * size;
+      break;
+    case TEXT_BATCH_V_ALIGN_MIDDLE:
+      offset.Y = -(font_data.ascender + font_data.descender) * 0.5f * size;
+      break;
+    case TEXT_BATCH_V_ALIGN_BOTTOM:
+      offset.Y = -font_data.descender * size;
+      break;
+    case TEXT_BATCH_V_ALIGN_BASELINE:
+    default:
+      offset.Y = 0.0f;
+      break;
+    }
+  }
+
+  glyphs.y.resize(glyphs.x.size());
+  glyphs_begin = 0;
+  for (const auto& line : scratch->lines) {
+    auto line_offset = offset;
+    line_offset.X   += (block_width - line.width) * free_width_factor;
+    line_offset.Y   += line.y;
+    for (int i = glyphs_begin; i < line.glyphs_end; i++) {
+      glyphs.x[i] = glyphs.x[i] * size + line_offset.X;
+      glyphs.y[i] = line_offset.Y;
+    }
+    glyphs_begin = line.glyphs_end;
+  }
+}
+
+static uint64_t text_layout_cache_hash(std::string_view text, const Text_Layout_Params& params) {
+  uint64_t hash = TEXT_BATCH_HASH_SEED;
+  for (auto c : text) { hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull; }
+
+  uint32_t floats[3];
+  SDL_memcpy(&floats[0], &params.size, sizeof(float));
+  SDL_memcpy(&floats[1], &params.text_block_size, sizeof(HMM_Vec2));
+  uint64_t words[4] = {
+      reinterpret_cast<uintptr_t>(params.font_atlas),
+      static_cast<uint64_t>(params.font_variant) << 32 |
+          static_cast<uint64_t>(params.h_align) << 16 | static_cast<uint64_t>(params.v_align) << 1 |
+          (params.multiline ? 1 : 0),
+      floats[0],
+      static_cast<uint64_t>(floats[1]) << 32 | floats[2],
+  };
+  for (auto word : words) {
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+// Returns the cached glyphs of text laid out with params, or nullptr on a miss.
+static const Text_Layout_Glyphs* text_layout_cache_find(
+    Text_Layout_Cache*        cache,
+    uint64_t                  hash,
+    std::string_view          text,
+    const Text_Layout_Params& params) {
+  auto it = cache->index.find(hash);
+  if (it != cache->index.end()) {
+    auto        entry        = it->second;
+    const auto& entry_params = entry->params;
+    if (entry->text == text && entry_params.font_atlas == params.font_atlas &&
+        entry_params.font_variant == params.font_variant && entry_params.size == params.size &&
+        entry_params.h_align == params.h_align && entry_params.v_align == params.v_align &&
+        entry_params.text_block_size == params.text_block_size &&
+        entry_params.multiline == params.multiline) {
+      cache->entries.splice(cache->entries.begin(), cache->entries, entry);
+      cache->stats.hits_count += 1;
+      return &entry->glyphs;
+    }
+  }
+  cache->stats.misses_count += 1;
+  return nullptr;
+}
+
+// Bytes a cached layout of text with glyphs_count glyphs accounts for.
+static size_t text_layout_cache_entry_bytes(std::string_view text, size_t glyphs_count) {
+  auto glyph_bytes = 2 * sizeof(float) + sizeof(uint16_t);
+  return sizeof(Text_Layout_Entry) + text.size() + glyphs_count * glyph_bytes + 4 * sizeof(void*);
+}
+
+// Whether any layout of text fits within the budget of cache. Text has at most a glyph per byte.
+static bool text_layout_cache_fits(const Text_Layout_Cache& cache, std::string_view text) {
+  return text_layout_cache_entry_bytes(text, text.size()) <= cache.budget_bytes;
+}
+
+// Caches the glyphs of text laid out with params, replacing a layout with the same hash. Evicts the
+// least recently drawn layouts to stay within budget_bytes, layouts larger than the whole budget
+// aren't cached.
+static void text_layout_cache_insert(
+    Text_Layout_Cache*        cache,
+    uint64_t                  hash,
+    std::string_view          text,
+    const Text_Layout_Params& params,
+    const Text_Layout_Glyphs& glyphs) {
+  auto it = cache->index.find(hash);
+  if (it != cache->index.end()) {
+    cache->bytes -= it->second->bytes;
+    cache->entries.erase(it->second);
+    cache->index.erase(it);
+  }
+
+  auto bytes = text_layout_cache_entry_bytes(text, glyphs.glyph.size());
+  if (bytes > cache->budget_bytes) { return; }
+
+  while (cache->bytes + bytes > cache->budget_bytes) {
+    auto& last = cache->entries.back();
+    cache->bytes -= last.bytes;
+    cache->index.erase(last.hash);
+    cache->entries.pop_back();
+    cache->stats.evictions_count += 1;
+  }
+
+  Text_Layout_Entry entry = {};
+  entry.hash              = hash;
+  entry.text              = text;
+  entry.params            = params;
+  entry.glyphs            = glyphs;
+  entry.bytes             = bytes;
+  cache->entries.push_front(std::move(entry));
+  cache->index[hash]  = cache->entries.begin();
+  cache->bytes       += bytes;
+}
+
+// Drops every cached layout, for example when the cache is disabled or its budget changes.
+static void text_layout_cache_clear(Text_Layout_Cache* cache) {
+  cache->entries.clear();
+  cache->index.clear();
+  cache->bytes = 0;
+}
+
+// Writes count laid out glyphs starting at first as instances translated to origin. The SSE2
+// version builds four instances at a time by transposing their positions, glyphs with size and
+// colors, both versions compute the same single float addition per coordinate.
+static void text_batch_write_instances_scalar(
+    Text_Batch_Instance*      instances,
+    const Text_Layout_Glyphs& glyphs,
+    int                       first,
+    int                       count,
+    HMM_Vec2                  origin,
+    uint16_t                  packed_size,
+    uint32_t                  packed_color) {
+  for (int i = 0; i < count; i++) {
+    auto instance        = &instances[i];
+    instance->position.X = origin.X + glyphs.x[first + i];
+    instance->position.Y = origin.Y + glyphs.y[first + i];
+    instance->glyph      = glyphs.glyph[first + i];
+    instance->size       = packed_size;
+    instance->color      = packed_color;
+  }
+}
+
+#ifdef SDL_SSE2_INTRINSICS
+static void SDL_TARGETING("sse2") text_batch_write_instances_sse2(
+    Text_Batch_Instance*      instances,
+    const Text_Layout_Glyphs& glyphs,
+    int                       first,
+    int                       count,
+    HMM_Vec2                  origin,
+    uint16_t                  packed_size,
+    uint32_t                  packed_color) {
+  static_assert(offsetof(Text_Batch_Instance, glyph) == 8);
+  static_assert(offsetof(Text_Batch_Instance, size) == 10);
+  static_assert(offsetof(Text_Batch_Instance, color) == 12);
+
+  auto origin_x = _mm_set1_ps(origin.X);
+  auto origin_y = _mm_set1_ps(origin.Y);
+  auto sizes    = _mm_set1_epi16(static_cast<short>(packed_size));
+  auto colors   = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(packed_color)));
+  auto xs       = glyphs.x.data() + first;
+  auto ys       = glyphs.y.data() + first;
+  auto indices  = glyphs.glyph.data() + first;
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto x           = _mm_add_ps(origin_x, _mm_loadu_ps(xs + i));
+    auto y           = _mm_add_ps(origin_y, _mm_loadu_ps(ys + i));
+    auto glyph_sizes = _mm_castsi128_ps(_mm_unpacklo_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)), sizes));
+
+    // Rows of x, y, glyph with size and color, transposed into one instance per register.
+    auto xy_low  = _mm_unpacklo_ps(x, y);
+    auto xy_high = _mm_unpackhi_ps(x, y);
+    auto gc_low  = _mm_unpacklo_ps(glyph_sizes, colors);
+    auto gc_high = _mm_unpackhi_ps(glyph_sizes, colors);
+    auto output  = reinterpret_cast<float*>(instances + i);
+    _mm_storeu_ps(output + 0, _mm_movelh_ps(xy_low, gc_low));
+    _mm_storeu_ps(output + 4, _mm_movehl_ps(gc_low, xy_low));
+    _mm_storeu_ps(output + 8, _mm_movelh_ps(xy_high, gc_high));
+    _mm_storeu_ps(output + 12, _mm_movehl_ps(gc_high, xy_high));
+  }
+  text_batch_write_instances_scalar(
+      instances + i, glyphs, first + i, count - i, origin, packed_size, packed_color);
+}
+#endif
+
+static void text_batch_write_instances(
+    Text_Batch_Instance*      instances,
+    const Text_Layout_Glyphs& glyphs,
+    int                       first,
+    int                       count,
+    HMM_Vec2                  origin,
+    uint16_t                  packed_size,
+    uint32_t                  packed_color,
+    Simd_Level                level = simd_best_level()) {
+  switch (level) {
+#ifdef SDL_SSE2_INTRINSICS
+  case SIMD_LEVEL_AVX2:
+  case SIMD_LEVEL_SSE2:
+    text_batch_write_instances_sse2(
+        instances, glyphs, first, count, origin, packed_size, packed_color);
     break;
-  case TEXT_BATCH_V_ALIGN_BASELINE:
+#endif
   default:
+    text_batch_write_instances_scalar(
+        instances, glyphs, first, count, origin, packed_size, packed_color);
     break;
   }
+}
+
+// Text drawn with a clip rectangle only emits the glyphs that may be visible within it. The
+// rectangle is in the space text is positioned in, y up, and is widened by half a line above and
+// below and by an em on the sides, as glyph origins and line boxes don't bound accents, swashes or
+// italic overhangs.
+static constexpr float TEXT_LAYOUT_CLIP_MARGIN_LINES = 0.5f;
+static constexpr float TEXT_LAYOUT_CLIP_MARGIN_EMS   = 1.0f;
+
+// Region of the plane at position_z that an affine world_to_clip_transform, such as an
+// orthographic camera's, maps into the clip volume. The clip rectangle of text drawn with it.
+static SDL_FRect text_batch_clip_rect(const HMM_Mat4& world_to_clip_transform, float position_z) {
+  auto  clip_to_world = HMM_InvGeneralM4(world_to_clip_transform);
+  auto  plane         = world_to_clip_transform * HMM_V4(0.0f, 0.0f, position_z, 1.0f);
+  float plane_z       = plane.Z / plane.W;
+
+  HMM_Vec2 min = HMM_V2(FLT_MAX, FLT_MAX);
+  HMM_Vec2 max = HMM_V2(-FLT_MAX, -FLT_MAX);
+  for (int corner = 0; corner < 4; corner++) {
+    float x     = corner % 2 == 0 ? -1.0f : 1.0f;
+    float y     = corner < 2 ? -1.0f : 1.0f;
+    auto  world = clip_to_world * HMM_V4(x, y, plane_z, 1.0f);
+    auto  point = HMM_V2(world.X / world.W, world.Y / world.W);
+    min         = HMM_V2(SDL_min(min.X, point.X), SDL_min(min.Y, point.Y));
+    max         = HMM_V2(SDL_max(max.X, point.X), SDL_max(max.Y, point.Y));
+  }
+  return {min.X, min.Y, max.X - min.X, max.Y - min.Y};
+}
+
+// Builds the runs of the glyphs of a multiline layout, drawn at origin, that may be visible within
+// clip_rect. Glyphs are ordered by line and lines go down, so the lines above and below the
+// rectangle are skipped with two binary searches on the glyphs' baselines. The glyphs of the lines
+// in between are trimmed to the sides of the rectangle.
+static void text_layout_clip(
+    const Text_Layout_Glyphs&     glyphs,
+    HMM_Vec2                      origin,
+    float                         size,
+    const Font_Variant&           font_data,
+    const SDL_FRect&              clip_rect,
+    std::vector<Text_Layout_Run>* runs) {
+  float margin_y = TEXT_LAYOUT_CLIP_MARGIN_LINES * font_data.line_height * size;
+  float margin_x = TEXT_LAYOUT_CLIP_MARGIN_EMS * size;
+  float min_x    = clip_rect.x - margin_x - origin.X;
+  float max_x    = clip_rect.x + clip_rect.w + margin_x - origin.X;
+  float top      = clip_rect.y + clip_rect.h + margin_y - origin.Y - font_data.descender * size;
+  float bottom   = clip_rect.y - margin_y - origin.Y - font_data.ascender * size;
+
+  runs->clear();
+  auto lines_begin = std::partition_point(
+      glyphs.y.begin(),
+      glyphs.y.end(),
+      [&](float y) { return y > top; });
+  auto lines_end = std::partition_point(lines_begin, glyphs.y.end(), [&](float y) {
+    return y >= bottom;
+  });
+
+  int first = static_cast<int>(lines_begin - glyphs.y.begin());
+  int end   = static_cast<int>(lines_end - glyphs.y.begin());
+  for (int i = first; i < end; i++) {
+    bool visible = glyphs.x[i] >= min_x && glyphs.x[i] <= max_x;
+    if (!visible) { continue; }
+    if (!runs->empty() && runs->back().first + runs->back().count == i) {
+      runs->back().count += 1;
+    } else {
+      runs->push_back({i, 1});
+    }
+  }
+}
+
+// Returns the lines of multiline text, laid out in a block of block_height, whose glyphs may be
+// visible within clip_rect once drawn at origin_y, as the byte range from the first of them up to
+// the line feed ending the last, and the index of the first. Found by counting line feeds, which
+// UTF-8 never encodes within another codepoint, without decoding the text.
+static std::string_view text_layout_clip_lines(
+    std::string_view          text,
+    const Text_Layout_Params& params,
+    float                     block_height,
+    float                     origin_y,
+    const SDL_FRect&          clip_rect,
+    int*                      out_first_line) {
+  const auto& font_data   = params.font_atlas->variants[params.font_variant];
+  float       size        = params.size;
+  float       line_height = font_data.line_height * size;
+  float       margin_y    = TEXT_LAYOUT_CLIP_MARGIN_LINES * line_height;
+  float       baseline    = origin_y + text_layout_block_offset_y(font_data, params, block_height);
+
+  // The baseline of line i is line_height * i below the first's.
+  float first_line = SDL_ceilf(
+      (baseline + font_data.descender * size - margin_y - (clip_rect.y + clip_rect.h)) /
+      line_height);
+  float last_line = SDL_floorf(
+      (baseline + font_data.ascender * size + margin_y - clip_rect.y) / line_height);
+  *out_first_line = 0;
+  if (last_line < first_line || last_line < 0.0f) { return {}; }
+
+  size_t begin = 0;
+  int    line  = 0;
+  for (; line < first_line; line++) {
+    auto line_feed = text.find('\n', begin);
+    if (line_feed == std::string_view::npos) { return {}; }
+    begin = line_feed + 1;
+  }
+  *out_first_line = line;
+
+  size_t end = begin;
+  for (; line <= last_line; line++) {
+    end = text.find('\n', end);
+    if (end == std::string_view::npos) { return text.substr(begin); }
+    if (line < last_line) { end += 1; }
+  }
+  return text.substr(begin, end - begin);
+}
+
+// Returns the draw command the glyphs of text at position_z go into. Glyphs of a text share its z
+// position, which is per draw command.
+static Text_Batch_Draw_Cmd* text_batch_draw_cmd_at(Text_Batch* text_batch, float position_z) {
+  auto draw_cmd = &text_batch->draw_cmds.back();
+  if (draw_cmd->position_z != position_z) {
+    if (draw_cmd->instances_count > 0) {
+      // Copied, pushing the draw command may reallocate the one it is read from.
+      auto previous = *draw_cmd;
+      draw_cmd      = text_batch_push_draw_cmd(
+          text_batch,
+          previous.pipeline,
+          previous.order_independent,
+          previous.world_to_clip_transform,
+          previous.font_atlas,
+          previous.style);
+    }
+    draw_cmd->position_z = position_z;
+  }
+  return draw_cmd;
+}
+
+// Lays out text with the current font, through the layout cache unless the atlas is dynamic, and
+// emits its glyphs translated to position. With a clip rectangle, only the glyphs of multiline text
+// that may be visible within it are emitted. A cached layout is kept whole so that it still hits
+// as the rectangle moves. Other text, and text too long for the cache to surely hold its layout,
+// skips the lines outside of the rectangle before laying out the rest when the text block size is
+// given.
+static void text_batch_draw_internal(
+    Text_Batch*        text_batch,
+    std::string_view   text,
+    HMM_Vec3           position,
+    float              size,
+    Text_Batch_H_Align h_align,
+    Text_Batch_V_Align v_align,
+    HMM_Vec4           color,
+    HMM_Vec2           text_block_size,
+    bool               multiline,
+    const SDL_FRect*   clip_rect) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(text_batch->begin_called);
+
+  auto               font_atlas = text_batch->font_atlas;
+  Text_Layout_Params params     = {};
+  params.font_atlas             = font_atlas;
+  params.font_variant           = text_batch->font_variant;
+  params.size                   = size;
+  params.h_align                = h_align;
+  params.v_align                = v_align;
+  params.text_block_size        = text_block_size;
+  params.multiline              = multiline;
+
+  bool clipped    = clip_rect != nullptr && multiline;
+  bool cached     = font_atlas->dynamic == nullptr && text_batch->layout_cache.enabled;
+  int  first_line = 0;
+  if (clipped && cached && !text_layout_cache_fits(text_batch->layout_cache, text)) {
+    cached = false;
+  }
+  if (clipped && !cached && text_block_size != HMM_V2(-1.0f, -1.0f)) {
+    text = text_layout_clip_lines(
+        text,
+        params,
+        text_block_size.Y,
+        position.Y,
+        *clip_rect,
+        &first_line);
+  }
+
+  const Text_Layout_Glyphs* glyphs = nullptr;
+  if (cached) {
+    auto hash = text_layout_cache_hash(text, params);
+    glyphs    = text_layout_cache_find(&text_batch->layout_cache, hash, text, params);
+    if (glyphs == nullptr) {
+      text_layout(text, params, &text_batch->layout_scratch);
+      glyphs = &text_batch->layout_scratch.glyphs;
+      text_layout_cache_insert(&text_batch->layout_cache, hash, text, params, *glyphs);
+    }
+  } else {
+    text_layout(text, params, &text_batch->layout_scratch, first_line);
+    glyphs = &text_batch->layout_scratch.glyphs;
+  }
+
+  const auto& font_data = font_atlas->variants[params.font_variant];
+  auto        origin    = HMM_V2(position.X, position.Y);
+  auto&       runs      = text_batch->layout_scratch.runs;
+  if (clipped) {
+    text_layout_clip(*glyphs, origin, size, font_data, *clip_rect, &runs);
+  } else {
+    runs.clear();
+    runs.push_back({0, static_cast<int>(glyphs->glyph.size())});
+  }
+  int glyphs_count = 0;
+  for (const auto& run : runs) { glyphs_count += run.count; }
+
+  auto draw_cmd     = text_batch_draw_cmd_at(text_batch, position.Z);
+  auto packed_size  = float_to_half(size);
+  auto packed_color = pack_color_rgba8(color);
+  auto instances    = text_batch_push_instances(text_batch, glyphs_count);
+  if (instances == nullptr) { return; }
+
+  // Instances are built in a block on the stack and hashed there, the mapped memory is
+  // write-combined and only ever written to.
+  Text_Batch_Instance block[64];
+  for (const auto& run : runs) {
+    for (int first = 0; first < run.count; first += SDL_arraysize(block)) {
+      int block_count = SDL_min(static_cast<int>(SDL_arraysize(block)), run.count - first);
+      text_batch_write_instances(
+          block, *glyphs, run.first + first, block_count, origin, packed_size, packed_color);
+      for (int i = 0; i < block_count; i++) {
+        draw_cmd->instances_hash = text_batch_hash_instance(draw_cmd->instances_hash, block[i]);
+      }
+      SDL_memcpy(instances, block, sizeof(Text_Batch_Instance) * block_count);
+      instances += block_count;
+    }
+  }
+  draw_cmd->instances_count += glyphs_count;
+}
 
-  text_batch_draw_internal(text_batch, font_data, text, current_position, size, color);
+static void text_batch_draw(
+    Text_Batch*        text_batch,
+    std::string_view   text,
+    HMM_Vec3           position,
+    float              size,
+    Text_Batch_H_Align h_align = TEXT_BATCH_H_ALIGN_LEFT,
+    Text_Batch_V_Align v_align = TEXT_BATCH_V_ALIGN_TOP,
+    HMM_Vec4           color   = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f)) {
+  text_batch_draw_internal(
+      text_batch,
+      text,
+      position,
+      size,
+      h_align,
+      v_align,
+      color,
+      HMM_V2(-1.0f, -1.0f),
+      false,
+      nullptr);
 }
 
 static void text_batch_draw_multiline(
@@ -474,112 +1833,477 @@ static void text_batch_draw_multiline(
     Text_Batch_H_Align h_align         = TEXT_BATCH_H_ALIGN_LEFT,
     Text_Batch_V_Align v_align         = TEXT_BATCH_V_ALIGN_TOP,
     HMM_Vec4           color           = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f),
-    HMM_Vec2           text_block_size = HMM_V2(-1.0f, -1.0f)) {
+    HMM_Vec2           text_block_size = HMM_V2(-1.0f, -1.0f),
+    const SDL_FRect*   clip_rect       = nullptr) {
+  text_batch_draw_internal(
+      text_batch,
+      text,
+      position,
+      size,
+      h_align,
+      v_align,
+      color,
+      text_block_size,
+      true,
+      clip_rect);
+}
+
+static Text_Batch_Draw_Params text_batch_draw_params(
+    const HMM_Mat4&         world_to_clip_transform,
+    float                   position_z,
+    const Font_Atlas&       font_atlas,
+    const Text_Batch_Style& style,
+    int                     first_instance) {
+  Text_Batch_Draw_Params params  = {};
+  params.world_to_clip_transform = world_to_clip_transform;
+  params.outline_color           = style.outline_color;
+  params.shadow_color            = style.shadow_color;
+  params.glow_color              = style.glow_color;
+  params.first_instance          = static_cast<uint32_t>(first_instance);
+  params.position_z              = position_z;
+  params.unit_range              = font_atlas.distance_range / FONT_ATLAS_LAYER_SIZE;
+  params.outline_thickness       = style.outline_thickness;
+  params.shadow_offset           = style.shadow_offset;
+  params.shadow_softness         = style.shadow_softness;
+  params.glow_thickness          = style.glow_thickness;
+  params.effects                 = style.effects;
+  params.blur_radius             = style.blur_radius;
+  if (font_atlas.type == FONT_ATLAS_TYPE_MTSDF) {
+    params.effects |= TEXT_BATCH_EFFECT_TRUE_DISTANCE;
+  }
+  return params;
+}
+
+// Pushes the vertex uniforms, params are those of every instance when draw_params_count is 0.
+// Shared by Text_Batch and Text_Static.
+static void text_batch_push_uniforms(
+    SDL_GPUCommandBuffer*         cmd_buf,
+    const Text_Batch_Draw_Params& params,
+    int                           draw_params_count,
+    bool                          culled) {
+  Vertex_Uniform_Data uniforms = {};
+  uniforms.params              = params;
+  uniforms.draw_params_count   = static_cast<uint32_t>(draw_params_count);
+  uniforms.culled              = culled ? 1 : 0;
+  SDL_PushGPUVertexUniformData(cmd_buf, 0, &uniforms, sizeof(uniforms));
+}
+
+// Orders the draw commands with instances as they are uploaded and drawn: as they were recorded,
+// or with sort_draw_cmds, each run of order independent draw commands grouped by pipeline so that
+// a pipeline's instances end up adjacent in the data buffer. The draw commands between the runs
+// keep their place.
+static void text_batch_order_draw_cmds(Text_Batch* text_batch) {
   SDL_assert(text_batch != nullptr);
-  SDL_assert(text_batch->begin_called);
 
-  const auto& draw_cmd  = text_batch->draw_cmds[text_batch->draw_cmds_count - 1];
-  const auto& font_data = draw_cmd.font_atlas->variants[draw_cmd.font_variant];
+  const auto& draw_cmds = text_batch->draw_cmds;
+  auto&       order     = text_batch->draw_cmds_order;
 
-  if (text_block_size == HMM_V2(-1.0f, -1.0f)) {
-    text_block_size = font_atlas_string_multiline_block_size(font_data, text, size);
+  order.clear();
+  for (int i = 0; i < draw_cmds.size(); i++) {
+    if (draw_cmds[i].instances_count > 0) { order.push_back(i); }
   }
-
-  float current_y = position.Y;
-  switch (v_align) {
-  case TEXT_BATCH_V_ALIGN_TOP:
-    current_y -= font_data.ascender * size;
-    break;
-  case TEXT_BATCH_V_ALIGN_MIDDLE:
-    current_y = position.Y + text_block_size.Y * 0.5f - font_data.ascender * size;
-    break;
-  case TEXT_BATCH_V_ALIGN_BOTTOM:
-    current_y =
-        position.Y + text_block_size.Y - font_data.line_height * size - font_data.descender * size;
-    break;
-  case TEXT_BATCH_V_ALIGN_BASELINE:
-  default:
-    break;
+  if (!text_batch->sort_draw_cmds) { return; }
+
+  auto run_begin = order.begin();
+  while (run_begin != order.end()) {
+    auto run_end = std::find_if(run_begin, order.end(), [&](int index) {
+      return !draw_cmds[index].order_independent;
+    });
+    std::stable_sort(run_begin, run_end, [&](int a, int b) {
+      return draw_cmds[a].pipeline < draw_cmds[b].pipeline;
+    });
+    run_begin = run_end == order.end() ? run_end : run_end + 1;
   }
+}
 
-  auto draw_line = [&](std::string_view line) {
-    HMM_Vec3 line_position = HMM_V3(position.X - text_block_size.X * 0.5f, current_y, position.Z);
+// Builds the draws of the ordered draw commands and their draw parameters, sorted by where their
+// instances are in the data buffer, and counts them in the stats.
+static void text_batch_build_draws(Text_Batch* text_batch) {
+  SDL_assert(text_batch != nullptr);
 
-    switch (h_align) {
-    case TEXT_BATCH_H_ALIGN_CENTER:
-      line_position.X +=
-          (text_block_size.X - font_atlas_string_width(font_data, line, size)) * 0.5f;
-      break;
-    case TEXT_BATCH_H_ALIGN_RIGHT:
-      line_position.X += text_block_size.X - font_atlas_string_width(font_data, line, size);
-      break;
-    case TEXT_BATCH_H_ALIGN_LEFT:
-    default:
-      break;
+  const auto& draw_cmds   = text_batch->draw_cmds;
+  const auto& order       = text_batch->draw_cmds_order;
+  auto&       draws       = text_batch->draws;
+  auto&       draw_params = text_batch->draw_params;
+
+  draws.clear();
+  draw_params.clear();
+  for (auto index : order) {
+    const auto& draw_cmd = draw_cmds[index];
+    draw_params.push_back(text_batch_draw_params(
+        draw_cmd.world_to_clip_transform,
+        draw_cmd.position_z,
+        *draw_cmd.font_atlas,
+        draw_cmd.style,
+        draw_cmd.buffer_first_instance));
+
+    if (!draws.empty()) {
+      auto& draw = draws.back();
+      if (draw.pipeline == draw_cmd.pipeline &&
+          draw.first_instance + draw.instances_count == draw_cmd.buffer_first_instance) {
+        draw.instances_count += draw_cmd.instances_count;
+        continue;
+      }
     }
 
-    text_batch_draw_internal(text_batch, font_data, line, line_position, size, color);
+    Text_Batch_Draw draw = {};
+    draw.pipeline        = draw_cmd.pipeline;
+    draw.first_instance  = draw_cmd.buffer_first_instance;
+    draw.instances_count = draw_cmd.instances_count;
+    draw.bind_pipeline   = draws.empty() || draws.back().pipeline != draw_cmd.pipeline;
+    draws.push_back(draw);
+  }
+  std::sort(
+      draw_params.begin(),
+      draw_params.end(),
+      [](const Text_Batch_Draw_Params& a, const Text_Batch_Draw_Params& b) {
+        return a.first_instance < b.first_instance;
+      });
+
+  auto& stats                = text_batch->stats;
+  stats.draw_cmds_count      = static_cast<int>(order.size());
+  stats.draws_count          = static_cast<int>(draws.size());
+  stats.pipeline_binds_count = 0;
+  stats.uniform_pushes_count = draws.empty() ? 0 : 1;
+  for (const auto& draw : draws) { stats.pipeline_binds_count += draw.bind_pipeline ? 1 : 0; }
+}
 
-    current_y -= font_data.line_height * size;
-  };
+// Splits the draws into the blocks culled by a thread group each. Returns false if there are too
+// many blocks to cull in one dispatch.
+static bool text_batch_build_cull_tables(Text_Batch* text_batch) {
+  SDL_assert(text_batch != nullptr);
 
-  const char* ptr        = text.data();
-  auto        str_size   = text.size();
-  const char* line_start = ptr;
-  int         codepoint  = SDL_INVALID_UNICODE_CODEPOINT;
-  while (codepoint != 0) {
-    codepoint = SDL_StepUTF8(&ptr, &str_size);
-    if (codepoint == SDL_INVALID_UNICODE_CODEPOINT) { continue; }
+  auto& cull_draws  = text_batch->cull_draws;
+  auto& cull_blocks = text_batch->cull_blocks;
+
+  cull_draws.clear();
+  cull_blocks.clear();
+  for (const auto& draw : text_batch->draws) {
+    Text_Batch_Cull_Draw cull_draw = {};
+    cull_draw.first_instance       = static_cast<uint32_t>(draw.first_instance);
+    cull_draw.instances_count      = static_cast<uint32_t>(draw.instances_count);
+    cull_draw.first_block          = static_cast<uint32_t>(cull_blocks.size());
+    cull_draw.blocks_count         = static_cast<uint32_t>(
+        (draw.instances_count + TEXT_BATCH_CULL_GROUP_SIZE - 1) / TEXT_BATCH_CULL_GROUP_SIZE);
+    if (cull_blocks.size() + cull_draw.blocks_count > TEXT_BATCH_CULL_MAX_BLOCKS) { return false; }
+    cull_blocks.insert(
+        cull_blocks.end(),
+        cull_draw.blocks_count,
+        static_cast<uint32_t>(cull_draws.size()));
+    cull_draws.push_back(cull_draw);
+  }
+  return true;
+}
 
-    if (codepoint == 10) {
-      draw_line({line_start, static_cast<size_t>(ptr - line_start)});
-      line_start = ptr;
-    }
+// Reads back the indirect draw arguments the culling of the current frame wrote when it last came
+// around, its fence has signaled by now, into the culling stats.
+static void text_batch_read_cull_stats(Text_Batch* text_batch) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(text_batch->upload_scheduler->frame_begun);
+
+  auto& frame = text_batch->frames[text_batch->upload_scheduler->frame_index];
+  if (frame.cull_readback_draws_count == 0) { return; }
+
+  auto commands = static_cast<const SDL_GPUIndirectDrawCommand*>(
+      SDL_MapGPUTransferBuffer(text_batch->device, frame.cull_readback_buffer, false));
+  if (commands == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to map transfer buffer: %s",
+        SDL_GetError());
+    return;
+  }
+  uint32_t visible_count = 0;
+  for (int i = 0; i < frame.cull_readback_draws_count; i++) {
+    visible_count += commands[i].num_vertices / TEXT_BATCH_INDICES_PER_INSTANCE;
   }
+  SDL_UnmapGPUTransferBuffer(text_batch->device, frame.cull_readback_buffer);
 
-  if (ptr > line_start) { draw_line({line_start, static_cast<size_t>(ptr - line_start)}); }
+  text_batch->stats.cull_tested_count  = frame.cull_readback_tested_count;
+  text_batch->stats.cull_visible_count = static_cast<int>(visible_count);
+  frame.cull_readback_draws_count      = 0;
 }
 
-static void text_batch_prepare_draw_cmds(
-    Text_Batch*           text_batch,
-    SDL_GPUDevice*        device,
-    SDL_GPUCommandBuffer* cmd_buf) {
+// Queues the upload of the frame's changed instances with the upload scheduler, into the data
+// buffer of the scheduler's current frame. Call before upload_scheduler_flush.
+static void text_batch_prepare_draw_cmds(Text_Batch* text_batch) {
   SDL_assert(text_batch != nullptr);
-  SDL_assert(device != nullptr);
-  SDL_assert(cmd_buf != nullptr);
   SDL_assert(!text_batch->begin_called);
 
-  if (text_batch->draw_cmds_count == 0) { return; }
+  int instances_count = text_batch->instances_count;
+  text_batch->stats.peak_instances_count =
+      SDL_max(text_batch->stats.peak_instances_count, instances_count);
+  text_batch->stats.uploaded_bytes       = 0;
+  text_batch->stats.reused_bytes         = 0;
+  text_batch->stats.draw_cmds_count      = 0;
+  text_batch->stats.draws_count          = 0;
+  text_batch->stats.pipeline_binds_count = 0;
+  text_batch->stats.uniform_pushes_count = 0;
+  text_batch->cull_uploaded              = false;
+  text_batch->draws_culled               = false;
+
+  if (text_batch->capacity > TEXT_BATCH_MIN_CAPACITY &&
+      instances_count <= text_batch->capacity / 4) {
+    text_batch->low_use_frames_count += 1;
+  } else {
+    text_batch->low_use_frames_count = 0;
+  }
+
+  if (text_batch->instances_chunks.empty() || instances_count == 0) { return; }
+  SDL_assert(text_batch->instances_frame_number == text_batch->upload_scheduler->frame_number);
+  text_batch_read_cull_stats(text_batch);
 
-  {
-    Text_Batch_Instance* mapped_ptr = static_cast<Text_Batch_Instance*>(
-        SDL_MapGPUTransferBuffer(device, text_batch->transfer_buffer, true));
-    if (mapped_ptr == nullptr) {
-      SDL_LogError(
-          SDL_LOG_CATEGORY_APPLICATION,
-          "Failed to map transfer buffer: %s",
-          SDL_GetError());
+  auto frame = &text_batch->frames[text_batch->upload_scheduler->frame_index];
+  if (frame->capacity != text_batch->capacity) {
+    if (!text_batch_resize_data_buffer(text_batch, text_batch->capacity)) {
+      text_batch->instances_count = 0;
       return;
     }
-    defer(SDL_UnmapGPUTransferBuffer(device, text_batch->transfer_buffer));
+  }
+
+  // Draw commands whose instances are unchanged keep their range, the others are appended.
+  text_batch_order_draw_cmds(text_batch);
+  const auto& order           = text_batch->draw_cmds_order;
+  auto&       ranges          = frame->ranges;
+  int         instances_end   = frame->instances_end;
+  auto        is_unchanged    = [&](size_t i) {
+    const auto& draw_cmd = text_batch->draw_cmds[i];
+    return i < ranges.size() && ranges[i].hash == draw_cmd.instances_hash &&
+           ranges[i].instances_count == draw_cmd.instances_count;
+  };
+  int unchanged_count = 0;
+  for (auto i : order) {
+    auto& draw_cmd = text_batch->draw_cmds[i];
+    if (is_unchanged(i)) {
+      draw_cmd.buffer_first_instance = ranges[i].first_instance;
+      unchanged_count += 1;
+    } else {
+      draw_cmd.buffer_first_instance = instances_end;
+      instances_end += draw_cmd.instances_count;
+    }
+  }
+
+  // With nothing to keep or no room left, every instance is uploaded packed from the start.
+  if (unchanged_count == 0 || instances_end > frame->capacity) {
+    if (unchanged_count > 0) { text_batch->stats.repack_count += 1; }
+    instances_end = 0;
+    for (auto i : order) {
+      auto& draw_cmd                  = text_batch->draw_cmds[i];
+      draw_cmd.buffer_first_instance  = instances_end;
+      instances_end                  += draw_cmd.instances_count;
+    }
+    ranges.clear();
+  }
+
+  // Appended draw commands that are also adjacent in the allocation go in one copy, split at the
+  // chunk boundaries it crosses.
+  const auto& chunks         = text_batch->instances_chunks;
+  uint32_t    uploaded_count = 0;
+  int         copy_first     = 0;
+  int         copy_dest      = 0;
+  int         copy_count     = 0;
+  auto        flush_copy     = [&]() {
+    if (copy_count == 0) { return; }
+    for (size_t i = 0; i < chunks.size(); i++) {
+      int chunk_end = i + 1 < chunks.size() ? chunks[i + 1].first_instance : instances_count;
+      int first     = SDL_max(copy_first, chunks[i].first_instance);
+      int end       = SDL_min(copy_first + copy_count, chunk_end);
+      if (first >= end) { continue; }
+      upload_scheduler_upload_to_buffer(
+          text_batch->upload_scheduler,
+          chunks[i].allocation,
+          static_cast<uint32_t>(sizeof(Text_Batch_Instance) * (first - chunks[i].first_instance)),
+          frame->data_buffer,
+          static_cast<uint32_t>(sizeof(Text_Batch_Instance) * (copy_dest + first - copy_first)),
+          static_cast<uint32_t>(sizeof(Text_Batch_Instance) * (end - first)));
+    }
+    uploaded_count += static_cast<uint32_t>(copy_count);
+    copy_count = 0;
+  };
+  for (auto i : order) {
+    const auto& draw_cmd = text_batch->draw_cmds[i];
+    if (is_unchanged(i)) { continue; }
+    if (copy_first + copy_count != draw_cmd.first_instance ||
+        copy_dest + copy_count != draw_cmd.buffer_first_instance) {
+      flush_copy();
+      copy_first = draw_cmd.first_instance;
+      copy_dest  = draw_cmd.buffer_first_instance;
+    }
+    copy_count += draw_cmd.instances_count;
+  }
+  flush_copy();
+
+  ranges.resize(text_batch->draw_cmds.size());
+  for (size_t i = 0; i < text_batch->draw_cmds.size(); i++) {
+    const auto& draw_cmd      = text_batch->draw_cmds[i];
+    ranges[i].hash            = draw_cmd.instances_hash;
+    ranges[i].first_instance  = draw_cmd.buffer_first_instance;
+    ranges[i].instances_count = draw_cmd.instances_count;
+  }
+  frame->instances_end = instances_end;
+
+  text_batch->stats.uploaded_bytes = sizeof(Text_Batch_Instance) * uploaded_count;
+  text_batch->stats.reused_bytes =
+      sizeof(Text_Batch_Instance) * (static_cast<uint32_t>(instances_count) - uploaded_count);
+
+  // Draw parameters are few, they are uploaded every frame. Without them nothing is drawn.
+  text_batch_build_draws(text_batch);
+  int      draw_params_count = static_cast<int>(text_batch->draw_params.size());
+  uint32_t draw_params_size  = sizeof(Text_Batch_Draw_Params) * draw_params_count;
+  if (frame->draw_params_capacity < draw_params_count &&
+      !text_batch_resize_draw_params_buffer(text_batch, draw_params_count)) {
+    text_batch->draws.clear();
+    return;
+  }
+  Upload_Allocation allocation;
+  if (!upload_scheduler_allocate(
+          text_batch->upload_scheduler,
+          UPLOAD_CLIENT_TEXT_BATCH,
+          draw_params_size,
+          &allocation)) {
+    text_batch->draws.clear();
+    return;
+  }
+  SDL_memcpy(allocation.ptr, text_batch->draw_params.data(), draw_params_size);
+  upload_scheduler_upload_to_buffer(
+      text_batch->upload_scheduler,
+      allocation,
+      0,
+      frame->draw_params_buffer,
+      0,
+      draw_params_size);
+  text_batch->stats.uploaded_bytes += draw_params_size;
+
+  // Without their cull tables, draws are drawn whole.
+  if (!text_batch->gpu_culling || !text_batch_build_cull_tables(text_batch) ||
+      !text_batch_reserve_cull_buffers(text_batch)) {
+    return;
+  }
+  uint32_t cull_draws_size  = sizeof(Text_Batch_Cull_Draw) * text_batch->cull_draws.size();
+  uint32_t cull_blocks_size = sizeof(uint32_t) * text_batch->cull_blocks.size();
+  if (!upload_scheduler_allocate(
+          text_batch->upload_scheduler,
+          UPLOAD_CLIENT_TEXT_BATCH,
+          cull_draws_size + cull_blocks_size,
+          &allocation)) {
+    return;
+  }
+  SDL_memcpy(allocation.ptr, text_batch->cull_draws.data(), cull_draws_size);
+  SDL_memcpy(allocation.ptr + cull_draws_size, text_batch->cull_blocks.data(), cull_blocks_size);
+  upload_scheduler_upload_to_buffer(
+      text_batch->upload_scheduler,
+      allocation,
+      0,
+      frame->cull_draws_buffer,
+      0,
+      cull_draws_size);
+  upload_scheduler_upload_to_buffer(
+      text_batch->upload_scheduler,
+      allocation,
+      cull_draws_size,
+      frame->cull_blocks_buffer,
+      0,
+      cull_blocks_size);
+  text_batch->stats.uploaded_bytes += cull_draws_size + cull_blocks_size;
+  text_batch->cull_uploaded = true;
+}
 
-    SDL_memcpy(
-        mapped_ptr,
-        text_batch->instances,
-        sizeof(Text_Batch_Instance) * text_batch->total_instances_count);
+// Culls the instances of the frame's draws on the GPU once text_batch_prepare_draw_cmds uploaded
+// their cull tables, with gpu_culling. The visible instances of each draw are compacted, in order,
+// into the visible buffer from the draw's first instance on, and the draw's indirect arguments
+// cover them only. Dispatches of a compute pass aren't synchronized with each other, each of the
+// three steps has a pass of its own:
+// - cull_count counts the visible instances of every block,
+// - cull_scan turns the counts of each draw's blocks into offsets and writes the draw arguments,
+// - cull_compact culls again and writes the index of each visible instance at its block's offset
+//   plus its rank within the block.
+// Each buffer is cycled by the first pass that writes it, which writes all of it that is read
+// later. A copy pass then downloads the draw arguments for the culling stats. Call after
+// upload_scheduler_flush and before the render pass of text_batch_render_draw_cmds.
+static void text_batch_cull_draw_cmds(Text_Batch* text_batch, SDL_GPUCommandBuffer* cmd_buf) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(cmd_buf != nullptr);
+
+  if (!text_batch->cull_uploaded || text_batch->draws.empty()) { return; }
+  text_batch->cull_uploaded = false;
+
+  auto& frame        = text_batch->frames[text_batch->upload_scheduler->frame_index];
+  auto  draws_count  = static_cast<uint32_t>(text_batch->cull_draws.size());
+  auto  blocks_count = static_cast<uint32_t>(text_batch->cull_blocks.size());
+
+  Cull_Uniform_Data uniforms = {};
+  uniforms.draw_params_count = static_cast<uint32_t>(text_batch->draw_params.size());
+  uniforms.draws_count       = draws_count;
+  uniforms.blocks_count      = blocks_count;
+  SDL_PushGPUComputeUniformData(cmd_buf, 0, &uniforms, sizeof(uniforms));
+
+  {
+    SDL_GPUStorageBufferReadWriteBinding binding = {};
+    binding.buffer                               = text_batch->block_offsets_buffer;
+    binding.cycle                                = true;
+    auto compute_pass = SDL_BeginGPUComputePass(cmd_buf, nullptr, 0, &binding, 1);
+    SDL_BindGPUComputePipeline(compute_pass, text_batch->pipeline_cull_count);
+    SDL_GPUBuffer* storage_buffers[] = {
+        frame.data_buffer,
+        text_batch->glyph_metrics_buffer,
+        frame.draw_params_buffer,
+        frame.cull_draws_buffer,
+        frame.cull_blocks_buffer};
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, storage_buffers, 5);
+    SDL_DispatchGPUCompute(compute_pass, blocks_count, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
   }
 
   {
-    auto copy_pass = SDL_BeginGPUCopyPass(cmd_buf);
-    defer(SDL_EndGPUCopyPass(copy_pass));
+    SDL_GPUStorageBufferReadWriteBinding bindings[2] = {};
+    bindings[0].buffer                               = text_batch->block_offsets_buffer;
+    bindings[1].buffer                               = text_batch->indirect_buffer;
+    bindings[1].cycle                                = true;
+    auto compute_pass = SDL_BeginGPUComputePass(cmd_buf, nullptr, 0, bindings, 2);
+    SDL_BindGPUComputePipeline(compute_pass, text_batch->pipeline_cull_scan);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, &frame.cull_draws_buffer, 1);
+    SDL_DispatchGPUCompute(
+        compute_pass,
+        (draws_count + TEXT_BATCH_CULL_SCAN_GROUP_SIZE - 1) / TEXT_BATCH_CULL_SCAN_GROUP_SIZE,
+        1,
+        1);
+    SDL_EndGPUComputePass(compute_pass);
+  }
 
-    SDL_GPUTransferBufferLocation source = {};
-    source.transfer_buffer               = text_batch->transfer_buffer;
-    SDL_GPUBufferRegion dest             = {};
-    dest.buffer                          = text_batch->data_buffer;
-    dest.size = sizeof(Text_Batch_Instance) * text_batch->total_instances_count;
-    SDL_UploadToGPUBuffer(copy_pass, &source, &dest, true);
+  {
+    SDL_GPUStorageBufferReadWriteBinding binding = {};
+    binding.buffer                               = text_batch->visible_buffer;
+    binding.cycle                                = true;
+    auto compute_pass = SDL_BeginGPUComputePass(cmd_buf, nullptr, 0, &binding, 1);
+    SDL_BindGPUComputePipeline(compute_pass, text_batch->pipeline_cull_compact);
+    SDL_GPUBuffer* storage_buffers[] = {
+        frame.data_buffer,
+        text_batch->glyph_metrics_buffer,
+        frame.draw_params_buffer,
+        frame.cull_draws_buffer,
+        frame.cull_blocks_buffer,
+        text_batch->block_offsets_buffer};
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, storage_buffers, 6);
+    SDL_DispatchGPUCompute(compute_pass, blocks_count, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
   }
+
+  {
+    SDL_GPUBufferRegion source = {};
+    source.buffer              = text_batch->indirect_buffer;
+    source.size                = sizeof(SDL_GPUIndirectDrawCommand) * draws_count;
+    SDL_GPUTransferBufferLocation dest = {};
+    dest.transfer_buffer               = frame.cull_readback_buffer;
+    auto copy_pass                     = SDL_BeginGPUCopyPass(cmd_buf);
+    SDL_DownloadFromGPUBuffer(copy_pass, &source, &dest);
+    SDL_EndGPUCopyPass(copy_pass);
+  }
+
+  int tested_count = 0;
+  for (const auto& draw : text_batch->draws) { tested_count += draw.instances_count; }
+  frame.cull_readback_draws_count  = static_cast<int>(draws_count);
+  frame.cull_readback_tested_count = tested_count;
+  text_batch->draws_culled         = true;
 }
 
 static void text_batch_render_draw_cmds(
@@ -591,59 +2315,56 @@ static void text_batch_render_draw_cmds(
   SDL_assert(render_pass != nullptr);
   SDL_assert(!text_batch->begin_called);
 
-  if (text_batch->draw_cmds_count == 0) { return; }
-
-  SDL_BindGPUVertexStorageBuffers(render_pass, 0, &text_batch->data_buffer, 1);
-
-  for (int i = 0; i < text_batch->draw_cmds_count; i++) {
-    const auto& draw_cmd = text_batch->draw_cmds[i];
+  if (text_batch->draws.empty()) {
+    text_batch_reset(text_batch);
+    return;
+  }
 
-    SDL_BindGPUGraphicsPipeline(render_pass, draw_cmd.pipeline);
+  const auto& frame  = text_batch->frames[text_batch->upload_scheduler->frame_index];
+  bool        culled = text_batch->draws_culled;
+  text_batch_push_uniforms(
+      cmd_buf,
+      {},
+      static_cast<int>(text_batch->draw_params.size()),
+      culled);
+
+  for (size_t i = 0; i < text_batch->draws.size(); i++) {
+    const auto& draw = text_batch->draws[i];
+
+    // Resources are bound per pipeline, the font atlas array covers every draw command. Without
+    // culling, the data buffer stands in for the visible buffer the shader declares.
+    if (draw.bind_pipeline) {
+      SDL_BindGPUGraphicsPipeline(
+          render_pass,
+          text_batch_graphics_pipeline(*text_batch, draw.pipeline));
+      SDL_GPUBuffer* storage_buffers[] = {
+          frame.data_buffer,
+          text_batch->glyph_metrics_buffer,
+          frame.draw_params_buffer,
+          culled ? text_batch->visible_buffer : frame.data_buffer};
+      SDL_BindGPUVertexStorageBuffers(render_pass, 0, storage_buffers, 4);
 
-    {
       SDL_GPUTextureSamplerBinding binding = {};
-      binding.texture                      = draw_cmd.font_atlas->texture;
+      binding.texture                      = text_batch->font_atlas_texture;
       binding.sampler                      = text_batch->sampler;
       SDL_BindGPUFragmentSamplers(render_pass, 0, &binding, 1);
     }
 
-    {
-      Vertex_Uniform_Data uniforms     = {};
-      uniforms.world_to_clip_transform = draw_cmd.world_to_clip_transform;
-      uniforms.first_instance          = static_cast<uint32_t>(draw_cmd.first_instance);
-      SDL_PushGPUVertexUniformData(cmd_buf, 0, &uniforms, sizeof(uniforms));
-    }
-
-    {
-      auto font_size = draw_cmd.font_atlas->size;
-      auto unit_range =
-          HMM_V2(draw_cmd.font_atlas->distance_range, draw_cmd.font_atlas->distance_range) /
-          HMM_V2(draw_cmd.font_atlas->width, draw_cmd.font_atlas->height);
-
-      if (draw_cmd.pipeline == text_batch->pipeline_basic) {
-        Fragment_Uniform_Data_Basic uniforms = {};
-        uniforms.font_size                   = font_size;
-        uniforms.unit_range                  = unit_range;
-        SDL_PushGPUFragmentUniformData(cmd_buf, 0, &uniforms, sizeof(uniforms));
-      } else if (draw_cmd.pipeline == text_batch->pipeline_outline) {
-        Fragment_Uniform_Data_Outline uniforms = {};
-        uniforms.font_size                     = font_size;
-        uniforms.unit_range                    = unit_range;
-        uniforms.outline_color                 = draw_cmd.outline_color;
-        uniforms.outline_thickness             = draw_cmd.outline_thickness;
-        SDL_PushGPUFragmentUniformData(cmd_buf, 0, &uniforms, sizeof(uniforms));
-      }
+    if (culled) {
+      SDL_DrawGPUPrimitivesIndirect(
+          render_pass,
+          text_batch->indirect_buffer,
+          static_cast<uint32_t>(sizeof(SDL_GPUIndirectDrawCommand) * i),
+          1);
+    } else {
+      SDL_DrawGPUPrimitives(
+          render_pass,
+          draw.instances_count * TEXT_BATCH_INDICES_PER_INSTANCE,
+          1,
+          draw.first_instance * TEXT_BATCH_INDICES_PER_INSTANCE,
+          0);
     }
-
-    SDL_DrawGPUPrimitives(
-        render_pass,
-        draw_cmd.instances_count * TEXT_BATCH_INDICES_PER_INSTANCE,
-        1,
-        0,
-        0);
   }
 
-  text_batch->draw_cmds_count = 0;
-  SDL_memset(text_batch->draw_cmds, 0, sizeof(text_batch->draw_cmds));
-  text_batch->total_instances_count = 0;
+  text_batch_reset(text_batch);
 }
@@ -1,95 +1,397 @@
-#ifdef VERTEX_SHADER
+// Effect flags of a draw command, read by the uber fragment shader. Matches Text_Batch_Effect.
+// EFFECT_TRUE_DISTANCE is set for MTSDF atlases, whose alpha holds the true distance.
+static const uint EFFECT_OUTLINE       = 1;
+static const uint EFFECT_SHADOW        = 2;
+static const uint EFFECT_GLOW          = 4;
+static const uint EFFECT_BLUR          = 8;
+static const uint EFFECT_TRUE_DISTANCE = 256;
+
+#if defined(VERTEX_SHADER) || defined(COMPUTE_SHADER)
+// glyph_size holds the glyph index in its low 16 bits and the half float size in its high 16 bits.
+// color is RGBA8 with red in the lowest byte.
 struct Instance_Data {
-  float3 position;
-  float  size;
-  float4 color;
+  float2 position;
+  uint   glyph_size;
+  uint   color;
+};
+
+struct Glyph_Metrics {
   float4 plane_bounds;
   float4 atlas_bounds;
+  uint   layer;
+  uint3  padding;
+};
+
+// Parameters of a draw command, first_instance is where its instances start in the data buffer.
+// unit_range is the distance range of the font atlas over its layer size. The effect parameters
+// are only read by the uber fragment shader, and by the outline one for the outline.
+struct Draw_Params {
+  float4x4 world_to_clip_transform;
+  float4   outline_color;
+  float4   shadow_color;
+  float4   glow_color;
+  uint     first_instance;
+  float    position_z;
+  float    unit_range;
+  float    outline_thickness;
+  float2   shadow_offset;
+  float    shadow_softness;
+  float    glow_thickness;
+  uint     effects;
+  float    blur_radius;
+  uint2    padding;
+};
+#endif
+
+#ifdef COMPUTE_SHADER
+// A draw as culled, its blocks of CULL_GROUP_SIZE instances are first_block onwards in
+// Cull_Blocks_Buffer, which holds the index of the draw of each block. Matches
+// Text_Batch_Cull_Draw.
+struct Cull_Draw {
+  uint first_instance;
+  uint instances_count;
+  uint first_block;
+  uint blocks_count;
 };
 
+// Matches SDL_GPUIndirectDrawCommand.
+struct Indirect_Draw {
+  uint num_vertices;
+  uint num_instances;
+  uint first_vertex;
+  uint first_instance;
+};
+
+static const uint CULL_GROUP_SIZE      = 256;
+static const uint CULL_SCAN_GROUP_SIZE = 64;
+
+cbuffer Uniform_Block : register(b0, space2) {
+  uint draw_params_count;
+  uint draws_count;
+  uint blocks_count;
+};
+
+#if defined(CULL_COUNT) || defined(CULL_COMPACT)
 StructuredBuffer<Instance_Data> Data_Buffer : register(t0, space0);
+StructuredBuffer<Glyph_Metrics> Glyph_Metrics_Buffer : register(t1, space0);
+StructuredBuffer<Draw_Params>   Draw_Params_Buffer : register(t2, space0);
+StructuredBuffer<Cull_Draw>     Cull_Draws_Buffer : register(t3, space0);
+StructuredBuffer<uint>          Cull_Blocks_Buffer : register(t4, space0);
+#endif
+#ifdef CULL_COUNT
+RWStructuredBuffer<uint> Block_Offsets_Buffer : register(u0, space1);
+#endif
+#ifdef CULL_SCAN
+StructuredBuffer<Cull_Draw>       Cull_Draws_Buffer : register(t0, space0);
+RWStructuredBuffer<uint>          Block_Offsets_Buffer : register(u0, space1);
+RWStructuredBuffer<Indirect_Draw> Indirect_Buffer : register(u1, space1);
+#endif
+#ifdef CULL_COMPACT
+StructuredBuffer<uint>   Block_Offsets_Buffer : register(t5, space0);
+RWStructuredBuffer<uint> Visible_Buffer : register(u0, space1);
+#endif
+#endif
 
+#ifdef VERTEX_SHADER
+StructuredBuffer<Instance_Data> Data_Buffer : register(t0, space0);
+StructuredBuffer<Glyph_Metrics> Glyph_Metrics_Buffer : register(t1, space0);
+StructuredBuffer<Draw_Params>   Draw_Params_Buffer : register(t2, space0);
+StructuredBuffer<uint>          Visible_Buffer : register(t3, space0);
+
+// shadow_glow holds the shadow offset in texture coordinates, the shadow softness and the glow
+// thickness.
 struct Output {
   float2                 texcoord : TEXCOORD0;
   nointerpolation float4 color : TEXCOORD1;
   nointerpolation float  size : TEXCOORD2;
+  nointerpolation uint   layer : TEXCOORD3;
+  nointerpolation float  unit_range : TEXCOORD4;
+  nointerpolation float4 outline_color : TEXCOORD5;
+  nointerpolation float  outline_thickness : TEXCOORD6;
+  nointerpolation float4 atlas_bounds : TEXCOORD7;
+  nointerpolation float4 shadow_color : TEXCOORD8;
+  nointerpolation float4 glow_color : TEXCOORD9;
+  nointerpolation float4 shadow_glow : TEXCOORD10;
+  nointerpolation uint   effects : TEXCOORD11;
+  nointerpolation float  blur_radius : TEXCOORD12;
   float4                 position : SV_Position;
 };
 
+// A Text_Batch draws the instances of many draw commands at once, each with its parameters in
+// Draw_Params_Buffer, sorted by first_instance. Without draw_params_count, as for a Text_Static,
+// all instances use the parameters of the uniform block. With culled, the vertices of a draw are
+// of the instances listed in Visible_Buffer instead of those of the data buffer.
 cbuffer Uniform_Block : register(b0, space1) {
   float4x4 world_to_clip_transform : packoffset(c0);
-  uint     first_instance : packoffset(c4);
+  float4   outline_color : packoffset(c4);
+  float4   shadow_color : packoffset(c5);
+  float4   glow_color : packoffset(c6);
+  uint     first_instance : packoffset(c7.x);
+  float    position_z : packoffset(c7.y);
+  float    unit_range : packoffset(c7.z);
+  float    outline_thickness : packoffset(c7.w);
+  float2   shadow_offset : packoffset(c8.x);
+  float    shadow_softness : packoffset(c8.z);
+  float    glow_thickness : packoffset(c8.w);
+  uint     effects : packoffset(c9.x);
+  float    blur_radius : packoffset(c9.y);
+  uint     draw_params_count : packoffset(c10.x);
+  uint     culled : packoffset(c10.y);
 }
 
 static const uint TRIANGLE_INDICES[6] = {0, 1, 2, 3, 2, 1};
+#endif
+
+#if defined(VERTEX_SHADER) || defined(CULL_COUNT) || defined(CULL_COMPACT)
+// Binary search for the last draw command starting at or before the instance.
+Draw_Params find_draw_params(uint instance_index) {
+  uint low  = 0;
+  uint high = draw_params_count - 1;
+  while (low < high) {
+    uint middle = (low + high + 1) / 2;
+    if (Draw_Params_Buffer[middle].first_instance <= instance_index) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return Draw_Params_Buffer[low];
+}
+
+// Quad of an instance's glyph, as its x0, y0, x1, y1 corners.
+float4 glyph_quad(Instance_Data instance, Glyph_Metrics glyph) {
+  float size = f16tof32(instance.glyph_size >> 16);
+  return instance.position.xyxy + glyph.plane_bounds * size;
+}
+#endif
 
+#ifdef VERTEX_SHADER
+// The draw's first vertex selects its first instance, so a single draw covers the instances of
+// any number of draw commands. A culled draw's first vertex selects where its visible instances
+// start in Visible_Buffer instead.
 Output main(uint id : SV_VertexID) {
-  uint          instance_index = id / 6;
+  uint          instance_index = culled != 0 ? Visible_Buffer[id / 6] : id / 6;
   uint          vertex_index   = TRIANGLE_INDICES[id % 6];
-  Instance_Data instance       = Data_Buffer[first_instance + instance_index];
+  Instance_Data instance       = Data_Buffer[instance_index];
+  Glyph_Metrics glyph          = Glyph_Metrics_Buffer[instance.glyph_size & 0xFFFF];
+  float         size           = f16tof32(instance.glyph_size >> 16);
+  float4        color          = float4(
+      instance.color & 0xFF,
+      (instance.color >> 8) & 0xFF,
+      (instance.color >> 16) & 0xFF,
+      instance.color >> 24) / 255.0f;
 
-  float x0 = instance.position.x + instance.plane_bounds.x * instance.size;
-  float y0 = instance.position.y + instance.plane_bounds.y * instance.size;
-  float x1 = instance.position.x + instance.plane_bounds.z * instance.size;
-  float y1 = instance.position.y + instance.plane_bounds.w * instance.size;
+  Draw_Params params;
+  if (draw_params_count > 0) {
+    params = find_draw_params(instance_index);
+  } else {
+    params.world_to_clip_transform = world_to_clip_transform;
+    params.outline_color           = outline_color;
+    params.shadow_color            = shadow_color;
+    params.glow_color              = glow_color;
+    params.first_instance          = first_instance;
+    params.position_z              = position_z;
+    params.unit_range              = unit_range;
+    params.outline_thickness       = outline_thickness;
+    params.shadow_offset           = shadow_offset;
+    params.shadow_softness         = shadow_softness;
+    params.glow_thickness          = glow_thickness;
+    params.effects                 = effects;
+    params.blur_radius             = blur_radius;
+    params.padding                 = uint2(0, 0);
+  }
 
+  float4 quad               = glyph_quad(instance, glyph);
   float2 vertex_position[4] = {
-      {x0, y0},
-      {x1, y0},
-      {x0, y1},
-      {x1, y1},
+      quad.xy,
+      quad.zy,
+      quad.xw,
+      quad.zw,
   };
   float2 vertex_texcoord[4] = {
-      {instance.atlas_bounds.x, instance.atlas_bounds.y},
-      {instance.atlas_bounds.z, instance.atlas_bounds.y},
-      {instance.atlas_bounds.x, instance.atlas_bounds.w},
-      {instance.atlas_bounds.z, instance.atlas_bounds.w}};
+      {glyph.atlas_bounds.x, glyph.atlas_bounds.y},
+      {glyph.atlas_bounds.z, glyph.atlas_bounds.y},
+      {glyph.atlas_bounds.x, glyph.atlas_bounds.w},
+      {glyph.atlas_bounds.z, glyph.atlas_bounds.w}};
 
   Output output;
   output.position =
-      mul(world_to_clip_transform,
-          float4(vertex_position[vertex_index], instance.position.z, 1.0f));
-  output.texcoord = vertex_texcoord[vertex_index];
-  output.size     = instance.size;
-  output.color    = instance.color;
+      mul(params.world_to_clip_transform,
+          float4(vertex_position[vertex_index], params.position_z, 1.0f));
+  output.texcoord          = vertex_texcoord[vertex_index];
+  output.size              = size;
+  output.color             = color;
+  output.layer             = glyph.layer;
+  output.unit_range        = params.unit_range;
+  output.outline_color     = params.outline_color;
+  output.outline_thickness = params.outline_thickness;
+  output.atlas_bounds      = glyph.atlas_bounds;
+  output.shadow_color      = params.shadow_color;
+  output.glow_color        = params.glow_color;
+  output.effects           = params.effects;
+  output.blur_radius       = params.blur_radius;
+  output.shadow_glow       = float4(
+      params.shadow_offset * params.unit_range,
+      params.shadow_softness,
+      params.glow_thickness);
 
   return output;
 }
 #endif
 
+#if defined(CULL_COUNT) || defined(CULL_COMPACT)
+// Whether a glyph quad is outside the clip volume: all four of its corners beyond the same side
+// plane, or behind the eye. Text is rarely cut by the near and far planes, which aren't tested.
+bool is_quad_culled(float4 quad, float position_z, float4x4 world_to_clip_transform) {
+  float4 p0 = mul(world_to_clip_transform, float4(quad.xy, position_z, 1.0f));
+  float4 p1 = mul(world_to_clip_transform, float4(quad.zy, position_z, 1.0f));
+  float4 p2 = mul(world_to_clip_transform, float4(quad.xw, position_z, 1.0f));
+  float4 p3 = mul(world_to_clip_transform, float4(quad.zw, position_z, 1.0f));
+  float4 x  = float4(p0.x, p1.x, p2.x, p3.x);
+  float4 y  = float4(p0.y, p1.y, p2.y, p3.y);
+  float4 w  = float4(p0.w, p1.w, p2.w, p3.w);
+  return all(x < -w) || all(x > w) || all(y < -w) || all(y > w) || all(w <= 0.0f);
+}
+
+// Whether the instance of a thread is visible, the thread's index within its group picks the
+// instance within the group's block. Threads past the end of their draw have none.
+bool is_instance_visible(uint block_index, uint thread_index, out uint instance_index) {
+  Cull_Draw draw   = Cull_Draws_Buffer[Cull_Blocks_Buffer[block_index]];
+  uint      offset = (block_index - draw.first_block) * CULL_GROUP_SIZE + thread_index;
+  instance_index   = draw.first_instance + offset;
+  if (offset >= draw.instances_count) { return false; }
+
+  Instance_Data instance = Data_Buffer[instance_index];
+  Glyph_Metrics glyph    = Glyph_Metrics_Buffer[instance.glyph_size & 0xFFFF];
+  Draw_Params   params   = find_draw_params(instance_index);
+  return !is_quad_culled(
+      glyph_quad(instance, glyph),
+      params.position_z,
+      params.world_to_clip_transform);
+}
+#endif
+
+#ifdef CULL_COUNT
+groupshared uint visible_count;
+
+// Counts the visible instances of a block into its entry of Block_Offsets_Buffer.
+[numthreads(CULL_GROUP_SIZE, 1, 1)]
+void main(uint3 group_id : SV_GroupID, uint thread_index : SV_GroupIndex) {
+  if (thread_index == 0) { visible_count = 0; }
+  GroupMemoryBarrierWithGroupSync();
+
+  uint instance_index;
+  if (is_instance_visible(group_id.x, thread_index, instance_index)) {
+    InterlockedAdd(visible_count, 1);
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  if (thread_index == 0) { Block_Offsets_Buffer[group_id.x] = visible_count; }
+}
+#endif
+
+#ifdef CULL_SCAN
+// One thread per draw turns the visible counts of the draw's blocks into where their visible
+// instances start, relative to the draw's, and writes the draw's arguments. Draws rarely have more
+// than a few blocks, walking them serially is cheaper than another pass.
+[numthreads(CULL_SCAN_GROUP_SIZE, 1, 1)]
+void main(uint3 dispatch_id : SV_DispatchThreadID) {
+  uint draw_index = dispatch_id.x;
+  if (draw_index >= draws_count) { return; }
+
+  Cull_Draw draw          = Cull_Draws_Buffer[draw_index];
+  uint      visible_count = 0;
+  for (uint i = 0; i < draw.blocks_count; i++) {
+    uint block                   = draw.first_block + i;
+    uint count                   = Block_Offsets_Buffer[block];
+    Block_Offsets_Buffer[block]  = visible_count;
+    visible_count               += count;
+  }
+
+  Indirect_Draw command;
+  command.num_vertices        = visible_count * 6;
+  command.num_instances       = 1;
+  command.first_vertex        = draw.first_instance * 6;
+  command.first_instance      = 0;
+  Indirect_Buffer[draw_index] = command;
+}
+#endif
+
+#ifdef CULL_COMPACT
+groupshared uint visible_ranks[CULL_GROUP_SIZE];
+
+// Culls a block again and writes the index of each visible instance in order, at the offset of its
+// block plus the number of visible instances before it in the block, an inclusive prefix sum over
+// the group.
+[numthreads(CULL_GROUP_SIZE, 1, 1)]
+void main(uint3 group_id : SV_GroupID, uint thread_index : SV_GroupIndex) {
+  uint instance_index;
+  bool visible                = is_instance_visible(group_id.x, thread_index, instance_index);
+  visible_ranks[thread_index] = visible ? 1 : 0;
+  GroupMemoryBarrierWithGroupSync();
+
+  for (uint stride = 1; stride < CULL_GROUP_SIZE; stride *= 2) {
+    uint rank = thread_index >= stride ? visible_ranks[thread_index - stride] : 0;
+    GroupMemoryBarrierWithGroupSync();
+    visible_ranks[thread_index] += rank;
+    GroupMemoryBarrierWithGroupSync();
+  }
+
+  if (visible) {
+    Cull_Draw draw  = Cull_Draws_Buffer[Cull_Blocks_Buffer[group_id.x]];
+    uint      index = draw.first_instance + Block_Offsets_Buffer[group_id.x];
+    Visible_Buffer[index + visible_ranks[thread_index] - 1] = instance_index;
+  }
+}
+#endif
+
 #ifdef FRAGMENT_SHADER
-Texture2D<float4> Texture : register(t0, space2);
-SamplerState      Sampler : register(s0, space2);
+Texture2DArray<float4> Texture : register(t0, space2);
+SamplerState           Sampler : register(s0, space2);
 
 struct Input {
   float2                 texcoord : TEXCOORD0;
   nointerpolation float4 color : TEXCOORD1;
   nointerpolation float  size : TEXCOORD2;
+  nointerpolation uint   layer : TEXCOORD3;
+  nointerpolation float  unit_range : TEXCOORD4;
+  nointerpolation float4 outline_color : TEXCOORD5;
+  nointerpolation float  outline_thickness : TEXCOORD6;
+  nointerpolation float4 atlas_bounds : TEXCOORD7;
+  nointerpolation float4 shadow_color : TEXCOORD8;
+  nointerpolation float4 glow_color : TEXCOORD9;
+  nointerpolation float4 shadow_glow : TEXCOORD10;
+  nointerpolation uint   effects : TEXCOORD11;
+  nointerpolation float  blur_radius : TEXCOORD12;
 };
 
-cbuffer Uniform_Block : register(b0, space3) {
-  float  font_size : packoffset(c0);
-  float2 unit_range : packoffset(c0.y);
-#if defined(EFFECT_OUTLINE)
-  float4 outline_color : packoffset(c1.x);
-  float  outline_thickness : packoffset(c2.x);
-#endif
-}
-
-float screen_pixel_range(float2 texcoord, float size) {
+float screen_pixel_range(float2 texcoord, float unit_range) {
   float2 screen_tex_size = 1.0f / fwidth(texcoord);
-  return max(0.5f * dot(unit_range, screen_tex_size), 1.0f);
+  return max(0.5f * dot(float2(unit_range, unit_range), screen_tex_size), 1.0f);
 }
 
 float median(float r, float g, float b) {
   return max(min(r, g), min(max(r, g), b));
 }
 
+// The median of the MSDF channels, and the distance effects reach away from the outline with: the
+// true distance of MTSDF atlases or the median again. Same as Text_Batch_Effect_Sample.
+float2 sample_distances(float2 texcoord, uint layer, uint effects) {
+  float4 mtsd            = Texture.Sample(Sampler, float3(texcoord, layer));
+  float  median_distance = median(mtsd.r, mtsd.g, mtsd.b);
+  return float2(median_distance, (effects & EFFECT_TRUE_DISTANCE) != 0 ? mtsd.a : median_distance);
+}
+
+// Premultiplied colors, top drawn over bottom.
+float4 blend_over(float4 top, float4 bottom) {
+  return top + bottom * (1.0f - top.a);
+}
+
 float4 main(Input input) : SV_Target0 {
 #if defined(EFFECT_BASIC)
-  float3 msd            = Texture.Sample(Sampler, input.texcoord).rgb;
+  float3 msd            = Texture.Sample(Sampler, float3(input.texcoord, input.layer)).rgb;
   float  sd             = median(msd.r, msd.g, msd.b);
-  float  screen_px_dist = screen_pixel_range(input.texcoord, input.size) * (sd - 0.5f);
+  float  screen_px_dist = screen_pixel_range(input.texcoord, input.unit_range) * (sd - 0.5f);
   float  opacity        = clamp(screen_px_dist + 0.5f, 0.0f, 1.0f);
 
   float4 color = input.color;
@@ -98,11 +400,11 @@ float4 main(Input input) : SV_Target0 {
 
   return color;
 #elif defined(EFFECT_OUTLINE)
-  float3 msd = Texture.Sample(Sampler, input.texcoord).rgb;
+  float3 msd = Texture.Sample(Sampler, float3(input.texcoord, input.layer)).rgb;
   float  sd  = median(msd.r, msd.g, msd.b);
   if (sd <= 0.0001f) { discard; }
 
-  float px_range = screen_pixel_range(input.texcoord, input.size);
+  float px_range = screen_pixel_range(input.texcoord, input.unit_range);
 
   static const float mid_body_thickness = -0.1f;
   sd += -0.5f + mid_body_thickness;
@@ -110,17 +412,88 @@ float4 main(Input input) : SV_Target0 {
   float body_px_dist = px_range * sd;
   float body_opacity = smoothstep(-0.5f, 0.5f, body_px_dist);
 
-  float char_px_dist = px_range * (sd + outline_thickness);
+  float char_px_dist = px_range * (sd + input.outline_thickness);
   float char_opacity = smoothstep(-0.5f, 0.5f, char_px_dist);
 
   float outline_opacity = char_opacity - body_opacity;
 
-  float3 color = lerp(outline_color.rgb, input.color.rgb, body_opacity);
-  float  alpha = body_opacity * input.color.a + outline_opacity * outline_color.a;
+  float3 color = lerp(input.outline_color.rgb, input.color.rgb, body_opacity);
+  float  alpha = body_opacity * input.color.a + outline_opacity * input.outline_color.a;
 
   color *= alpha;
 
   return float4(color, alpha);
+#elif defined(EFFECT_UBER)
+  // The effects of every draw command in a single pipeline, the glyph over its shadow over its
+  // glow, in the same invocation. Without effects, the same as the basic fragment shader, and with
+  // the outline alone, the same as the outline one. text_batch_effects_reference in
+  // text_batch.cpp is the CPU reference of the code below, keep them in sync.
+  float2 glyph    = sample_distances(input.texcoord, input.layer, input.effects);
+  float  px_range = screen_pixel_range(input.texcoord, input.unit_range);
+
+  // The blur widens the edge of the glyph by its radius, from the true distance.
+  bool  blur       = (input.effects & EFFECT_BLUR) != 0;
+  float sd         = blur ? glyph.y : glyph.x;
+  float edge_scale = blur ? 1.0f / (input.blur_radius + 1.0f / px_range) : px_range;
+
+  float4 color;
+  if ((input.effects & EFFECT_OUTLINE) != 0) {
+    static const float mid_body_thickness = -0.1f;
+
+    float body_sd         = sd - 0.5f + mid_body_thickness;
+    float char_sd         = body_sd + input.outline_thickness;
+    float body_opacity    = smoothstep(-0.5f, 0.5f, edge_scale * body_sd);
+    float outline_opacity = smoothstep(-0.5f, 0.5f, edge_scale * char_sd) - body_opacity;
+    if (sd <= 0.0001f) {
+      body_opacity    = 0.0f;
+      outline_opacity = 0.0f;
+    }
+
+    color.rgb = lerp(input.outline_color.rgb, input.color.rgb, body_opacity);
+    color.a   = body_opacity * input.color.a + outline_opacity * input.outline_color.a;
+    color.rgb *= color.a;
+  } else {
+    float opacity = clamp(edge_scale * (sd - 0.5f) + 0.5f, 0.0f, 1.0f);
+    color         = input.color;
+    color.a *= opacity;
+    color.rgb *= color.a;
+  }
+
+  // The shadow is the glyph sampled at an offset, kept within the glyph's atlas bounds so that
+  // its neighbors in the atlas don't bleed in. Softness widens its edge by that many distance
+  // ranges.
+  if ((input.effects & EFFECT_SHADOW) != 0) {
+    float width, height, layers;
+    Texture.GetDimensions(width, height, layers);
+    float2 half_texel = 0.5f / float2(width, height);
+    float2 bounds_min = min(input.atlas_bounds.xy, input.atlas_bounds.zw) + half_texel;
+    float2 bounds_max = max(input.atlas_bounds.xy, input.atlas_bounds.zw) - half_texel;
+    float2 texcoord   = clamp(input.texcoord - input.shadow_glow.xy, bounds_min, bounds_max);
+
+    float2 shadow_distances = sample_distances(texcoord, input.layer, input.effects);
+    float  shadow_width     = input.shadow_glow.z + 1.0f / px_range;
+    float  shadow_opacity   = clamp((shadow_distances.y - 0.5f) / shadow_width + 0.5f, 0.0f, 1.0f);
+
+    float4 shadow = input.shadow_color;
+    shadow.a *= shadow_opacity;
+    shadow.rgb *= shadow.a;
+    color = blend_over(color, shadow);
+  }
+
+  // The glow fades out over glow thickness distance ranges outside of the glyph.
+  if ((input.effects & EFFECT_GLOW) != 0) {
+    float glow_thickness = max(input.shadow_glow.w, 1.0f / px_range);
+    float glow_opacity   = smoothstep(0.5f - glow_thickness, 0.5f, glyph.y);
+
+    float4 glow = input.glow_color;
+    glow.a *= glow_opacity;
+    glow.rgb *= glow.a;
+    color = blend_over(color, glow);
+  }
+
+  if (color.a <= 0.0f) { discard; }
+
+  return color;
 #endif
 }
 #endif
@@ -0,0 +1,342 @@
+// Text_Static lays text out once and keeps its glyph instances in a GPU buffer until the text is
+// rebuilt, so drawing it only binds resources and pushes uniforms, whatever its glyph count. It
+// uses the instance format, shaders and pipelines of a Text_Batch.
+//
+// Instances are built on the CPU between text_static_begin and text_static_end, which uploads them
+// in chunks and frees the CPU copy. Only baked font atlases can be used, as glyphs of a dynamic
+// atlas are evicted over time. All text of a Text_Static is drawn at the z position of its first
+// glyph, as instances don't carry one.
+
+static constexpr int TEXT_STATIC_UPLOAD_CHUNK_INSTANCES = 64 * 1024;
+
+struct Text_Static {
+  std::vector<Text_Batch_Instance> instances;
+  Text_Layout_Scratch              layout_scratch;
+  bool                             begin_called;
+  Font_Atlas*                      font_atlas;
+  int                              font_variant;
+  SDL_GPUBuffer*                   data_buffer;
+  int                              instances_count;
+  float                            position_z;
+};
+
+static void text_static_destroy(Text_Static* text_static, SDL_GPUDevice* device) {
+  SDL_assert(text_static != nullptr);
+  SDL_assert(device != nullptr);
+
+  SDL_ReleaseGPUBuffer(device, text_static->data_buffer);
+  text_static->data_buffer     = nullptr;
+  text_static->instances_count = 0;
+  std::vector<Text_Batch_Instance>().swap(text_static->instances);
+  text_static->layout_scratch = {};
+}
+
+// Starts building the text, replacing the previous contents once text_static_end is called.
+static void text_static_begin(Text_Static* text_static, Font_Atlas* font_atlas, int font_variant) {
+  SDL_assert(text_static != nullptr);
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(font_atlas->dynamic == nullptr);
+  SDL_assert(font_variant >= 0 && font_variant < font_atlas->variants.size());
+  SDL_assert(!text_static->begin_called);
+
+  text_static->begin_called = true;
+  text_static->font_atlas   = font_atlas;
+  text_static->font_variant = font_variant;
+  text_static->instances.clear();
+}
+
+// Switches the font of the text drawn next. All fonts of a text must share the size and distance
+// range of the first one, as the text is drawn with a single set of uniforms.
+static void
+text_static_set_font(Text_Static* text_static, Font_Atlas* font_atlas, int font_variant) {
+  SDL_assert(text_static != nullptr);
+  SDL_assert(text_static->begin_called);
+  SDL_assert(font_atlas != nullptr);
+  SDL_assert(font_atlas->dynamic == nullptr);
+  SDL_assert(font_variant >= 0 && font_variant < font_atlas->variants.size());
+  SDL_assert(font_atlas->size == text_static->font_atlas->size);
+  SDL_assert(font_atlas->distance_range == text_static->font_atlas->distance_range);
+
+  text_static->font_atlas   = font_atlas;
+  text_static->font_variant = font_variant;
+}
+
+static void text_static_draw_internal(
+    Text_Static*       text_static,
+    std::string_view   text,
+    HMM_Vec3           position,
+    float              size,
+    Text_Batch_H_Align h_align,
+    Text_Batch_V_Align v_align,
+    HMM_Vec4           color,
+    HMM_Vec2           text_block_size,
+    bool               multiline) {
+  SDL_assert(text_static != nullptr);
+  SDL_assert(text_static->begin_called);
+
+  if (text_static->instances.empty()) { text_static->position_z = position.Z; }
+  SDL_assert(position.Z == text_static->position_z);
+
+  Text_Layout_Params params = {};
+  params.font_atlas         = text_static->font_atlas;
+  params.font_variant       = text_static->font_variant;
+  params.size               = size;
+  params.h_align            = h_align;
+  params.v_align            = v_align;
+  params.text_block_size    = text_block_size;
+  params.multiline          = multiline;
+  text_layout(text, params, &text_static->layout_scratch);
+
+  const auto& glyphs         = text_static->layout_scratch.glyphs;
+  auto        packed_size    = float_to_half(size);
+  auto        packed_color   = pack_color_rgba8(color);
+  auto        origin         = HMM_V2(position.X, position.Y);
+  auto        first_instance = text_static->instances.size();
+  int         glyphs_count   = static_cast<int>(glyphs.glyph.size());
+  text_static->instances.resize(first_instance + glyphs_count);
+  text_batch_write_instances(
+      text_static->instances.data() + first_instance,
+      glyphs,
+      0,
+      glyphs_count,
+      origin,
+      packed_size,
+      packed_color);
+}
+
+static void text_static_draw(
+    Text_Static*       text_static,
+    std::string_view   text,
+    HMM_Vec3           position,
+    float              size,
+    Text_Batch_H_Align h_align = TEXT_BATCH_H_ALIGN_LEFT,
+    Text_Batch_V_Align v_align = TEXT_BATCH_V_ALIGN_TOP,
+    HMM_Vec4           color   = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f)) {
+  text_static_draw_internal(
+      text_static,
+      text,
+      position,
+      size,
+      h_align,
+      v_align,
+      color,
+      HMM_V2(-1.0f, -1.0f),
+      false);
+}
+
+static void text_static_draw_multiline(
+    Text_Static*       text_static,
+    std::string_view   text,
+    HMM_Vec3           position,
+    float              size,
+    Text_Batch_H_Align h_align         = TEXT_BATCH_H_ALIGN_LEFT,
+    Text_Batch_V_Align v_align         = TEXT_BATCH_V_ALIGN_TOP,
+    HMM_Vec4           color           = HMM_V4(1.0f, 1.0f, 1.0f, 1.0f),
+    HMM_Vec2           text_block_size = HMM_V2(-1.0f, -1.0f)) {
+  text_static_draw_internal(
+      text_static,
+      text,
+      position,
+      size,
+      h_align,
+      v_align,
+      color,
+      text_block_size,
+      true);
+}
+
+// Uploads the instances built since text_static_begin into a new data buffer, replacing the
+// previous one. The instances go through a transfer buffer of TEXT_STATIC_UPLOAD_CHUNK_INSTANCES,
+// cycled for every chunk.
+static bool
+text_static_end(Text_Static* text_static, SDL_GPUDevice* device, SDL_GPUCopyPass* copy_pass) {
+  SDL_assert(text_static != nullptr);
+  SDL_assert(text_static->begin_called);
+  SDL_assert(device != nullptr);
+  SDL_assert(copy_pass != nullptr);
+
+  text_static->begin_called = false;
+
+  SDL_ReleaseGPUBuffer(device, text_static->data_buffer);
+  text_static->data_buffer     = nullptr;
+  text_static->instances_count = 0;
+  defer(std::vector<Text_Batch_Instance>().swap(text_static->instances));
+
+  const auto& instances = text_static->instances;
+  if (instances.empty()) { return true; }
+  if (instances.size() > SDL_MAX_UINT32 / sizeof(Text_Batch_Instance)) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Static text has too many glyphs: %d",
+        static_cast<int>(instances.size()));
+    return false;
+  }
+
+  {
+    SDL_GPUBufferCreateInfo info = {};
+    info.size = static_cast<uint32_t>(sizeof(Text_Batch_Instance) * instances.size());
+    info.usage                   = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
+    text_static->data_buffer     = SDL_CreateGPUBuffer(device, &info);
+    if (text_static->data_buffer == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to create data buffer: %s",
+          SDL_GetError());
+      return false;
+    }
+  }
+
+  SDL_GPUTransferBuffer* transfer_buffer;
+  {
+    SDL_GPUTransferBufferCreateInfo info = {};
+    info.size = sizeof(Text_Batch_Instance) * TEXT_STATIC_UPLOAD_CHUNK_INSTANCES;
+    info.usage                           = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    transfer_buffer                      = SDL_CreateGPUTransferBuffer(device, &info);
+    if (transfer_buffer == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to create transfer buffer: %s",
+          SDL_GetError());
+      return false;
+    }
+  }
+  defer(SDL_ReleaseGPUTransferBuffer(device, transfer_buffer));
+
+  for (size_t first = 0; first < instances.size(); first += TEXT_STATIC_UPLOAD_CHUNK_INSTANCES) {
+    auto count =
+        SDL_min(instances.size() - first, static_cast<size_t>(TEXT_STATIC_UPLOAD_CHUNK_INSTANCES));
+    auto size = static_cast<uint32_t>(sizeof(Text_Batch_Instance) * count);
+
+    auto mapped_ptr = SDL_MapGPUTransferBuffer(device, transfer_buffer, true);
+    if (mapped_ptr == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to map transfer buffer: %s",
+          SDL_GetError());
+      return false;
+    }
+    SDL_memcpy(mapped_ptr, &instances[first], size);
+    SDL_UnmapGPUTransferBuffer(device, transfer_buffer);
+
+    SDL_GPUTransferBufferLocation source = {};
+    source.transfer_buffer               = transfer_buffer;
+    SDL_GPUBufferRegion dest             = {};
+    dest.buffer                          = text_static->data_buffer;
+    dest.offset = static_cast<uint32_t>(sizeof(Text_Batch_Instance) * first);
+    dest.size   = size;
+    SDL_UploadToGPUBuffer(copy_pass, &source, &dest, false);
+  }
+
+  text_static->instances_count = static_cast<int>(instances.size());
+
+  return true;
+}
+
+static void text_static_render(
+    const Text_Static&       text_static,
+    Text_Batch*              text_batch,
+    SDL_GPUCommandBuffer*    cmd_buf,
+    SDL_GPURenderPass*       render_pass,
+    SDL_GPUGraphicsPipeline* pipeline,
+    const HMM_Mat4&          world_to_clip_transform,
+    const Text_Batch_Style&  style) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(cmd_buf != nullptr);
+  SDL_assert(render_pass != nullptr);
+  SDL_assert(!text_static.begin_called);
+
+  if (text_static.instances_count == 0) { return; }
+
+  // The draw parameters come from the uniforms and nothing is culled, the glyph metrics buffer
+  // only stands in for the draw parameters and visible buffers the shader declares.
+  SDL_BindGPUGraphicsPipeline(render_pass, pipeline);
+  SDL_GPUBuffer* storage_buffers[] = {
+      text_static.data_buffer,
+      text_batch->glyph_metrics_buffer,
+      text_batch->glyph_metrics_buffer,
+      text_batch->glyph_metrics_buffer};
+  SDL_BindGPUVertexStorageBuffers(render_pass, 0, storage_buffers, 4);
+
+  SDL_GPUTextureSamplerBinding binding = {};
+  binding.texture                      = text_batch->font_atlas_texture;
+  binding.sampler                      = text_batch->sampler;
+  SDL_BindGPUFragmentSamplers(render_pass, 0, &binding, 1);
+
+  auto params = text_batch_draw_params(
+      world_to_clip_transform,
+      text_static.position_z,
+      *text_static.font_atlas,
+      style,
+      0);
+  text_batch_push_uniforms(cmd_buf, params, 0, false);
+
+  SDL_DrawGPUPrimitives(
+      render_pass,
+      static_cast<uint32_t>(text_static.instances_count) * TEXT_BATCH_INDICES_PER_INSTANCE,
+      1,
+      0,
+      0);
+}
+
+static void text_static_render_basic(
+    const Text_Static&    text_static,
+    Text_Batch*           text_batch,
+    SDL_GPUCommandBuffer* cmd_buf,
+    SDL_GPURenderPass*    render_pass,
+    const HMM_Mat4&       world_to_clip_transform) {
+  SDL_assert(text_batch != nullptr);
+
+  text_static_render(
+      text_static,
+      text_batch,
+      cmd_buf,
+      render_pass,
+      text_batch->pipeline_basic,
+      world_to_clip_transform,
+      {});
+}
+
+static void text_static_render_outline(
+    const Text_Static&    text_static,
+    Text_Batch*           text_batch,
+    SDL_GPUCommandBuffer* cmd_buf,
+    SDL_GPURenderPass*    render_pass,
+    const HMM_Mat4&       world_to_clip_transform,
+    HMM_Vec4              outline_color     = HMM_V4(0.0f, 0.0f, 0.0f, 1.0f),
+    float                 outline_thickness = 0.4f) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(outline_thickness >= 0.0f && outline_thickness <= 0.4f);
+
+  Text_Batch_Style style  = {};
+  style.effects           = TEXT_BATCH_EFFECT_OUTLINE;
+  style.outline_color     = outline_color;
+  style.outline_thickness = outline_thickness;
+  text_static_render(
+      text_static,
+      text_batch,
+      cmd_buf,
+      render_pass,
+      text_batch->pipeline_outline,
+      world_to_clip_transform,
+      style);
+}
+
+static void text_static_render_effects(
+    const Text_Static&      text_static,
+    Text_Batch*             text_batch,
+    SDL_GPUCommandBuffer*   cmd_buf,
+    SDL_GPURenderPass*      render_pass,
+    const HMM_Mat4&         world_to_clip_transform,
+    const Text_Batch_Style& style) {
+  SDL_assert(text_batch != nullptr);
+  SDL_assert(text_batch_style_is_valid(style));
+
+  text_static_render(
+      text_static,
+      text_batch,
+      cmd_buf,
+      render_pass,
+      text_batch->pipeline_uber,
+      world_to_clip_transform,
+      style);
+}
@@ -0,0 +1,113 @@
+// A fixed set of worker threads pulling jobs from a shared FIFO queue. Jobs are plain function
+// pointers with a user data pointer; results are written back through that pointer.
+
+using Thread_Pool_Job_Func = void (*)(void* user_data);
+
+struct Thread_Pool_Job {
+  Thread_Pool_Job_Func func;
+  void*                user_data;
+};
+
+struct Thread_Pool {
+  std::vector<SDL_Thread*>    threads;
+  std::deque<Thread_Pool_Job> jobs;
+  SDL_Mutex*                  mutex;
+  SDL_Condition*              job_available;
+  SDL_Condition*              jobs_done;
+  int                         jobs_pending;
+  bool                        quit;
+};
+
+static int thread_pool_worker(void* data) {
+  auto thread_pool = static_cast<Thread_Pool*>(data);
+
+  SDL_LockMutex(thread_pool->mutex);
+  for (;;) {
+    while (thread_pool->jobs.empty() && !thread_pool->quit) {
+      SDL_WaitCondition(thread_pool->job_available, thread_pool->mutex);
+    }
+    if (thread_pool->quit) { break; }
+
+    auto job = thread_pool->jobs.front();
+    thread_pool->jobs.pop_front();
+    SDL_UnlockMutex(thread_pool->mutex);
+
+    job.func(job.user_data);
+
+    SDL_LockMutex(thread_pool->mutex);
+    thread_pool->jobs_pending -= 1;
+    if (thread_pool->jobs_pending == 0) { SDL_BroadcastCondition(thread_pool->jobs_done); }
+  }
+  SDL_UnlockMutex(thread_pool->mutex);
+
+  return 0;
+}
+
+static bool thread_pool_create(Thread_Pool* thread_pool, int threads_count) {
+  SDL_assert(thread_pool != nullptr);
+  SDL_assert(threads_count > 0);
+
+  thread_pool->mutex         = SDL_CreateMutex();
+  thread_pool->job_available = SDL_CreateCondition();
+  thread_pool->jobs_done     = SDL_CreateCondition();
+  if (thread_pool->mutex == nullptr || thread_pool->job_available == nullptr ||
+      thread_pool->jobs_done == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to create thread pool sync primitives: %s",
+        SDL_GetError());
+    return false;
+  }
+
+  for (int i = 0; i < threads_count; i++) {
+    auto thread = SDL_CreateThread(thread_pool_worker, "thread_pool_worker", thread_pool);
+    if (thread == nullptr) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create thread: %s", SDL_GetError());
+      return false;
+    }
+    thread_pool->threads.push_back(thread);
+  }
+
+  return true;
+}
+
+static void thread_pool_destroy(Thread_Pool* thread_pool) {
+  SDL_assert(thread_pool != nullptr);
+
+  if (thread_pool->mutex != nullptr) {
+    SDL_LockMutex(thread_pool->mutex);
+    thread_pool->quit = true;
+    SDL_BroadcastCondition(thread_pool->job_available);
+    SDL_UnlockMutex(thread_pool->mutex);
+  }
+
+  for (auto thread : thread_pool->threads) { SDL_WaitThread(thread, nullptr); }
+  thread_pool->threads.clear();
+  thread_pool->jobs.clear();
+
+  SDL_DestroyCondition(thread_pool->jobs_done);
+  SDL_DestroyCondition(thread_pool->job_available);
+  SDL_DestroyMutex(thread_pool->mutex);
+}
+
+static void thread_pool_push(Thread_Pool* thread_pool, Thread_Pool_Job_Func func, void* user_data) {
+  SDL_assert(thread_pool != nullptr);
+  SDL_assert(func != nullptr);
+
+  SDL_LockMutex(thread_pool->mutex);
+  thread_pool->jobs.push_back({func, user_data});
+  thread_pool->jobs_pending += 1;
+  SDL_SignalCondition(thread_pool->job_available);
+  SDL_UnlockMutex(thread_pool->mutex);
+}
+
+// Blocks until every job pushed so far has finished running.
+static void thread_pool_wait(Thread_Pool* thread_pool) {
+  SDL_assert(thread_pool != nullptr);
+
+  SDL_LockMutex(thread_pool->mutex);
+  while (thread_pool->jobs_pending > 0) {
+    SDL_WaitCondition(thread_pool->jobs_done, thread_pool->mutex);
+  }
+  SDL_UnlockMutex(thread_pool->mutex);
+}
@@ -0,0 +1,407 @@
+// The upload scheduler owns the transfer memory of a frame and records every upload of the frame
+// into a single copy pass. Clients suballocate from the frame's arena, write their data into the
+// returned mapped memory and queue copies from it; upload_scheduler_flush records all of them and
+// upload_scheduler_submit submits the command buffer.
+//
+// Each of the UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT frames has its own arena, reused once the fence of
+// the command buffer that last used it has signaled, so it is neither cycled nor written while the
+// GPU may still read it. Clients with GPU buffers written every frame keep one per frame in flight,
+// indexed by frame_index, and are guarded by the same fence.
+//
+// An arena is one transfer buffer of block_size bytes. A frame that needs more chains extra blocks
+// instead of moving the data already written, block_size then grows to fit the whole frame, and
+// the frame's blocks are replaced by a single one when it comes around again. block_size shrinks
+// back to fit the busiest recent frame after UPLOAD_SCHEDULER_SHRINK_FRAMES frames using a quarter
+// of it or less.
+static constexpr uint32_t UPLOAD_SCHEDULER_MIN_BLOCK_SIZE   = 1024 * 1024;
+static constexpr int      UPLOAD_SCHEDULER_SHRINK_FRAMES    = 600;
+static constexpr int      UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT = 3;
+static constexpr uint32_t UPLOAD_SCHEDULER_ALIGNMENT        = 16;
+
+enum Upload_Client {
+  UPLOAD_CLIENT_TEXT_BATCH,
+  UPLOAD_CLIENT_FONT_ATLAS,
+  UPLOAD_CLIENT_FONT_ATLAS_DYNAMIC,
+  UPLOAD_CLIENT_COUNT,
+};
+
+static constexpr const char* UPLOAD_CLIENT_NAMES[UPLOAD_CLIENT_COUNT] = {
+    "Text Batch",
+    "Font Atlas",
+    "Font Atlas Dynamic",
+};
+
+// Suballocation of a frame's arena. ptr is the mapped memory, valid until the frame is flushed.
+struct Upload_Allocation {
+  uint8_t*               ptr;
+  SDL_GPUTransferBuffer* transfer_buffer;
+  uint32_t               offset;
+  uint32_t               size;
+};
+
+enum Upload_Copy_Kind {
+  UPLOAD_COPY_KIND_BUFFER,
+  UPLOAD_COPY_KIND_TEXTURE,
+  UPLOAD_COPY_KIND_TEXTURE_TO_TEXTURE,
+};
+
+// Copies are recorded in the order they were queued, so a copy can read what an earlier one wrote.
+struct Upload_Copy {
+  Upload_Copy_Kind              kind;
+  SDL_GPUTransferBufferLocation buffer_source;
+  SDL_GPUBufferRegion           buffer_dest;
+  SDL_GPUTextureTransferInfo    texture_source;
+  SDL_GPUTextureRegion          texture_dest;
+  SDL_GPUTextureLocation        texture_copy_source;
+  SDL_GPUTextureLocation        texture_copy_dest;
+  uint32_t                      texture_copy_w;
+  uint32_t                      texture_copy_h;
+};
+
+struct Upload_Block {
+  SDL_GPUTransferBuffer* transfer_buffer;
+  uint8_t*               mapped_ptr;
+  uint32_t               size;
+  uint32_t               used;
+};
+
+struct Upload_Frame {
+  std::vector<Upload_Block> blocks;
+  SDL_GPUFence*             fence;
+};
+
+// Per client counts, used_bytes, copies_count and blocks_count are of the last flushed frame.
+// fence_wait_ms is the time the last frame blocked on its fence, fence_waits_count the number of
+// frames whose fence hadn't signaled yet when they started.
+struct Upload_Scheduler_Stats {
+  uint32_t client_bytes[UPLOAD_CLIENT_COUNT];
+  int      client_allocations_count[UPLOAD_CLIENT_COUNT];
+  uint32_t used_bytes;
+  int      copies_count;
+  int      blocks_count;
+  uint64_t grow_count;
+  uint64_t shrink_count;
+  uint64_t fence_waits_count;
+  double   fence_wait_ms;
+  double   max_fence_wait_ms;
+};
+
+struct Upload_Scheduler {
+  SDL_GPUDevice*           device;
+  Upload_Frame             frames[UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT];
+  int                      frame_index;
+  uint64_t                 frame_number;
+  bool                     frame_begun;
+  bool                     frame_flushed;
+  std::vector<Upload_Copy> copies;
+  uint32_t                 block_size;
+  uint32_t                 low_use_peak_bytes;
+  int                      low_use_frames_count;
+  uint32_t                 frame_client_bytes[UPLOAD_CLIENT_COUNT];
+  int                      frame_client_allocations_count[UPLOAD_CLIENT_COUNT];
+  Upload_Scheduler_Stats   stats;
+};
+
+static uint32_t upload_scheduler_block_size_for(uint32_t size) {
+  uint32_t block_size = UPLOAD_SCHEDULER_MIN_BLOCK_SIZE;
+  while (block_size < size) { block_size *= 2; }
+  return block_size;
+}
+
+static void upload_scheduler_create(Upload_Scheduler* scheduler, SDL_GPUDevice* device) {
+  SDL_assert(scheduler != nullptr);
+  SDL_assert(device != nullptr);
+
+  scheduler->device     = device;
+  scheduler->block_size = UPLOAD_SCHEDULER_MIN_BLOCK_SIZE;
+}
+
+static void upload_scheduler_release_blocks(Upload_Scheduler* scheduler, Upload_Frame* frame) {
+  for (const auto& block : frame->blocks) {
+    if (block.mapped_ptr != nullptr) {
+      SDL_UnmapGPUTransferBuffer(scheduler->device, block.transfer_buffer);
+    }
+    SDL_ReleaseGPUTransferBuffer(scheduler->device, block.transfer_buffer);
+  }
+  frame->blocks.clear();
+}
+
+static void upload_scheduler_destroy(Upload_Scheduler* scheduler) {
+  SDL_assert(scheduler != nullptr);
+
+  if (scheduler->device == nullptr) { return; }
+  for (auto& frame : scheduler->frames) {
+    upload_scheduler_release_blocks(scheduler, &frame);
+    SDL_ReleaseGPUFence(scheduler->device, frame.fence);
+    frame.fence = nullptr;
+  }
+  scheduler->copies.clear();
+  scheduler->frame_begun = false;
+}
+
+static bool upload_scheduler_push_block(Upload_Scheduler* scheduler, uint32_t size) {
+  Upload_Block block = {};
+  {
+    SDL_GPUTransferBufferCreateInfo info = {};
+    info.usage                           = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    info.size                            = size;
+    block.transfer_buffer = SDL_CreateGPUTransferBuffer(scheduler->device, &info);
+    if (block.transfer_buffer == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to create transfer buffer: %s",
+          SDL_GetError());
+      return false;
+    }
+  }
+  block.size = size;
+  scheduler->frames[scheduler->frame_index].blocks.push_back(block);
+  return true;
+}
+
+// Waits until the GPU is done with the arena of the current frame and brings it to a single block
+// of block_size. Blocks are mapped when they are first allocated from.
+static void upload_scheduler_begin_frame(Upload_Scheduler* scheduler) {
+  auto  device = scheduler->device;
+  auto& frame  = scheduler->frames[scheduler->frame_index];
+
+  scheduler->stats.fence_wait_ms = 0.0;
+  if (frame.fence != nullptr) {
+    if (!SDL_QueryGPUFence(device, frame.fence)) {
+      auto start_counter = SDL_GetPerformanceCounter();
+      if (!SDL_WaitForGPUFences(device, true, &frame.fence, 1)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to wait for fence: %s", SDL_GetError());
+      }
+      scheduler->stats.fence_wait_ms =
+          static_cast<double>(SDL_GetPerformanceCounter() - start_counter) * 1000.0 /
+          static_cast<double>(SDL_GetPerformanceFrequency());
+      scheduler->stats.max_fence_wait_ms =
+          SDL_max(scheduler->stats.max_fence_wait_ms, scheduler->stats.fence_wait_ms);
+      scheduler->stats.fence_waits_count += 1;
+    }
+    SDL_ReleaseGPUFence(device, frame.fence);
+    frame.fence = nullptr;
+  }
+
+  if (frame.blocks.size() != 1 || frame.blocks[0].size != scheduler->block_size) {
+    upload_scheduler_release_blocks(scheduler, &frame);
+    upload_scheduler_push_block(scheduler, scheduler->block_size);
+  }
+  for (auto& block : frame.blocks) { block.used = 0; }
+
+  scheduler->frame_begun   = true;
+  scheduler->frame_flushed = false;
+}
+
+// Suballocates size bytes of the current frame's arena for client, beginning the frame if this is
+// its first allocation. Returns false if the memory can't be allocated or mapped.
+static bool upload_scheduler_allocate(
+    Upload_Scheduler*  scheduler,
+    Upload_Client      client,
+    uint32_t           size,
+    Upload_Allocation* out_allocation) {
+  SDL_assert(scheduler != nullptr);
+  SDL_assert(client >= 0 && client < UPLOAD_CLIENT_COUNT);
+  SDL_assert(size > 0);
+  SDL_assert(out_allocation != nullptr);
+  SDL_assert(!scheduler->frame_flushed);
+
+  if (!scheduler->frame_begun) { upload_scheduler_begin_frame(scheduler); }
+
+  auto& frame = scheduler->frames[scheduler->frame_index];
+  if (frame.blocks.empty() || frame.blocks.back().used + size > frame.blocks.back().size) {
+    auto block_size = upload_scheduler_block_size_for(size);
+    if (!frame.blocks.empty()) { block_size = SDL_max(block_size, frame.blocks.back().size); }
+    if (!upload_scheduler_push_block(scheduler, block_size)) { return false; }
+  }
+
+  auto& block = frame.blocks.back();
+  if (block.mapped_ptr == nullptr) {
+    block.mapped_ptr = static_cast<uint8_t*>(
+        SDL_MapGPUTransferBuffer(scheduler->device, block.transfer_buffer, false));
+    if (block.mapped_ptr == nullptr) {
+      SDL_LogError(
+          SDL_LOG_CATEGORY_APPLICATION,
+          "Failed to map transfer buffer: %s",
+          SDL_GetError());
+      return false;
+    }
+  }
+
+  out_allocation->ptr             = block.mapped_ptr + block.used;
+  out_allocation->transfer_buffer = block.transfer_buffer;
+  out_allocation->offset          = block.used;
+  out_allocation->size            = size;
+  block.used += (size + UPLOAD_SCHEDULER_ALIGNMENT - 1) & ~(UPLOAD_SCHEDULER_ALIGNMENT - 1);
+
+  scheduler->frame_client_bytes[client] += size;
+  scheduler->frame_client_allocations_count[client] += 1;
+
+  return true;
+}
+
+// Queues a copy of size bytes at offset into allocation to a region of buffer.
+static void upload_scheduler_upload_to_buffer(
+    Upload_Scheduler*        scheduler,
+    const Upload_Allocation& allocation,
+    uint32_t                 offset,
+    SDL_GPUBuffer*           buffer,
+    uint32_t                 buffer_offset,
+    uint32_t                 size) {
+  SDL_assert(scheduler != nullptr);
+  SDL_assert(offset + size <= allocation.size);
+  SDL_assert(buffer != nullptr);
+
+  auto& copy                          = scheduler->copies.emplace_back();
+  copy.kind                           = UPLOAD_COPY_KIND_BUFFER;
+  copy.buffer_source.transfer_buffer  = allocation.transfer_buffer;
+  copy.buffer_source.offset           = allocation.offset + offset;
+  copy.buffer_dest.buffer             = buffer;
+  copy.buffer_dest.offset             = buffer_offset;
+  copy.buffer_dest.size               = size;
+}
+
+// Queues a copy of the texels at offset into allocation, rows of region.w texels, to region.
+static void upload_scheduler_upload_to_texture(
+    Upload_Scheduler*           scheduler,
+    const Upload_Allocation&    allocation,
+    uint32_t                    offset,
+    const SDL_GPUTextureRegion& region) {
+  SDL_assert(scheduler != nullptr);
+  SDL_assert(region.texture != nullptr);
+
+  auto& copy                          = scheduler->copies.emplace_back();
+  copy.kind                           = UPLOAD_COPY_KIND_TEXTURE;
+  copy.texture_source.transfer_buffer = allocation.transfer_buffer;
+  copy.texture_source.offset          = allocation.offset + offset;
+  copy.texture_source.pixels_per_row  = region.w;
+  copy.texture_source.rows_per_layer  = region.h;
+  copy.texture_dest                   = region;
+}
+
+// Queues a copy of w x h texels between two textures, recorded along with the uploads.
+static void upload_scheduler_copy_texture(
+    Upload_Scheduler*             scheduler,
+    const SDL_GPUTextureLocation& source,
+    const SDL_GPUTextureLocation& dest,
+    uint32_t                      w,
+    uint32_t                      h) {
+  SDL_assert(scheduler != nullptr);
+
+  auto& copy               = scheduler->copies.emplace_back();
+  copy.kind                = UPLOAD_COPY_KIND_TEXTURE_TO_TEXTURE;
+  copy.texture_copy_source = source;
+  copy.texture_copy_dest   = dest;
+  copy.texture_copy_w      = w;
+  copy.texture_copy_h      = h;
+}
+
+// Unmaps the frame's arena and records every queued copy into one copy pass of cmd_buf. Call once
+// per frame, after every client has queued its uploads and before the render passes using them.
+static void upload_scheduler_flush(Upload_Scheduler* scheduler, SDL_GPUCommandBuffer* cmd_buf) {
+  SDL_assert(scheduler != nullptr);
+  SDL_assert(cmd_buf != nullptr);
+  SDL_assert(!scheduler->frame_flushed);
+
+  auto& frame = scheduler->frames[scheduler->frame_index];
+  if (scheduler->frame_begun) {
+    for (auto& block : frame.blocks) {
+      if (block.mapped_ptr == nullptr) { continue; }
+      SDL_UnmapGPUTransferBuffer(scheduler->device, block.transfer_buffer);
+      block.mapped_ptr = nullptr;
+    }
+  }
+
+  if (!scheduler->copies.empty()) {
+    auto copy_pass = SDL_BeginGPUCopyPass(cmd_buf);
+    for (const auto& copy : scheduler->copies) {
+      switch (copy.kind) {
+      case UPLOAD_COPY_KIND_BUFFER:
+        SDL_UploadToGPUBuffer(copy_pass, &copy.buffer_source, &copy.buffer_dest, false);
+        break;
+      case UPLOAD_COPY_KIND_TEXTURE:
+        SDL_UploadToGPUTexture(copy_pass, &copy.texture_source, &copy.texture_dest, false);
+        break;
+      case UPLOAD_COPY_KIND_TEXTURE_TO_TEXTURE:
+        SDL_CopyGPUTextureToTexture(
+            copy_pass,
+            &copy.texture_copy_source,
+            &copy.texture_copy_dest,
+            copy.texture_copy_w,
+            copy.texture_copy_h,
+            1,
+            false);
+        break;
+      }
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+  }
+
+  uint32_t used_bytes = 0;
+  if (scheduler->frame_begun) {
+    for (const auto& block : frame.blocks) { used_bytes += block.used; }
+  }
+
+  auto& stats        = scheduler->stats;
+  stats.used_bytes   = used_bytes;
+  stats.copies_count = static_cast<int>(scheduler->copies.size());
+  stats.blocks_count = scheduler->frame_begun ? static_cast<int>(frame.blocks.size()) : 0;
+  SDL_memcpy(stats.client_bytes, scheduler->frame_client_bytes, sizeof(stats.client_bytes));
+  SDL_memcpy(
+      stats.client_allocations_count,
+      scheduler->frame_client_allocations_count,
+      sizeof(stats.client_allocations_count));
+  SDL_zeroa(scheduler->frame_client_bytes);
+  SDL_zeroa(scheduler->frame_client_allocations_count);
+
+  scheduler->copies.clear();
+  scheduler->frame_number += 1;
+  if (!scheduler->frame_begun) { return; }
+  scheduler->frame_flushed = true;
+
+  if (used_bytes > scheduler->block_size) {
+    scheduler->block_size           = upload_scheduler_block_size_for(used_bytes);
+    scheduler->low_use_frames_count = 0;
+    scheduler->low_use_peak_bytes   = 0;
+    stats.grow_count += 1;
+  } else if (
+      scheduler->block_size > UPLOAD_SCHEDULER_MIN_BLOCK_SIZE &&
+      used_bytes <= scheduler->block_size / 4) {
+    scheduler->low_use_frames_count += 1;
+    scheduler->low_use_peak_bytes = SDL_max(scheduler->low_use_peak_bytes, used_bytes);
+    if (scheduler->low_use_frames_count >= UPLOAD_SCHEDULER_SHRINK_FRAMES) {
+      scheduler->block_size = upload_scheduler_block_size_for(scheduler->low_use_peak_bytes);
+      scheduler->low_use_frames_count = 0;
+      scheduler->low_use_peak_bytes   = 0;
+      stats.shrink_count += 1;
+    }
+  } else {
+    scheduler->low_use_frames_count = 0;
+    scheduler->low_use_peak_bytes   = 0;
+  }
+}
+
+// Submits cmd_buf in place of SDL_SubmitGPUCommandBuffer. If the frame used its arena, the fence
+// of the command buffer is kept to guard it and the next frame moves on to the next arena.
+static bool upload_scheduler_submit(Upload_Scheduler* scheduler, SDL_GPUCommandBuffer* cmd_buf) {
+  SDL_assert(scheduler != nullptr);
+  SDL_assert(cmd_buf != nullptr);
+  SDL_assert(!scheduler->frame_begun || scheduler->frame_flushed);
+
+  if (!scheduler->frame_begun) { return SDL_SubmitGPUCommandBuffer(cmd_buf); }
+  scheduler->frame_begun   = false;
+  scheduler->frame_flushed = false;
+
+  auto fence = SDL_SubmitGPUCommandBufferAndAcquireFence(cmd_buf);
+  if (fence == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Failed to submit command buffer: %s",
+        SDL_GetError());
+    return false;
+  }
+  scheduler->frames[scheduler->frame_index].fence = fence;
+  scheduler->frame_index = (scheduler->frame_index + 1) % UPLOAD_SCHEDULER_FRAMES_IN_FLIGHT;
+
+  return true;
+}